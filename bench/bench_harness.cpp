@@ -0,0 +1,93 @@
+#include "bench_harness.h"
+#include <new>
+#include <cstdlib>
+#include <atomic>
+
+// Every allocation of the program goes through these, the counters are per thread so
+// the timed thread only sees its own allocations
+static thread_local uint64_t allocation_count = 0;
+static thread_local uint64_t allocation_bytes = 0;
+// Summed over every thread, for benchmarks that hand their work to a pool
+static std::atomic<bool> counting_process{ false };
+static std::atomic<uint64_t> process_count{ 0 };
+static std::atomic<uint64_t> process_bytes{ 0 };
+
+static void* counted_alloc(std::size_t size, std::size_t alignment)
+{
+	allocation_count += 1;
+	allocation_bytes += size;
+	if (counting_process.load(std::memory_order_relaxed)) {
+		process_count.fetch_add(1, std::memory_order_relaxed);
+		process_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	if (size == 0) { size = 1; }
+	void* memory = nullptr;
+	if (alignment <= alignof(std::max_align_t)) {
+		memory = std::malloc(size);
+	} else {
+		// aligned_alloc requires a size that is a multiple of the alignment
+		memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	}
+	if (memory == nullptr) { throw std::bad_alloc(); }
+	return memory;
+}
+
+void* operator new(std::size_t size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return counted_alloc(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return counted_alloc(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+namespace bench
+{
+	Allocations thread_allocations()
+	{
+		return Allocations{ allocation_count, allocation_bytes };
+	}
+
+	// Heap allocations made by every thread of the process while process_counting(true) is in effect
+	Allocations process_allocations()
+	{
+		return Allocations{ process_count.load(std::memory_order_relaxed), process_bytes.load(std::memory_order_relaxed) };
+	}
+
+	void process_counting(const bool enabled)
+	{
+		counting_process.store(enabled, std::memory_order_relaxed);
+	}
+
+	static volatile const void* sink = nullptr;
+
+	// Keeps the compiler from dropping a result that is otherwise unused
+	void keep(const void* value)
+	{
+		sink = value;
+	}
+
+	double& min_seconds()
+	{
+		static double seconds = 0.5;
+		return seconds;
+	}
+
+	// Prints the column headers once, then one line per result
+	void print_header()
+	{
+		std::printf("%-44s %12s %14s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+	}
+
+	void print(const Result& result)
+	{
+		std::printf("%-44s %12llu %14.1f %12.2f %12.1f\n", result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+					result.ns_per_op, result.allocs_per_op, result.bytes_per_op);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+
+namespace bench
+{
+	// Heap allocations made by the calling thread since it started, counted by the
+	// replacement operator new in bench_harness.cpp
+	struct Allocations
+	{
+		uint64_t count;
+		uint64_t bytes;
+	};
+
+	Allocations thread_allocations();
+
+	// Heap allocations made by every thread of the process, only counted while process_counting(true) is in effect
+	// so the benchmarks of a single thread do not pay for the shared counters
+	Allocations process_allocations();
+	void process_counting(const bool);
+
+	struct Result
+	{
+		std::string name;
+		uint64_t iterations;
+		double ns_per_op;
+		double allocs_per_op;
+		double bytes_per_op;
+	};
+
+	// Keeps the compiler from dropping a result that is otherwise unused
+	void keep(const void*);
+
+	// Prints the column headers once, then one line per result
+	void print_header();
+	void print(const Result&);
+
+	// Minimum time spent measuring each benchmark, set from the command line
+	double& min_seconds();
+
+	// Times the body over batches of iterations, doubling the batch until one takes long
+	// enough to measure, then repeats batches until min_seconds() has passed
+	// setup(n) builds the n inputs of a batch outside of the timed region, body(input) is one operation
+	// Allocations are those of the calling thread unless another counter is given
+	template <typename Setup, typename Body>
+	Result run(const std::string& name, Setup setup, Body body, Allocations (*allocations_of)() = thread_allocations)
+	{
+		using clock = std::chrono::steady_clock;
+		const double min_ns = min_seconds() * 1e9;
+
+		uint64_t batch = 1;
+		uint64_t iterations = 0;
+		double elapsed_ns = 0;
+		Allocations allocations{ 0, 0 };
+		while (elapsed_ns < min_ns) {
+			auto inputs = setup(batch);
+
+			Allocations before = allocations_of();
+			auto start = clock::now();
+			for (auto& input : inputs) { body(input); }
+			double batch_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+			Allocations after = allocations_of();
+
+			iterations += batch;
+			elapsed_ns += batch_ns;
+			allocations.count += after.count - before.count;
+			allocations.bytes += after.bytes - before.bytes;
+
+			// Batches of about a tenth of the total time keep the setup memory bounded
+			if (batch_ns < min_ns / 10) { batch = std::min<uint64_t>(batch * 2, 1u << 20); }
+		}
+
+		Result result{ name, iterations, elapsed_ns / iterations,
+					   double(allocations.count) / iterations, double(allocations.bytes) / iterations };
+		print(result);
+		return result;
+	}
+
+	// For bodies that need no fresh input per iteration
+	template <typename Body>
+	Result run(const std::string& name, Body body, Allocations (*allocations_of)() = thread_allocations)
+	{
+		return run(name, [](uint64_t n) { return std::vector<uint64_t>(n); }, [&](uint64_t&) { body(); }, allocations_of);
+	}
+}
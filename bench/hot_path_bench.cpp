@@ -0,0 +1,306 @@
+// Microbenchmarks of the per-paper hot paths: filename ordering and renaming, rdf patching,
+// the title page rewrite and a scan of the whole archive, reported as ns/op along with heap allocations per op
+//
+// Usage: hot_path_bench [filter] [seconds]
+// filter keeps the benchmarks whose name contains it, seconds is the minimum time spent on each (0.5)
+//
+// Build with the CMake project of this directory:
+// cmake -S bench -B build/bench -DCMAKE_BUILD_TYPE=Release && cmake --build build/bench
+
+#include "bench_harness.h"
+#include "file_actions.h"
+#include "rdf_actions.h"
+#include "pdf_actions.h"
+#include "title_rewriter.h"
+#include "archive_scan.h"
+#include "parallel.h"
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+static std::string filter;
+
+static bool selected(const std::string& name)
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+// Filenames as a publication directory holds them, e.g. EB-24-V44-I1-P26.pdf, over several
+// publications and issues so the ordering has to look past the acronym
+static std::vector<file::PaperEntry> make_entries(const size_t count, std::mt19937& rng)
+{
+	static const char* acronyms[] = { "EB", "JAE", "PEJ", "AERI", "REB" };
+	std::vector<file::PaperEntry> entries;
+	entries.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		const int volume = 30 + static_cast<int>(rng() % 15);
+		const int issue = 1 + static_cast<int>(rng() % 4);
+		std::string filename = std::string(acronyms[rng() % 5]) + "-" + std::to_string(volume - 20) + "-V" + std::to_string(volume) +
+			"-I" + std::to_string(issue) + "-P" + std::to_string(1 + i % 250) + ".pdf";
+
+		file::PaperEntry entry;
+		entry.filename = filename;
+		if (!file::parse_filename(entry.filename, entry.key)) {
+			std::cerr << "Generated filename does not follow the convention: " + filename << std::endl;
+			std::exit(1);
+		}
+		entries.push_back(std::move(entry));
+	}
+	std::shuffle(entries.begin(), entries.end(), rng);
+	return entries;
+}
+
+static void bench_filenames(std::mt19937& rng)
+{
+	for (size_t count : { size_t(100), size_t(1000), size_t(10000) }) {
+		const std::vector<file::PaperEntry> entries = make_entries(count, rng);
+		const std::string suffix = "/" + std::to_string(count);
+
+		if (selected("compare_filenames" + suffix)) {
+			size_t next = 0;
+			size_t less = 0;
+			bench::run("compare_filenames" + suffix, [&]() {
+				const file::PaperEntry& a = entries[next];
+				const file::PaperEntry& b = entries[(next * 7 + 3) % count];
+				next = (next + 1 == count) ? 0 : next + 1;
+				less += file::compare_filenames(a, b);
+			});
+			bench::keep(&less);
+		}
+
+		// Every op sorts a freshly shuffled copy, the copies are made outside of the timing
+		if (selected("sort_files" + suffix)) {
+			bench::run("sort_files" + suffix,
+				[&](uint64_t n) { return std::vector<std::vector<file::PaperEntry>>(n, entries); },
+				[](std::vector<file::PaperEntry>& copy) {
+					file::sort_files(copy);
+					bench::keep(copy.data());
+				});
+		}
+	}
+
+	const std::vector<file::PaperEntry> entries = make_entries(1000, rng);
+	if (selected("rename_temp_filename")) {
+		auto copies = [&](uint64_t n) {
+			std::vector<std::string> names;
+			names.reserve(n);
+			for (uint64_t i = 0; i < n; ++i) { names.push_back(entries[i % entries.size()].filename); }
+			return names;
+		};
+		bench::run("rename_temp_filename", copies, [](std::string& name) {
+			file::rename_temp_filename(name, 45, 2);
+			bench::keep(name.data());
+		});
+		bench::run("rename_temp_filename/paper", copies, [](std::string& name) {
+			file::rename_temp_filename(name, 45, 2, 117);
+			bench::keep(name.data());
+		});
+	}
+}
+
+// Words of the generated abstracts and titles, shaped after the bulletin's papers
+static std::string make_text(const size_t bytes, std::mt19937& rng)
+{
+	static const char* words[] = { "we", "study", "the", "effect", "of", "monetary", "policy", "on", "regional",
+								   "price", "differences", "using", "monthly", "panel", "data", "and", "find",
+								   "that", "heterogeneity", "across", "goods", "is", "robust", "to", "trade", "costs" };
+	std::string text;
+	while (text.size() < bytes) {
+		if (!text.empty()) { text += ' '; }
+		text += words[rng() % (sizeof(words) / sizeof(words[0]))];
+	}
+	return text;
+}
+
+// A ReDIF record of the size the archive holds, with the abstract spread over several lines
+static std::string make_rdf(std::mt19937& rng)
+{
+	std::string rdf = "Template-Type: ReDIF-Article 1.0\n";
+	for (int author = 0; author < 3; ++author) {
+		rdf += "Author-Name: Author Number" + std::to_string(author) + "\n";
+		rdf += "Author-Email: author" + std::to_string(author) + "@example.edu\n";
+		rdf += "Author-Workplace-Name: University " + std::to_string(author) + "\n";
+	}
+	rdf += "Title: " + make_text(80, rng) + "\n";
+	rdf += "Abstract: " + make_text(120, rng) + "\n";
+	for (int line = 0; line < 24; ++line) { rdf += make_text(120, rng) + "\n"; }
+	rdf += "Classification-JEL: E3, E5\n";
+	rdf += "Keywords: " + make_text(60, rng) + "\n";
+	rdf += "Journal: Economics Bulletin\n";
+	rdf += "Pages: 812 - 824\n";
+	rdf += "Volume: 43\n";
+	rdf += "Issue: 2\n";
+	rdf += "Year: 2023\n";
+	rdf += "Month: June\n";
+	rdf += "File-URL: http://www.accessecon.com/Pubs/EB/2023/Volume43/EB-23-V43-I2-P73.pdf\n";
+	rdf += "File-Format: Application/pdf\n";
+	rdf += "Creation-Date: 2023-06-30\n";
+	rdf += "Handle: RePEc:ebl:ecbull:eb-23-00073\n";
+	return rdf;
+}
+
+static void bench_rdf(std::mt19937& rng)
+{
+	if (!selected("rdf")) { return; }
+
+	std::error_code ec;
+	const fs::path dir = fs::temp_directory_path() / ("hot_path_bench_" + std::to_string(rng()));
+	fs::create_directories(dir, ec);
+	const std::string path = (dir / "eb-23-00073.rdf").string();
+	const std::string rdf = make_rdf(rng);
+	file::write_file_atomic(path, rdf, file::SyncPolicy::None);
+	std::cout << "rdf of " << rdf.size() << " bytes at " << path << std::endl;
+
+	// The value alternates so every apply rewrites the file, as it does when an issue is moved
+	uint64_t turn = 0;
+	bench::run("update_rdf_line/Volume:", [&]() {
+		rdf::RdfPatch("eb-23-00073").set("Volume:", (turn++ % 2) ? "44" : "45").apply(path);
+	});
+
+	// Every field the pipeline queues for a paper, applied in one pass
+	const std::string abstract = make_text(3000, rng);
+	bench::run("RdfPatch::apply/8 fields", [&]() {
+		const std::string issue = (turn++ % 2) ? "3" : "4";
+		rdf::RdfPatch("eb-23-00073")
+			.set("Title:", "On the persistence of regional price differences")
+			.set("Abstract:", abstract)
+			.set("Creation-Date:", "2024-09-30")
+			.set("File-URL:", "http://www.accessecon.com/Pubs/EB/2024/Volume44/EB-24-V44-I" + issue + "-P117.pdf")
+			.set("Pages:", "1021 - 1033")
+			.set("Year:", "2024")
+			.set("Volume:", "44")
+			.set("Issue:", issue)
+			.apply(path);
+	});
+
+	fs::remove_all(dir, ec);
+}
+
+// An archive of 8 publications with 10 years of 4 volumes each and 60 papers per volume,
+// 19200 empty files in all, next to an html and an rdf per volume that the scan leaves out
+static void bench_archive(std::mt19937& rng)
+{
+	if (!selected("archive")) { return; }
+
+	std::error_code ec;
+	const fs::path root = fs::temp_directory_path() / ("hot_path_bench_" + std::to_string(rng()));
+	static const char* acronyms[] = { "EB", "JAE", "PEJ", "AERI", "REB", "EBFT", "VUE", "WPS" };
+	size_t files = 0;
+	for (const char* acronym : acronyms) {
+		for (int year = 2015; year < 2025; ++year) {
+			for (int v = 0; v < 4; ++v) {
+				const int volume = (year - 2015) * 4 + v + 20;
+				const fs::path dir = root / acronym / std::to_string(year) / ("Volume" + std::to_string(volume));
+				fs::create_directories(dir, ec);
+				std::ofstream(dir / "index.html");
+				std::ofstream(dir / "notes.rdf");
+				for (int paper = 1; paper <= 60; ++paper) {
+					std::ofstream(dir / (std::string(acronym) + "-" + std::to_string(year % 100) + "-V" + std::to_string(volume) +
+										 "-I" + std::to_string(1 + paper % 4) + "-P" + std::to_string(paper) + ".pdf"));
+					++files;
+				}
+			}
+		}
+	}
+	std::cout << "archive of " << files << " papers at " << root.string() << std::endl;
+
+	// What a per-directory walk with std::filesystem costs for the same tree
+	bench::run("archive/recursive_directory_iterator", [&]() {
+		size_t found = 0;
+		for (const auto& entry : fs::recursive_directory_iterator(root)) {
+			file::PaperFilename key;
+			std::string filename = entry.path().filename().string();
+			if (fs::is_regular_file(entry) && file::is_pdf(filename) && file::parse_filename(filename, key)) { ++found; }
+		}
+		bench::keep(&found);
+	});
+
+	std::vector<size_t> thread_counts;
+	for (size_t jobs : { size_t(1), size_t(4), parallel::default_jobs() }) {
+		if (std::find(thread_counts.begin(), thread_counts.end(), jobs) == thread_counts.end()) { thread_counts.push_back(jobs); }
+	}
+	// The workers read most of the directories, so their allocations are counted along with those of the calling thread
+	bench::process_counting(true);
+	for (size_t jobs : thread_counts) {
+		bench::run("archive/scan_archive/" + std::to_string(jobs) + " threads", [&]() {
+			size_t found = file::scan_archive(root.string(), jobs, [](std::vector<file::ArchivePaper>&) {});
+			bench::keep(&found);
+		}, bench::process_allocations);
+	}
+	bench::process_counting(false);
+
+	fs::remove_all(root, ec);
+}
+
+// A title page of the size the publications generate, with styling, several authors and a long abstract
+static std::string make_title_page(std::mt19937& rng)
+{
+	std::string html = "<html>\n<head>\n<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">\n"
+					   "<title>Economics Bulletin, Volume 43, Issue 2</title>\n<style type=\"text/css\">\n";
+	for (int rule = 0; rule < 40; ++rule) {
+		html += ".c" + std::to_string(rule) + " { font-family: Times New Roman, serif; font-size: " + std::to_string(10 + rule % 8) +
+				"pt; margin: 0 0 4px 0; color: #222; }\n";
+	}
+	html += "</style>\n</head>\n<body>\n"
+			"<table width=\"100%\" border=\"0\" cellspacing=\"0\" cellpadding=\"4\">\n"
+			"<tr><td align=\"center\"><font size=\"5\"><b>Economics Bulletin</b></font></td></tr>\n"
+			"<tr><td align=\"center\"><font size=\"3\">Volume 43, Issue 2</font></td></tr>\n"
+			"</table>\n<hr>\n"
+			"<p align=\"center\"><font size=\"5\"><b>On the persistence of regional price differences</b></font></p>\n";
+	for (int author = 0; author < 4; ++author) {
+		html += "<p align=\"center\">Author Number" + std::to_string(author) + "<br><i>University " + std::to_string(author) + "</i></p>\n";
+	}
+	html += "<hr>\n<p><b>Abstract</b></p>\n<p>" + make_text(2400, rng) + "</p>\n<hr>\n"
+			"<p><b>Citation:</b> Author Number0 and Author Number1, (2023) ''On the persistence of regional price differences'',\n"
+			"<i>Economics Bulletin</i>, Vol. 43 No. 2 pp. 812-824.</p>\n"
+			"<p><b>Contact:</b> Author Number0 - author0@example.edu, Author Number1 - author1@example.edu.</p>\n"
+			"<p><b>Submitted:</b> January 12, 2023. <b>Published:</b> June 30, 2023.</p>\n</body>\n</html>\n";
+	return html;
+}
+
+static void bench_title_page(std::mt19937& rng)
+{
+	if (!selected("title")) { return; }
+
+	const std::string page = make_title_page(rng);
+	std::cout << "title page of " << page.size() << " bytes" << std::endl;
+
+	const int new_vol = 44;
+	const int new_iss = 3;
+	const std::array<std::string, 2> page_range{ "1021", "1033" };
+	std::array<std::string, 2> date_array{ pdf::date_short(new_iss), pdf::date_month(new_iss) };
+
+	bench::run("title/update_title", [&]() {
+		std::string updated = pdf::update_title(page, new_vol, new_iss);
+		bench::keep(updated.data());
+	});
+
+	const std::string titled = pdf::update_title(page, new_vol, new_iss);
+	bench::run("title/update_citation", [&]() {
+		std::string updated = pdf::update_citation(titled, new_vol, new_iss, page_range, date_array);
+		bench::keep(updated.data());
+	});
+
+	// The single-pass rewriter the pipeline uses in place of the two above
+	const pdf::TitleRewriter rewriter(new_vol, new_iss, page_range, date_array);
+	bench::run("title/TitleRewriter::rewrite", [&]() {
+		std::string updated = rewriter.rewrite(page);
+		bench::keep(updated.data());
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1) { filter = argv[1]; }
+	if (argc > 2) { bench::min_seconds() = std::stod(argv[2]); }
+
+	// A fixed seed keeps the inputs the same from one run to the next
+	std::mt19937 rng(20240930);
+	bench::print_header();
+	bench_filenames(rng);
+	bench_rdf(rng);
+	bench_title_page(rng);
+	bench_archive(rng);
+	return 0;
+}
@@ -0,0 +1,280 @@
+// Times pdf::splice_title_page on a generated paper, after checking the splice and pdf::inflate
+//
+// Usage: pdf_splice_bench [pages] [iterations]
+// A rendered EB title page is spliced into a generated paper of the given number of pages (8 by default),
+// whose page tree is nested and whose content streams are compressed by zlib
+// Before timing, the spliced pdf is parsed again and has to hold the title page followed by the kept pages
+// in order, and inflate() has to give back what zlib deflated, with stored, fixed, and dynamic blocks
+//
+// Needs zlib as the reference compressor, built with the CMake project of this directory:
+// cmake -S bench -B build/bench -DCMAKE_BUILD_TYPE=Release && cmake --build build/bench
+
+#include "pdf_splice.h"
+#include "title_page.h"
+#include <zlib.h>
+#include <chrono>
+#include <random>
+
+// Compresses with zlib, window_bits below zero writes a raw deflate stream without the zlib header
+static std::string deflate(const std::string& data, const int level, const int window_bits, const int strategy)
+{
+	z_stream stream{};
+	if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, strategy) != Z_OK) { throw std::runtime_error("deflateInit2 failed"); }
+	std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	stream.avail_in = static_cast<uInt>(data.size());
+	stream.next_out = reinterpret_cast<Bytef*>(out.data());
+	stream.avail_out = static_cast<uInt>(out.size());
+	int result = ::deflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+	if (result != Z_STREAM_END) { throw std::runtime_error("deflate did not finish"); }
+	return out;
+}
+
+static std::string page_marker(const int n)
+{
+	return "(Paper page " + std::to_string(n) + ") Tj";
+}
+
+// A paper of the given number of pages, split over two intermediate page tree nodes
+// that carry the inherited /Resources and /MediaBox, with a marker in each page's compressed content
+static std::string build_paper(const int page_count)
+{
+	pdf::PdfBuilder builder("1.5");
+	int catalog_num = builder.allocate();
+	int root_num = builder.allocate();
+	int font_num = builder.allocate();
+	std::array<int, 2> node_nums{ builder.allocate(), builder.allocate() };
+
+	// Streams only point at their data, which has to outlive the builder
+	std::vector<std::string> contents;
+	contents.reserve(page_count);
+
+	std::array<pdf::PdfObject, 2> kids{ pdf::PdfObject::make_array(), pdf::PdfObject::make_array() };
+	for (int n = 1; n <= page_count; ++n) {
+		size_t node = (n <= page_count / 2) ? 0 : 1;
+		int page_num = builder.allocate();
+		int content_num = builder.allocate();
+		kids[node].items.push_back(pdf::PdfObject::make_reference(page_num));
+
+		std::string text;
+		for (int line = 0; line < 40; ++line) {
+			text += "BT /F1 10 Tf 72 " + std::to_string(740 - 16 * line) + " Td (Line " + std::to_string(line) + " of the paper body) Tj ET\n";
+		}
+		text += "BT /F1 10 Tf 300 40 Td " + page_marker(n) + " ET\n";
+		contents.push_back(deflate(text, Z_DEFAULT_COMPRESSION, 15, Z_DEFAULT_STRATEGY));
+
+		pdf::PdfObject content;
+		content.kind = pdf::PdfObject::Kind::Stream;
+		content.set("/Filter", pdf::PdfObject::make_name("/FlateDecode"));
+		content.set("/Length", pdf::PdfObject::make_number(static_cast<long long>(contents.back().size())));
+		content.stream = contents.back();
+		builder.write(content_num, content);
+
+		pdf::PdfObject page = pdf::PdfObject::make_dictionary();
+		page.set("/Type", pdf::PdfObject::make_name("/Page"));
+		page.set("/Parent", pdf::PdfObject::make_reference(node_nums[node]));
+		page.set("/Contents", pdf::PdfObject::make_reference(content_num));
+		builder.write(page_num, page);
+	}
+
+	pdf::PdfObject font = pdf::PdfObject::make_dictionary();
+	font.set("/Type", pdf::PdfObject::make_name("/Font"));
+	font.set("/Subtype", pdf::PdfObject::make_name("/Type1"));
+	font.set("/BaseFont", pdf::PdfObject::make_name("/Helvetica"));
+	builder.write(font_num, font);
+
+	pdf::PdfObject fonts = pdf::PdfObject::make_dictionary();
+	fonts.set("/F1", pdf::PdfObject::make_reference(font_num));
+	pdf::PdfObject resources = pdf::PdfObject::make_dictionary();
+	resources.set("/Font", fonts);
+	pdf::PdfObject media_box = pdf::PdfObject::make_array();
+	for (long long value : { 0, 0, 612, 792 }) { media_box.items.push_back(pdf::PdfObject::make_number(value)); }
+
+	pdf::PdfObject root_kids = pdf::PdfObject::make_array();
+	for (size_t node = 0; node < node_nums.size(); ++node) {
+		root_kids.items.push_back(pdf::PdfObject::make_reference(node_nums[node]));
+
+		pdf::PdfObject node_dict = pdf::PdfObject::make_dictionary();
+		node_dict.set("/Type", pdf::PdfObject::make_name("/Pages"));
+		node_dict.set("/Parent", pdf::PdfObject::make_reference(root_num));
+		node_dict.set("/Count", pdf::PdfObject::make_number(static_cast<long long>(kids[node].items.size())));
+		node_dict.set("/Kids", kids[node]);
+		builder.write(node_nums[node], node_dict);
+	}
+
+	pdf::PdfObject root = pdf::PdfObject::make_dictionary();
+	root.set("/Type", pdf::PdfObject::make_name("/Pages"));
+	root.set("/Resources", resources);
+	root.set("/MediaBox", media_box);
+	root.set("/Count", pdf::PdfObject::make_number(page_count));
+	root.set("/Kids", root_kids);
+	builder.write(root_num, root);
+
+	pdf::PdfObject catalog = pdf::PdfObject::make_dictionary();
+	catalog.set("/Type", pdf::PdfObject::make_name("/Catalog"));
+	catalog.set("/Pages", pdf::PdfObject::make_reference(root_num));
+	builder.write(catalog_num, catalog);
+
+	pdf::PdfObject trailer = pdf::PdfObject::make_dictionary();
+	trailer.set("/Root", pdf::PdfObject::make_reference(catalog_num));
+	trailer.set("/Size", pdf::PdfObject::make_number(builder.get_size()));
+	return builder.finish(trailer);
+}
+
+// Decoded content of a page, the streams of a /Contents array are joined
+static std::string page_content(pdf::PdfDocument& doc, const pdf::PdfDocument::Page& page)
+{
+	const pdf::PdfObject* contents = page.dict.get("/Contents");
+	if (contents == nullptr) { return ""; }
+	const pdf::PdfObject& resolved = doc.resolve(*contents);
+	if (resolved.kind != pdf::PdfObject::Kind::Array) { return doc.decode_stream(resolved); }
+	std::string joined;
+	for (const auto& item : resolved.items) { joined += doc.decode_stream(doc.resolve(item)) + "\n"; }
+	return joined;
+}
+
+// Checks that the spliced pdf holds the title page followed by the paper from first_page on
+static bool check_splice(const std::string& title_pdf, const std::string& paper_pdf, const int page_count, const int first_page)
+{
+	pdf::PdfDocument title(title_pdf);
+	pdf::PdfDocument paper(paper_pdf);
+	pdf::PdfDocument spliced(pdf::splice_title_page(title, paper, first_page));
+
+	const std::vector<pdf::PdfDocument::Page>& pages = spliced.get_pages();
+	size_t expected_count = 1 + static_cast<size_t>(page_count - first_page + 1);
+	if (pages.size() != expected_count) {
+		std::cerr << "Splicing from page " << first_page << " gave " << pages.size() << " pages instead of " << expected_count << std::endl;
+		return false;
+	}
+	if (page_content(spliced, pages[0]) != page_content(title, title.get_pages()[0])) {
+		std::cerr << "Splicing from page " << first_page << " did not put the title page first" << std::endl;
+		return false;
+	}
+	for (size_t i = 1; i < pages.size(); ++i) {
+		int expected_page = first_page + static_cast<int>(i) - 1;
+		std::string content = page_content(spliced, pages[i]);
+		bool found = content.find(page_marker(expected_page)) != std::string::npos;
+		for (int other = 1; found && other <= page_count; ++other) {
+			if (other != expected_page && content.find(page_marker(other)) != std::string::npos) { found = false; }
+		}
+		if (!found) {
+			std::cerr << "Splicing from page " << first_page << " put the wrong page at " << i + 1 << ", expected page " << expected_page << std::endl;
+			return false;
+		}
+		// The inherited attributes have to be copied into every page, the page tree they came from is gone
+		const pdf::PdfObject* resources = pages[i].dict.get("/Resources");
+		if (resources == nullptr || pages[i].dict.get("/MediaBox") == nullptr || spliced.resolve(*resources).get("/Font") == nullptr) {
+			std::cerr << "Splicing from page " << first_page << " lost the inherited resources of page " << i + 1 << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Checks that inflate() gives back the data for every block type zlib writes, with and without the zlib header
+static bool check_inflate(const std::vector<std::string>& inputs)
+{
+	struct Setting
+	{
+		const char* name;
+		int level;
+		int window_bits;
+		int strategy;
+	};
+	const Setting settings[] = {
+		{ "stored", 0, 15, Z_DEFAULT_STRATEGY },
+		{ "fixed", 6, 15, Z_FIXED },
+		{ "dynamic, level 1", 1, 15, Z_DEFAULT_STRATEGY },
+		{ "dynamic, level 9", 9, 15, Z_DEFAULT_STRATEGY },
+		{ "raw, level 6", 6, -15, Z_DEFAULT_STRATEGY },
+	};
+	for (const auto& setting : settings) {
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			std::string compressed = deflate(inputs[i], setting.level, setting.window_bits, setting.strategy);
+			std::string inflated;
+			if (!pdf::inflate(compressed, inflated) || inflated != inputs[i]) {
+				std::cerr << "inflate(deflate(x)) != x for input " << i << " (" << inputs[i].size() << " bytes, " << setting.name << ")" << std::endl;
+				return false;
+			}
+			// A stream cut short has to be refused rather than taken for the whole
+			std::string truncated;
+			if (compressed.size() > 8 && pdf::inflate(std::string_view(compressed).substr(0, compressed.size() / 2), truncated)) {
+				std::cerr << "inflate() accepted half of input " << i << " (" << setting.name << ")" << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int page_count = (argc > 1) ? std::max(2, std::stoi(argv[1])) : 8;
+	int iterations = (argc > 2) ? std::stoi(argv[2]) : 500;
+
+	pdf::TitlePageFields fields;
+	fields.id = "EB-24-00001";
+	fields.pub = "EB";
+	fields.title = "On the persistence of regional price differences";
+	fields.authors = { "First Author", "Second Author" };
+	fields.volume = 44;
+	fields.issue = 3;
+	fields.year = "2024";
+	fields.page_range = { "1021", "1033" };
+	fields.published = "September 30, 2024";
+	const std::string title_pdf = pdf::TitlePageRenderer().render(fields);
+	const std::string paper_pdf = build_paper(page_count);
+
+	// Both the splice and the inflater have to be right before their timings mean anything
+	try {
+		for (int first_page : { 1, 2, page_count }) {
+			if (!check_splice(title_pdf, paper_pdf, page_count, first_page)) { return 1; }
+		}
+		pdf::PdfDocument title(title_pdf);
+		pdf::PdfDocument paper(paper_pdf);
+		try {
+			pdf::splice_title_page(title, paper, page_count + 1);
+			std::cerr << "Splicing from past the last page did not throw" << std::endl;
+			return 1;
+		} catch (const pdf::PdfError&) {}
+	} catch (const std::exception& e) {
+		std::cerr << "Splice check failed: " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::mt19937 random(42);
+	std::string noise(200000, '\0');
+	for (char& c : noise) { c = static_cast<char>(random() & 0xFF); }
+	std::string text;
+	while (text.size() < 300000) { text += "BT /F1 10 Tf 72 700 Td (Economics Bulletin, Volume 44, Issue 3) Tj ET\n" + std::to_string(text.size()) + "\n"; }
+	std::vector<std::string> inputs{ "", "a", std::string(70000, 'x'), noise, text, title_pdf, paper_pdf };
+	if (!check_inflate(inputs)) { return 1; }
+	std::cout << "Spliced " << page_count << "-page paper checked from pages 1, 2 and " << page_count
+			  << ", inflate() round-trips " << inputs.size() << " inputs in 5 settings." << std::endl;
+
+	using clock = std::chrono::steady_clock;
+	size_t sink = 0;
+	auto start = clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		pdf::PdfDocument title(title_pdf);
+		pdf::PdfDocument paper(paper_pdf);
+		sink += pdf::splice_title_page(title, paper, 2).size();
+	}
+	double splice_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+
+	std::string compressed = deflate(text, Z_DEFAULT_COMPRESSION, 15, Z_DEFAULT_STRATEGY);
+	int inflate_iterations = std::max(1, iterations / 10);
+	start = clock::now();
+	for (int i = 0; i < inflate_iterations; ++i) {
+		std::string inflated;
+		pdf::inflate(compressed, inflated);
+		sink += inflated.size();
+	}
+	double inflate_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / inflate_iterations;
+
+	std::cout << "parse + splice: " << splice_ns / 1000 << " us/paper (" << paper_pdf.size() << " bytes)" << std::endl;
+	std::cout << "inflate:        " << inflate_ns / text.size() << " ns/byte (" << text.size() << " bytes)" << std::endl;
+	return (sink == 0) ? 1 : 0;
+}
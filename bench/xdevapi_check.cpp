@@ -0,0 +1,172 @@
+// Round-trips sql_agent::XDevApiPaperStore against a local mysqld with the X Plugin
+//
+// Usage: xdevapi_check <username> <password> [schema] [host] [port]
+// The schema (quickfix_check by default) is created with its own tablepaper and tablepaperofarticles,
+// and dropped again at the end, so only names starting with quickfix_check are accepted
+// Exits with 1 if any check fails, 2 if the server cannot be reached
+//
+// Only built when asked for, since it needs mysqlcppconn8:
+// cmake -S bench -B build/bench -DQUICKFIX_XDEVAPI_CHECK=ON && cmake --build build/bench --target xdevapi_check
+
+#include "xdevapi_store.h"
+#include "logging.h"
+#include <iostream>
+#include <map>
+#include <set>
+
+// Papers spread over more than one UPDATE_BATCH_SIZE, so the batched updates take several statements
+static constexpr int PAPER_COUNT = 250;
+
+static std::string paper_id(const int n)
+{
+	std::string number = std::to_string(n);
+	return "EB-24-" + std::string(5 - number.size(), '0') + number;
+}
+
+static std::string paper_filename(const int volume, const int issue, const int n)
+{
+	return "EB-24-V" + std::to_string(volume) + "-I" + std::to_string(issue) + "-P" + std::to_string(n) + ".pdf";
+}
+
+static std::string paper_path(const int volume, const int issue, const int n)
+{
+	return "/Pubs/EB/2024/Volume" + std::to_string(volume) + "/" + paper_filename(volume, issue, n);
+}
+
+// Reads back every row of the check schema, citationString included
+static std::map<std::string, sql_agent::PaperRow> read_table(sql_agent::PaperStore& store)
+{
+	std::map<std::string, sql_agent::PaperRow> rows;
+	store.for_each_paper([&](const sql_agent::PaperRow& row) { rows[row.id] = row; });
+	return rows;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " <username> <password> [schema] [host] [port]" << std::endl;
+		return 2;
+	}
+	const std::string username = argv[1];
+	const std::string password = argv[2];
+	const std::string schema = (argc > 3) ? argv[3] : "quickfix_check";
+	const std::string host = (argc > 4) ? argv[4] : "127.0.0.1";
+	const unsigned int port = (argc > 5) ? static_cast<unsigned int>(std::stoul(argv[5])) : 33060;
+	if (schema.rfind("quickfix_check", 0) != 0) {
+		std::cerr << "The schema is dropped at the end, its name has to start with quickfix_check" << std::endl;
+		return 2;
+	}
+
+	logging::Options log_options;
+	log_options.min_level = logging::Level::Warning;
+	logging::Session log_session(log_options);
+
+	int failures = 0;
+	auto expect = [&](const bool ok, const std::string& what) {
+		std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+		if (!ok) { failures += 1; }
+	};
+
+	std::unique_ptr<mysqlx::Session> admin;
+	try {
+		admin = std::make_unique<mysqlx::Session>(
+			mysqlx::SessionOption::HOST, host,
+			mysqlx::SessionOption::PORT, port,
+			mysqlx::SessionOption::USER, username,
+			mysqlx::SessionOption::PWD, password);
+
+		// The columns the stores read and an issue run writes, as text like the live table
+		admin->sql("DROP SCHEMA IF EXISTS `" + schema + "`").execute();
+		admin->sql("CREATE SCHEMA `" + schema + "`").execute();
+		admin->sql("CREATE TABLE `" + schema + "`.tablepaper (ID VARCHAR(32) PRIMARY KEY, Published_PDF_File VARCHAR(255), "
+				   "NumberOfPages VARCHAR(16), TotalNumpages VARCHAR(16), citationString VARCHAR(255), Volume_Number VARCHAR(32), "
+				   "NumIssue VARCHAR(8), TotalPaper VARCHAR(8), Publish_Date VARCHAR(32), Status_date VARCHAR(32)) ENGINE=InnoDB").execute();
+		admin->sql("CREATE TABLE `" + schema + "`.tablepaperofarticles (Article_ID VARCHAR(32) PRIMARY KEY, Title TEXT, Abstract TEXT) ENGINE=InnoDB").execute();
+
+		for (int n = 1; n <= PAPER_COUNT; ++n) {
+			admin->sql("INSERT INTO `" + schema + "`.tablepaper (ID, Published_PDF_File, NumberOfPages, TotalNumpages, citationString) "
+					   "VALUES (?, ?, ?, ?, ?)")
+				.bind(paper_id(n), paper_path(44, 1, n), std::to_string(10), std::to_string(10 * n), "2024, Volume 44, Issue 1")
+				.execute();
+			admin->sql("INSERT INTO `" + schema + "`.tablepaperofarticles (Article_ID, Title, Abstract) VALUES (?, ?, ?)")
+				.bind(paper_id(n), "Title " + std::to_string(n), "Abstract " + std::to_string(n))
+				.execute();
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Unable to set up " << schema << " on mysqlx://" << host << ":" << port << ": " << e.what() << std::endl;
+		return 2;
+	}
+	std::cout << "Set up " << schema << " with " << PAPER_COUNT << " papers on mysqlx://" << host << ":" << port << std::endl;
+
+	try {
+		sql_agent::XDevApiPaperStore store(host, port, username, password, schema);
+
+		// More filenames than one IN list holds, most of them unknown
+		std::vector<std::string> filenames;
+		for (int n = 1; n <= 2 * static_cast<int>(sql_agent::PREFETCH_BATCH_SIZE); n += 2) { filenames.push_back(paper_filename(44, 1, n)); }
+		std::vector<sql_agent::PaperRow> rows = store.find_by_filenames(filenames);
+		std::set<std::string> found;
+		for (const auto& row : rows) { found.insert(row.id); }
+		expect(rows.size() == (PAPER_COUNT + 1) / 2 && found.count(paper_id(1)) == 1 && found.count(paper_id(2)) == 0,
+			   "find_by_filenames over " + std::to_string(filenames.size()) + " filenames finds the " + std::to_string(rows.size()) + " odd papers");
+		expect(!rows.empty() && rows[0].number_of_pages == "10" && rows[0].total_numpages == std::to_string(10 * std::stoi(rows[0].id.substr(6))),
+			   "find_by_filenames reads NumberOfPages and TotalNumpages");
+
+		store.fill_articles(rows);
+		expect(!rows.empty() && rows[0].title == "Title " + std::to_string(std::stoi(rows[0].id.substr(6))) && rows[0].abstract.rfind("Abstract ", 0) == 0,
+			   "fill_articles fills title and abstract");
+
+		sql_agent::PaperRow last;
+		expect(store.find_last_paper("/Pubs/EB/2024/Volume44", 7, last) && last.id == paper_id(7), "find_last_paper finds paper 7 of volume 44");
+		expect(!store.find_last_paper("/Pubs/EB/2024/Volume45", 7, last), "find_last_paper finds nothing in volume 45");
+
+		// Two column lists, so update_batch sends a CASE statement per group and batch
+		std::vector<sql_agent::PaperUpdate> updates;
+		for (int n = 1; n <= PAPER_COUNT; ++n) {
+			sql_agent::PaperUpdate& update = updates.emplace_back(paper_id(n));
+			update.set("Published_PDF_File", paper_path(44, 2, n)).set("citationString", "2024, Volume 44, Issue 2");
+			if (n % 3 == 0) { update.set("TotalNumpages", std::to_string(1000 + n)); }
+		}
+
+		store.begin();
+		int affected = store.update_batch(updates);
+		expect(affected == PAPER_COUNT, "update_batch changes all " + std::to_string(PAPER_COUNT) + " rows (" + std::to_string(affected) + ")");
+		std::map<std::string, sql_agent::PaperRow> updated = read_table(store);
+		expect(updated[paper_id(3)].total_numpages == "1003" && updated[paper_id(4)].total_numpages == "40" &&
+			   updated[paper_id(PAPER_COUNT)].published_pdf_file == paper_path(44, 2, PAPER_COUNT) &&
+			   updated[paper_id(1)].citation_string == "2024, Volume 44, Issue 2",
+			   "update_batch writes each paper its own values");
+		expect(store.find_by_filenames({ paper_filename(44, 2, 5) }).size() == 1, "find_by_filenames sees the new filenames inside the transaction");
+
+		store.rollback();
+		std::map<std::string, sql_agent::PaperRow> restored = read_table(store);
+		expect(restored[paper_id(3)].total_numpages == "30" && restored[paper_id(PAPER_COUNT)].published_pdf_file == paper_path(44, 1, PAPER_COUNT) &&
+			   restored[paper_id(1)].citation_string == "2024, Volume 44, Issue 1",
+			   "rollback restores every row");
+		expect(store.find_by_filenames({ paper_filename(44, 2, 5) }).empty(), "find_by_filenames no longer sees the new filenames");
+
+		store.begin();
+		store.update_batch(updates);
+		store.commit();
+		sql_agent::XDevApiPaperStore other(host, port, username, password, schema);
+		std::map<std::string, sql_agent::PaperRow> committed = read_table(other);
+		expect(committed.size() == PAPER_COUNT && committed[paper_id(6)].total_numpages == "1006" &&
+			   committed[paper_id(7)].published_pdf_file == paper_path(44, 2, 7),
+			   "commit makes the updates visible to another session");
+
+		sql_agent::PaperUpdate single(paper_id(1));
+		single.set("NumIssue", "2").set("Volume_Number", "202444000002");
+		expect(store.update(single) == 1, "update sends a single paper");
+	} catch (const std::exception& e) {
+		expect(false, std::string("no exception from the store: ") + e.what());
+	}
+
+	try {
+		admin->sql("DROP SCHEMA IF EXISTS `" + schema + "`").execute();
+	} catch (const std::exception& e) {
+		std::cerr << "Unable to drop " << schema << ": " << e.what() << std::endl;
+	}
+
+	std::cout << (failures == 0 ? "All checks passed." : std::to_string(failures) + " checks failed.") << std::endl;
+	return (failures == 0) ? 0 : 1;
+}
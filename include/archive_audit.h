@@ -0,0 +1,38 @@
+#pragma once
+
+#include "paper_store.h"
+#include "archive_scan.h"
+#include "rdf_index.h"
+#include "json.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <charconv>
+
+namespace audit
+{
+	// One disagreement between the database, the archive and the rdfs
+	struct Finding
+	{
+		// "missing_file", "unreferenced_file", "invalid_path", "wrong_citation", "missing_rdf",
+		// "stale_url", "wrong_pages", "wrong_volume" or "wrong_issue"
+		std::string kind;
+		// Empty for files no row refers to
+		std::string id;
+		// Published_PDF_File of the row, or the archive path of an unreferenced file
+		std::string path;
+		// What the row's Published_PDF_File and page numbers call for, and what was found instead
+		std::string expected;
+		std::string found;
+	};
+
+	// Joins the tablepaper rows, the papers of the archive and the rdfs on the paper id and
+	// Published_PDF_File, and returns every mismatch ordered by id and kind
+	// Rows without a Published_PDF_File are not published yet and are left out
+	std::vector<Finding> compare(const std::vector<sql_agent::PaperRow>&, const std::vector<file::ArchivePaper>&, const rdf::RdfIndex&);
+
+	// Writes the findings as a JSON document along with how many rows, files and rdfs were
+	// compared and the number of findings of each kind
+	std::string serialize_findings(const std::vector<Finding>&, const size_t, const size_t, const size_t);
+}
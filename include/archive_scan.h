@@ -0,0 +1,40 @@
+#pragma once
+
+#include "file_actions.h"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace file
+{
+	// A paper found in the archive at <root>/<publication>/<YYYY>/Volume<NN>/<filename>
+	struct ArchivePaper
+	{
+		// Relative to the root of the archive, e.g. "EB/2024/Volume44"
+		std::string directory;
+		std::string filename;
+		PaperFilename key;
+		// The year and volume of the directories holding the paper, which may disagree with its filename
+		int year;
+		int volume;
+	};
+
+	// Receives the papers of one Volume<NN> directory at a time
+	// Called from the scanning threads, possibly by several of them at once
+	using ArchiveConsumer = std::function<void(std::vector<ArchivePaper>&)>;
+
+	// Walks <root>/<publication>/<YYYY>/Volume<NN> on the given number of threads and hands every
+	// .pdf following the naming convention to the consumer as soon as its directory was read
+	// Entries are typed from the directory listing itself, so files are never stat'ed, and names
+	// that do not match their level are skipped without being copied
+	// Directories that cannot be read are reported and skipped, returns the number of papers found
+	size_t scan_archive(const std::string&, const size_t, const ArchiveConsumer&);
+
+	// Collects every paper of the archive, in no particular order
+	std::vector<ArchivePaper> scan_archive(const std::string&, const size_t);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <atomic>
+
+namespace file
+{
+	namespace fs = std::filesystem;
+
+	// Whether a committed file is flushed to disk before it replaces the target
+	enum class SyncPolicy {
+		None,
+		Flush
+	};
+
+	// Writes a file by filling a unique temp file in the same directory as the target,
+	// then replacing the target with a single rename once everything was written
+	// The target keeps its permissions and ownership, and readers never see a partial file
+	class AtomicFileWriter
+	{
+	public:
+		// Text mode matches the line endings written by a plain std::ofstream
+		AtomicFileWriter(const std::string&, const SyncPolicy = SyncPolicy::None,
+						 const std::ios::openmode = std::ios::out);
+
+		AtomicFileWriter(const AtomicFileWriter&) = delete;
+		AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+		std::ostream& stream();
+		void write(std::string_view);
+
+		// Replaces the target with the temp file, throws std::runtime_error if it fails
+		void commit();
+
+		const std::string& get_temp_path() const;
+
+		// Removes the temp file if the writer was never committed
+		~AtomicFileWriter();
+	private:
+		std::string m_target;
+		std::string m_temp;
+		SyncPolicy m_sync;
+		std::ofstream m_stream;
+		bool m_committed;
+	};
+
+	// Unique name for a temp file in the same directory as the target
+	std::string sibling_temp_path(const std::string&);
+
+	// Moves a finished temp file over the target in a single step, keeping the target's permissions
+	// For files written by other programs, throws std::runtime_error if it fails
+	void replace_file(const std::string&, const std::string&, const SyncPolicy = SyncPolicy::None);
+
+	// Replaces the contents of a file through an AtomicFileWriter, binary files pass std::ios::binary
+	void write_file_atomic(const std::string&, std::string_view, const SyncPolicy = SyncPolicy::None,
+						   const std::ios::openmode = std::ios::out);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+namespace file
+{
+	// XXH64 of data fed in pieces, the same as hashing the pieces joined together
+	// Several GB/s, so hashing a published paper costs far less than reading it from disk
+	class Xxh64
+	{
+	public:
+		explicit Xxh64(const uint64_t = 0);
+
+		Xxh64& update(std::string_view);
+
+		// Values that are not text are hashed through their bytes
+		Xxh64& update(const uint64_t);
+
+		uint64_t digest() const;
+	private:
+		std::array<uint64_t, 4> m_lanes;
+		uint64_t m_seed;
+		uint64_t m_length = 0;
+		// Input that did not fill a 32 byte stripe yet
+		std::array<unsigned char, 32> m_buffer{};
+		size_t m_buffered = 0;
+	};
+
+	uint64_t xxh64(std::string_view, const uint64_t = 0);
+
+	// Hashes a file in chunks without loading all of it, returns false if it cannot be read
+	bool hash_file(const std::string&, uint64_t&);
+}
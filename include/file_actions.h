@@ -2,32 +2,74 @@
 
 #include <iostream>
 #include <filesystem>
-#include <regex>
 #include <cassert>
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <cctype>
+#include <charconv>
 
 namespace file
 {
 	namespace fs = std::filesystem;
 
+	// Position of a number within a filename, as [begin, end)
+	struct FieldSpan { uint16_t begin; uint16_t end; };
+
+	// Fields of a paper's filename following the convention: EB-24-V44-I1-P26.pdf
+	// The spans locate each number so the filename can be rewritten without searching it again
+	struct PaperFilename
+	{
+		uint16_t acronym_len;
+		int year;
+		int volume;
+		int issue;
+		int paper;
+		FieldSpan year_span;
+		FieldSpan volume_span;
+		FieldSpan issue_span;
+		FieldSpan paper_span;
+	};
+
+	// A .pdf entry of a directory along with its parsed filename
+	struct PaperEntry
+	{
+		fs::directory_entry entry;
+		std::string filename;
+		PaperFilename key;
+	};
+
 	// Verifies the directory exists
 	bool directory_exists(const std::string&);
 
 	// Verifiesd the filetype is .pdf
 	bool is_pdf(const std::string&);
 
-	// Uses regex to determine proper numerical order and avoids cases 
+	// Parses a filename into its acronym, 2-digit year, volume, issue, and paper number 
+	// without allocating, returns false if the filename does not follow the convention
+	bool parse_filename(std::string_view, PaperFilename&);
+
+	// Orders by the parsed paper number and avoids cases 
 	// where -P9 is ordered after -P10, etc
-	bool compare_filenames(const fs::directory_entry&, 
-						   const fs::directory_entry&);
+	bool compare_filenames(const PaperEntry&, const PaperEntry&);
 
 	// Deterministically orders the files in vector by their paper number
-	void sort_files(std::vector<fs::directory_entry>&);
+	void sort_files(std::vector<PaperEntry>&);
+
+	// Fills a vector with the parsed entries for every .pdf in a directory
+	// Filenames that do not follow the convention are reported and left out
+	void build_file_vec(const std::string&, std::vector<PaperEntry>&);
+
+	// Writes the filename with the new year, volume, issue, and paper number into the 
+	// output buffer in a single pass, a negative paper number keeps the current one
+	void format_filename(std::string_view, const PaperFilename&, const int, 
+						 const int, const int, std::string&);
 
-	// Fills a vector with filenames entries for every .pdf in a directory
-	void build_file_vec(const std::string&, std::vector<fs::directory_entry>&);
+	// Renames the entry's filename in filesystem to the given filename
+	void rename_file(const fs::directory_entry&, const std::string&);
 
 	// Renames the entry's filename in filesystem with 
 	// the new year, volume, and issue number
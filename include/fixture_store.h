@@ -0,0 +1,57 @@
+#pragma once
+
+#include "paper_store.h"
+#include "json.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <fstream>
+
+namespace sql_agent
+{
+	// A PaperStore held in memory and loaded from a fixture dump, so that whole runs can be
+	// repeated and profiled without a database server, the fixture file is never written
+	// The dump is a JSON object of the two tables, each an array of rows of column -> value:
+	// { "tablepaper": [ { "ID": "...", "Published_PDF_File": "...", "NumberOfPages": "12", ... } ],
+	//   "tablepaperofarticles": [ { "Article_ID": "...", "Title": "...", "Abstract": "..." } ] }
+	class FixtureStore : public PaperStore
+	{
+	public:
+		// Reads the dump, throws std::runtime_error if it cannot be read and json::ParseError if it is malformed
+		explicit FixtureStore(const std::string&);
+
+		std::vector<PaperRow> find_by_filenames(const std::vector<std::string>&) override;
+		void fill_articles(std::vector<PaperRow>&) override;
+		bool find_last_paper(const std::string&, const int, PaperRow&) override;
+		void for_each_paper(const std::function<void(const PaperRow&)>&) override;
+		int update(const PaperUpdate&) override;
+		int update_batch(const std::vector<PaperUpdate>&) override;
+
+		// The rows are copied when the transaction begins and put back on rollback
+		void begin() override;
+		void commit() override;
+		void rollback() override;
+
+		// Current value of a column of a "tablepaper" row, empty if the row or column does not exist
+		std::string get_column(const std::string&, const std::string&) const;
+
+		size_t size() const;
+	private:
+		using Row = std::map<std::string, std::string>;
+
+		PaperRow to_paper_row(const Row&) const;
+
+		// Rows of "tablepaper" in the order of the dump, indexed by ID
+		std::vector<Row> m_papers;
+		std::unordered_map<std::string, size_t> m_by_id;
+		// Title and abstract of "tablepaperofarticles" by Article_ID
+		std::unordered_map<std::string, std::pair<std::string, std::string>> m_articles;
+
+		std::vector<Row> m_snapshot;
+		bool m_in_transaction = false;
+		mutable std::mutex m_mutex;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "title_page.h"
+#include <mutex>
+#include <memory>
+
+namespace pdf
+{
+	// Values a title page template can insert, written as {{name}} in the template
+	enum class TitleSlot {
+		Id,				// {{id}}
+		Title,			// {{title}}
+		Abstract,		// {{abstract}}
+		Authors,		// {{authors}}
+		Journal,		// {{journal}}
+		Volume,			// {{volume}}
+		Issue,			// {{issue}}
+		Year,			// {{year}}
+		FirstPage,		// {{first_page}}
+		LastPage,		// {{last_page}}
+		Pages,			// {{pages}}, e.g. 12-25
+		Published,		// {{published}}, e.g. March 30, 2024
+		Citation,		// {{citation}}
+		SlotCount
+	};
+
+	// Escapes &, <, >, " and ' so a value shows up as text
+	std::string escape_html(std::string_view);
+
+	// A title page html template compiled into its literal text and the offsets of its slots,
+	// rendering a page only copies the literal pieces and the values in between
+	// {{name}} inserts the escaped value, {{{name}}} inserts it as is for values already holding html
+	class HtmlTemplate
+	{
+	public:
+		// Throws std::runtime_error for unknown slots or unclosed braces
+		explicit HtmlTemplate(std::string_view);
+
+		std::string render(const TitlePageFields&) const;
+	private:
+		struct Slot
+		{
+			// Offset into m_literals where the slot is inserted
+			size_t offset;
+			TitleSlot slot;
+			bool escape;
+		};
+
+		std::string m_literals;
+		std::vector<Slot> m_slots;
+		std::array<bool, static_cast<size_t>(TitleSlot::SlotCount)> m_used{};
+	};
+
+	// Where the canonical title page template of a publication is kept
+	std::string get_template_path(const std::string&);
+
+	// Templates of every publication, each compiled the first time one of its papers needs it
+	class TitleTemplates
+	{
+	public:
+		// Returns nullptr if the publication has no template or it does not compile
+		const HtmlTemplate* find(const std::string&);
+	private:
+		std::mutex m_mutex;
+		// Publications without a usable template are kept as nullptr so they are only reported once
+		std::map<std::string, std::unique_ptr<HtmlTemplate>> m_templates;
+	};
+}
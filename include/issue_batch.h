@@ -0,0 +1,33 @@
+#pragma once
+
+#include "json.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+namespace pipeline
+{
+	// The numbers that select one issue, as given on the command line or as one entry of a job file
+	struct IssueJob
+	{
+		std::string directory;
+		int volume;
+		int issue;
+		// Sequence number of the last paper already published to the volume, 0 for a new volume
+		int last_article;
+		int title_offset;
+		// Acronym of the publication, e.g. "EB", empty when it is taken from the filenames
+		std::string publication;
+	};
+
+	// Reads a job file, throws json::ParseError if it is malformed:
+	// { "issues": [ { "directory": "...", "volume": 44, "issue": 2, "last_article": 26,
+	//                 "title_offset": 1, "publication": "EB" }, ... ] }
+	std::vector<IssueJob> parse_jobs(std::string_view);
+
+	// Groups the jobs by publication and volume, keeping the order of the job file inside a group
+	// An issue continues the paper numbers and page ranges its volume was left with, so the issues
+	// of a group run one after another while different groups may run at the same time
+	std::vector<std::vector<size_t>> group_jobs(const std::vector<IssueJob>&);
+}
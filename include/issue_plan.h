@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pipeline.h"
+#include "json.h"
+
+namespace pipeline
+{
+	// Everything an issue run would change, computed without touching the database or the files
+	// Written by --plan and executed as it is by --apply
+	struct IssuePlan
+	{
+		std::string directory;
+		IssueSettings settings;
+		std::vector<PaperPlan> papers;
+	};
+
+	// Writes the plan as a JSON document, one object per paper with its new filename, page range,
+	// column values, rdf field values and how its title pages are produced
+	std::string serialize_plan(const IssuePlan&);
+
+	// Reads a plan written by serialize_plan, throws json::ParseError if it is malformed
+	// The sync policy of the settings is left to the caller
+	IssuePlan parse_plan(std::string_view);
+
+	// Checks that every file the plan reads or replaces is where it expects it to be
+	// Steps the journal has as completed are not checked, their files were already changed
+	// Returns one message per problem, empty when the plan can be applied
+	std::vector<std::string> preflight(const IssuePlan&, const StepJournal* = nullptr);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+
+namespace json
+{
+	// Thrown for malformed documents, the message holds the offset of the problem
+	class ParseError : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// A JSON value, objects keep their members in the order they were set so written files
+	// read the same way every time, numbers are limited to integers since that is all plans hold
+	class Value
+	{
+	public:
+		enum class Type {
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Value() = default;
+		Value(const bool);
+		Value(const int);
+		Value(const long long);
+		Value(const char*);
+		Value(std::string);
+
+		static Value make_array();
+		static Value make_object();
+
+		Type get_type() const;
+
+		// Accessors throw ParseError when the value has a different type, so a
+		// document of the wrong shape is reported like one that does not parse
+		bool as_bool() const;
+		long long as_int() const;
+		const std::string& as_string() const;
+		const std::vector<Value>& as_array() const;
+		const std::vector<std::pair<std::string, Value>>& as_object() const;
+
+		// Appends to an array
+		Value& push_back(Value);
+
+		// Replaces the value of a member or appends it
+		Value& set(const std::string&, Value);
+
+		// Returns nullptr if the object has no such member
+		const Value* find(std::string_view) const;
+
+		// Throws ParseError if the object has no such member
+		const Value& at(std::string_view) const;
+
+		// Writes the value with two spaces of indentation per level
+		std::string dump() const;
+
+		// Throws ParseError for anything that is not a single JSON value
+		static Value parse(std::string_view);
+	private:
+		void dump(std::string&, const int) const;
+
+		Type m_type = Type::Null;
+		bool m_bool = false;
+		long long m_number = 0;
+		std::string m_string;
+		std::vector<Value> m_items;
+		std::vector<std::pair<std::string, Value>> m_members;
+	};
+}
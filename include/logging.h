@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <filesystem>
+
+namespace logging
+{
+	enum class Level : uint8_t {
+		Debug,
+		Info,
+		Warning,
+		Error
+	};
+
+	// Returns the level for "debug", "info", "warning" or "error", false for anything else
+	bool parse_level(std::string_view, Level&);
+
+	struct Options
+	{
+		// Info and debug records go to stdout, warnings and errors to stderr
+		bool console = true;
+		// Every console record goes to stderr, for modes whose stdout carries their results
+		bool console_stderr_only = false;
+		// Also appends every record to this file when set, with a timestamp and level
+		std::string file_path;
+		// The file is rotated to <file>.1, <file>.2, ... once it would grow past this size
+		uint64_t max_file_bytes = 16 * 1024 * 1024;
+		// Number of rotated files kept next to the current one
+		size_t max_files = 4;
+		Level min_level = Level::Info;
+	};
+
+	// Starts the thread that writes the records, records logged before start() or after stop()
+	// are written by the calling thread instead
+	void start(const Options&);
+
+	// Writes every queued record and joins the writer thread
+	void stop();
+
+	// Starts logging for the lifetime of the object
+	class Session
+	{
+	public:
+		explicit Session(const Options&);
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+		~Session();
+	};
+
+	// Tags every record the calling thread logs during its lifetime with a paper id and stage,
+	// e.g. "rdf", nested tags replace the outer one until they go out of scope
+	class Context
+	{
+	public:
+		Context(const std::string&, const char*);
+		Context(const Context&) = delete;
+		Context& operator=(const Context&) = delete;
+		~Context();
+	private:
+		std::string m_previous_paper;
+		const char* m_previous_stage;
+	};
+
+	// True if records of the level are written at all
+	bool enabled(const Level);
+
+	// Queues a record tagged with the calling thread's context, never waits for any output
+	// The records of one thread are written in the order they were logged
+	void write(const Level, std::string);
+
+	// Collects one record with operator<< and queues it when it goes out of scope
+	// Nothing is formatted for levels that are not written
+	class Line
+	{
+	public:
+		explicit Line(const Level);
+		Line(const Line&) = delete;
+		Line& operator=(const Line&) = delete;
+		~Line();
+
+		template <typename T>
+		Line& operator<<(const T& value)
+		{
+			if (m_enabled) { m_text << value; }
+			return *this;
+		}
+	private:
+		Level m_level;
+		bool m_enabled;
+		std::ostringstream m_text;
+	};
+
+	inline Line debug() { return Line(Level::Debug); }
+	inline Line info() { return Line(Level::Info); }
+	inline Line warning() { return Line(Level::Warning); }
+	inline Line error() { return Line(Level::Error); }
+}
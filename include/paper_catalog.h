@@ -0,0 +1,33 @@
+#pragma once
+
+#include "paper_store.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace sql_agent
+{
+	// In-memory copy of every row needed for the papers of a directory,
+	// loaded with set-based queries instead of one table scan per lookup
+	class PaperCatalog
+	{
+	public:
+		// Loads the rows whose Published_PDF_File ends with any of the given filenames
+		// along with the title and abstract of each of those papers
+		void prefetch(PaperStore&, const std::vector<std::string>&);
+
+		// Returns nullptr when no row was loaded for the filename or id
+		const PaperRow* find_by_filename(const std::string&) const;
+		const PaperRow* find_by_id(const std::string&) const;
+
+		size_t size() const;
+	private:
+		// Rows are only ever appended, the indexes below store positions into m_rows
+		std::vector<PaperRow> m_rows;
+		std::unordered_map<std::string, size_t> m_by_filename;
+		std::unordered_map<std::string, size_t> m_by_id;
+	};
+
+	// Returns the last path component of a Published_PDF_File value
+	std::string basename_of(const std::string&);
+}
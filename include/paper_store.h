@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <cassert>
+#include <cctype>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+namespace sql_agent
+{
+	// Fields the main loop needs for a single paper, joined from the
+	// "tablepaper" and "tablepaperofarticles" tables
+	struct PaperRow
+	{
+		std::string id;
+		std::string published_pdf_file;
+		std::string number_of_pages;
+		std::string total_numpages;
+		// Only filled by PaperStore::for_each_paper
+		std::string citation_string;
+		std::string title;
+		std::string abstract;
+	};
+
+	// Gathers every changed column of a single paper so they can be sent to
+	// the "tablepaper" table as one parameterized UPDATE
+	class PaperUpdate
+	{
+	public:
+		PaperUpdate(const std::string);
+
+		// Queues a new value for a column, replacing any value already queued for it
+		// Throws std::invalid_argument if the name is not a bare column name
+		PaperUpdate& set(const std::string, const std::string);
+
+		bool empty() const;
+		const std::string& get_id() const;
+		const std::vector<std::pair<std::string, std::string>>& get_fields() const;
+	private:
+		std::string m_id;
+		std::vector<std::pair<std::string, std::string>> m_fields;
+	};
+
+	// Upper bound on the placeholders sent in a single IN (...) list
+	constexpr size_t PREFETCH_BATCH_SIZE = 500;
+
+	// Papers sent in a single set-based UPDATE unless the caller asks otherwise
+	constexpr size_t UPDATE_BATCH_SIZE = 100;
+
+	// A statement along with the values bound to its placeholders, in order
+	struct BoundStatement
+	{
+		std::string query;
+		std::vector<std::string> params;
+	};
+
+	// Builds "(?, ?, ..., ?)" for the given number of placeholders
+	std::string placeholder_list(const size_t);
+
+	// Builds: UPDATE tablepaper SET a = ?, b = ?, ... WHERE id = ?
+	BoundStatement build_update(const PaperUpdate&);
+
+	// Builds the updates of many papers as few statements, papers with the same column list share
+	// UPDATE tablepaper SET a = CASE id WHEN ? THEN ? ... END, ... WHERE id IN (?, ...)
+	// with at most the given number of papers per statement
+	std::vector<BoundStatement> build_batch_updates(const std::vector<PaperUpdate>&, const size_t = UPDATE_BATCH_SIZE);
+
+	// Every database operation the pipeline needs, so it can run against the MySQL server
+	// or against an in-memory fixture without a server in the loop
+	// Failures throw std::runtime_error, which sql::SQLException derives from
+	class PaperStore
+	{
+	public:
+		virtual ~PaperStore() = default;
+
+		// The "tablepaper" rows whose Published_PDF_File ends with any of the given filenames,
+		// title and abstract are left empty
+		virtual std::vector<PaperRow> find_by_filenames(const std::vector<std::string>&) = 0;
+
+		// Fills the title and abstract of each row from the "tablepaperofarticles" table
+		virtual void fill_articles(std::vector<PaperRow>&) = 0;
+
+		// Finds the paper with the given sequence number published in a volume directory,
+		// e.g. "/Pubs/EB/2024/Volume44", returns false if there is none
+		virtual bool find_last_paper(const std::string&, const int, PaperRow&) = 0;
+
+		// Hands every "tablepaper" row to the callback as it is read, without holding the table in memory,
+		// title and abstract are left empty and the citationString is filled
+		// No other call may be made on the store until it returns
+		virtual void for_each_paper(const std::function<void(const PaperRow&)>&) = 0;
+
+		// Sends every queued column of the paper, returns the affected row count
+		virtual int update(const PaperUpdate&) = 0;
+
+		// Sends the updates of many papers in as few round trips as the store allows
+		virtual int update_batch(const std::vector<PaperUpdate>&) = 0;
+
+		// Groups every update sent until commit() or rollback() into one transaction
+		virtual void begin() = 0;
+		virtual void commit() = 0;
+		virtual void rollback() = 0;
+	};
+
+	// Opens a transaction on the store for the lifetime of the object so that every
+	// update sent in between is committed at once, rolls back if never committed
+	class Transaction
+	{
+	public:
+		Transaction(PaperStore&);
+
+		void commit();
+		void rollback();
+
+		~Transaction();
+	private:
+		PaperStore& m_store;
+		bool m_active;
+	};
+
+	// A fixed set of open stores shared by the issues of a batch, so every connection
+	// is set up once and stays warm for the issues that follow
+	class PaperStorePool
+	{
+	public:
+		explicit PaperStorePool(std::vector<std::unique_ptr<PaperStore>>);
+
+		// Hands a store to a single caller and returns it to the pool when it goes out of scope
+		class Lease
+		{
+		public:
+			Lease(PaperStorePool&, PaperStore&);
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+			~Lease();
+
+			PaperStore& get();
+		private:
+			PaperStorePool& m_pool;
+			PaperStore& m_store;
+		};
+
+		// Waits until a store is free
+		Lease acquire();
+
+		size_t size() const;
+	private:
+		std::vector<std::unique_ptr<PaperStore>> m_stores;
+		std::vector<PaperStore*> m_free;
+		std::mutex m_mutex;
+		std::condition_variable m_released;
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+	// Number of threads to use when the caller did not ask for a specific count
+	size_t default_jobs();
+
+	// Calls the task for every index in [0, count) on at most the given number of threads
+	// The calling thread takes part, exceptions thrown by a task are reported and do not stop the others
+	void for_each_index(const size_t, const size_t, const std::function<void(size_t)>&);
+}
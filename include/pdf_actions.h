@@ -1,5 +1,9 @@
 #pragma once
 
+#include "atomic_file.h"
+#include "process_runner.h"
+#include "html_template.h"
+#include "render_cache.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -47,29 +51,49 @@ namespace pdf
 
 	// Updates the stand-alone title page in the html format
 	// This does NOT update the publication paper itself
-	void update_html(const std::string&, const int, const int, 
+	// Returns false if the page could not be read or replaced
+	bool update_html(const std::string&, const int, const int, 
 					 const std::array<std::string,2>&, 
-					 std::array<std::string,2>&);
+					 std::array<std::string,2>&,
+					 const file::SyncPolicy = file::SyncPolicy::None);
+
+	// Regenerates the stand-alone title page in the html format from the publication's template,
+	// in place of update_html(), pages that drifted from the canonical layout are written anew
+	bool regenerate_html(const pdf::HtmlTemplate&, const pdf::TitlePageFields&,
+						 const file::SyncPolicy = file::SyncPolicy::None);
 
 	// Updates the stand-alone title page in the pdf format 
 	// by converting the updated html title
 	// This does NOT update the publication paper itself
-	void update_pdf(const std::string&);
+	// With a cache the converter is skipped if the html is unchanged since it was last converted
+	// Returns false if the conversion failed
+	bool update_pdf(const std::string&, process::ProcessRunner&, pdf::RenderCache* = nullptr);
+
+	// Writes the stand-alone title page in the pdf format straight from the paper's fields,
+	// in place of update_pdf(), returns false if the paper's publication has no layout
+	// or its text has characters the title page fonts cannot show
+	bool write_title_pdf(const pdf::TitlePageRenderer&, const pdf::TitlePageFields&,
+						 const file::SyncPolicy = file::SyncPolicy::None);
 
 	// Determine the full path of the targeted paper
-	// If the file is moved before the script is run, 
+	// If the directory is moved before the script is run, 
 	// this will return return an empty string
-	// If the script is run a second time after being 
-	// moved it will provide a path string
+	// The entry itself is usually gone by now, 
+	// it was renamed to the given filename
 	std::string get_pub_paper_path(const fs::directory_entry, 
 								   const std::string&, const std::string);
 
-	// Uses a title offset to determine where the actual paper begins 
-	// and removes any pages before this number
-	void remove_title_page(const fs::directory_entry, const std::string&, 
-						   const std::string, const int);
+	// Replaces the pages before the title offset with the stand-alone title page .pdf in a single
+	// in-process splice, falls back to fuse_title_page() for pdfs it cannot read
+	// With a cache nothing is done if the paper already is the result of splicing in the same title page
+	// Returns false if the paper was left as it was
+	bool replace_title_page(const fs::directory_entry, const std::string&, 
+							const std::string, const int, process::ProcessRunner&,
+							const file::SyncPolicy = file::SyncPolicy::None, pdf::RenderCache* = nullptr);
 
-	// Concatenates a stand-alone title page .pdf with the paper .pdf
-	void update_title_page(const fs::directory_entry, const std::string&, 
-						   const std::string);
+	// Replaces the pages before the title offset with the stand-alone title page .pdf in a single
+	// ghostscript run that reads only the pages from the title offset on, returns false if the paper was left as it was
+	bool fuse_title_page(const fs::directory_entry, const std::string&, 
+						 const std::string, const int, process::ProcessRunner&,
+						 const file::SyncPolicy = file::SyncPolicy::None);
 }
\ No newline at end of file
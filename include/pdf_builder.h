@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pdf_document.h"
+
+namespace pdf
+{
+	// Writes numbered objects one after another and finishes the file with a classic xref table
+	class PdfBuilder
+	{
+	public:
+		explicit PdfBuilder(const std::string&);
+
+		// Reserves the next object number, objects may be written in any order
+		int allocate();
+
+		void write(const int, const PdfObject&);
+
+		// Appends the xref and the trailer, the builder is empty afterwards
+		std::string finish(const PdfObject&);
+
+		int get_size() const;
+	private:
+		std::string m_out;
+		std::vector<size_t> m_offsets;
+	};
+}
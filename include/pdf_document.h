@@ -0,0 +1,163 @@
+#pragma once
+
+#include "pdf_flate.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdio>
+
+namespace pdf
+{
+	// Thrown for pdfs that cannot be read natively, e.g. encrypted or damaged beyond repair
+	class PdfError : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// A parsed pdf object, tokens are kept the way they were written so
+	// strings, names, and numbers are copied back out without re-encoding them
+	struct PdfObject
+	{
+		enum class Kind {
+			Null,
+			Boolean,
+			Number,
+			String,
+			Name,
+			Array,
+			Dictionary,
+			Reference,
+			Stream
+		};
+
+		Kind kind = Kind::Null;
+		// Raw token of booleans, numbers, strings, and names, e.g. "/Type" or "(Title)"
+		std::string text;
+		// Object and generation number of references
+		int num = 0;
+		int gen = 0;
+		// Array items, or dictionary values in the order of their keys
+		std::vector<PdfObject> items;
+		// Dictionary keys, including the leading '/'
+		std::vector<std::string> keys;
+		// Raw, still encoded data of a stream, a stream's dictionary is held in keys and items
+		std::string_view stream;
+
+		bool is_dictionary() const { return kind == Kind::Dictionary || kind == Kind::Stream; }
+
+		// Returns nullptr if the dictionary has no such key
+		const PdfObject* get(std::string_view) const;
+
+		// Replaces the value of a key or appends it
+		void set(const std::string&, PdfObject);
+
+		void erase(std::string_view);
+
+		static PdfObject make_name(const std::string&);
+		static PdfObject make_number(const long long);
+		static PdfObject make_reference(const int);
+		// Written with two decimals, enough for positions and sizes in points
+		static PdfObject make_real(const double);
+		// Escapes the bytes into a literal string
+		static PdfObject make_string(std::string_view);
+		static PdfObject make_array();
+		static PdfObject make_dictionary();
+	};
+
+	// Writes an object the way it would appear in a pdf body, streams include their data
+	void serialize(const PdfObject&, std::string&);
+
+	// Reads a whole file into memory, throws PdfError if it cannot be opened
+	std::string read_pdf(const std::string&);
+
+	// Read-only access to the objects and pages of a pdf
+	// Reads classic xref tables, xref streams, object streams, and incremental updates,
+	// and rebuilds the xref by scanning the file when it is missing or does not match
+	class PdfDocument
+	{
+	public:
+		// Takes the whole file, throws PdfError if the pdf cannot be read
+		explicit PdfDocument(std::string);
+
+		// Parsed streams point into the file's data
+		PdfDocument(const PdfDocument&) = delete;
+		PdfDocument& operator=(const PdfDocument&) = delete;
+
+		// Version from the header, or the catalog if it was raised by an incremental update
+		std::string get_version() const;
+
+		const PdfObject& get_trailer() const;
+
+		// Returns a null object for free or missing objects
+		const PdfObject& get_object(const int);
+
+		// Follows a reference, anything else is returned as is
+		const PdfObject& resolve(const PdfObject&);
+
+		// Integer value of a number or a reference to one
+		long long resolve_int(const PdfObject&);
+
+		// Decodes a stream whose filters are limited to /FlateDecode, throws PdfError otherwise
+		std::string decode_stream(const PdfObject&);
+
+		// Page objects in reading order, with /Resources, /MediaBox, /CropBox, and /Rotate
+		// inherited from the page tree copied into every page that does not set them
+		struct Page
+		{
+			int num;
+			PdfObject dict;
+		};
+		const std::vector<Page>& get_pages();
+
+		// Object numbers of every node in the page tree, pages included
+		const std::unordered_set<int>& get_page_tree();
+
+		// Number of entries in the xref, one more than the highest object number
+		int get_size() const;
+	private:
+		struct XrefEntry
+		{
+			// 0 = free, 1 = at an offset in the file, 2 = inside an object stream
+			int type = 0;
+			size_t offset = 0;
+			int stream_num = 0;
+			int index = 0;
+		};
+
+		void read_xref();
+		void read_xref_section(size_t, std::unordered_set<size_t>&);
+		void read_xref_table(size_t&);
+		void read_xref_stream(const PdfObject&);
+		void rebuild_xref();
+		void set_entry(const int, const XrefEntry&);
+
+		PdfObject parse_indirect(size_t, int&);
+		PdfObject load_object(const int);
+		PdfObject load_compressed(const XrefEntry&, const int);
+
+		void collect_pages(const PdfObject&, const PdfObject&, const int);
+
+		std::string m_data;
+		std::string m_version;
+		std::vector<XrefEntry> m_xref;
+		// Entries found in newer sections take precedence over the ones they replace
+		std::vector<bool> m_xref_set;
+		PdfObject m_trailer;
+		bool m_rebuilt = false;
+
+		std::unordered_map<int, PdfObject> m_objects;
+		std::unordered_map<int, std::string> m_object_streams;
+		// Objects being loaded, guards against streams whose /Length refers back to themselves
+		std::unordered_set<int> m_loading;
+
+		std::vector<Page> m_pages;
+		std::unordered_set<int> m_page_tree;
+		bool m_pages_read = false;
+	};
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace pdf
+{
+	// Decompresses a /FlateDecode stream, with or without the zlib header
+	// Returns false if the data is corrupt or ends before the last block
+	bool inflate(std::string_view, std::string&);
+
+	// Reverses the PNG predictors (/Predictor 10 to 15) of a decompressed stream in place
+	// Returns false if the rows do not add up or a row uses an unknown filter type
+	bool undo_png_predictor(std::string&, const int, const int, const int);
+}
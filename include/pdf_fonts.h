@@ -0,0 +1,73 @@
+#pragma once
+
+#include "pdf_builder.h"
+#include <array>
+#include <map>
+#include <cmath>
+#include <filesystem>
+
+namespace pdf
+{
+	namespace fs = std::filesystem;
+
+	// Converts UTF-8 text to the single-byte WinAnsiEncoding every title page font is written in
+	// Bytes that are not valid UTF-8 are taken as Windows-1252, characters it cannot hold become '?'
+	// and the first of them is stored in the given code point when set
+	std::string to_win_ansi(std::string_view, uint32_t* = nullptr);
+
+	// Standard fonts every pdf viewer provides, used when no font file can be embedded
+	enum class StandardFont {
+		TimesRoman,
+		TimesBold,
+		TimesItalic,
+		Helvetica,
+		HelveticaBold,
+		HelveticaOblique
+	};
+
+	// A font for WinAnsi text, either a standard font or a TrueType font that is parsed once
+	// and embedded into each document with only the glyphs of the characters it uses
+	class Font
+	{
+	public:
+		// Throws PdfError if the file is not a TrueType font or its license does not permit embedding
+		static Font load_truetype(const std::string&);
+
+		static Font standard(const StandardFont);
+
+		// Advance width of a character in thousandths of the font size
+		int get_width(const unsigned char) const;
+
+		// Width of WinAnsi text set at the given size, in points
+		double measure(std::string_view, const double) const;
+
+		// Writes the font dictionary and what it refers to, returns a reference to the dictionary
+		// The flags mark every character code the document shows in this font
+		PdfObject write(PdfBuilder&, const std::array<bool, 256>&) const;
+
+		const std::string& get_name() const;
+	private:
+		Font() = default;
+
+		std::string_view table(const char*) const;
+		std::string subset(const std::array<bool, 256>&) const;
+
+		std::string m_name;
+		std::array<int, 256> m_widths{};
+		bool m_embedded = false;
+
+		// Only set for TrueType fonts
+		std::string m_data;
+		std::map<std::string, std::pair<uint32_t, uint32_t>> m_tables;
+		std::vector<uint32_t> m_loca;
+		std::array<uint16_t, 256> m_glyphs{};
+		int m_units_per_em = 1000;
+		std::array<int, 4> m_bbox{};
+		int m_ascent = 0;
+		int m_descent = 0;
+		int m_cap_height = 0;
+		double m_italic_angle = 0;
+		int m_stem_v = 80;
+		int m_flags = 32;
+	};
+}
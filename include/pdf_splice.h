@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pdf_builder.h"
+
+namespace pdf
+{
+	// Builds a pdf from every page of the title page followed by the pages of the paper from first_page on,
+	// the same pages ghostscript produces with -dFirstPage and a concatenation, except that content streams,
+	// fonts, and images are copied byte for byte instead of being rendered and encoded again
+	// Outlines, named destinations, and forms of the paper are left out since they refer to the removed pages
+	// Throws PdfError for pdfs that cannot be spliced natively
+	std::string splice_title_page(PdfDocument&, PdfDocument&, const int);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "paper_catalog.h"
+#include "file_actions.h"
+#include "atomic_file.h"
+#include "process_runner.h"
+#include "html_template.h"
+#include "render_cache.h"
+#include "step_journal.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <string_view>
+#include <mutex>
+
+namespace pipeline
+{
+	namespace fs = std::filesystem;
+
+	// Values shared by every paper of the issue being published
+	struct IssueSettings
+	{
+		int volume;
+		int issue;
+		int title_offset;
+		// True when the issue continues a volume that already has published papers,
+		// in which case papers are renumbered and their page ranges are recomputed
+		bool renumber;
+		std::string year_str;
+		std::string vol_str;
+		std::string iss_str;
+		std::array<std::string, 2> date_array;
+		// Whether rewritten rdfs and title pages are flushed to disk before they replace the originals
+		file::SyncPolicy sync;
+		// Whether html title pages are regenerated from their publication's template instead of patched
+		bool regen_html;
+		// Whether pdf title pages are written directly instead of converted from html with wkhtmltopdf
+		bool native_title_pages;
+	};
+
+	// Everything that is known about a paper before any side effect is applied
+	struct PaperPlan
+	{
+		fs::directory_entry entry;
+		std::string id;
+		std::string pub;
+		std::string old_filename;
+		// Shared by the Published_PDF_File update and the rename so both always agree
+		std::string new_filename;
+		// Sequence number of the paper in the volume, -1 when it is not renumbered
+		int paper_num;
+		std::array<std::string, 2> page_range;
+		std::string title;
+		std::string abstract;
+		// Column -> new value of the paper's UPDATE, in the order they are sent
+		std::vector<std::pair<std::string, std::string>> columns;
+		// Criteria -> new value of the lines patched in the paper's rdf
+		std::vector<std::pair<std::string, std::string>> rdf_fields;
+		// How the title pages are produced, a publication without a template or layout
+		// still falls back to patching the html or converting it with wkhtmltopdf
+		bool regen_html;
+		bool native_pdf;
+	};
+
+	// Stages of a paper in the order they are applied
+	enum class Stage {
+		None,
+		Database,
+		Rename,
+		Rdf,
+		TitlePages
+	};
+
+	// State shared by the workers processing the papers of one issue
+	struct IssueContext
+	{
+		IssueContext(const IssueSettings&, process::ProcessRunner&);
+
+		IssueSettings settings;
+		// Bounds how many converters and ghostscript runs the workers start at once
+		process::ProcessRunner& runner;
+		// Writes the pdf title pages when set, otherwise they are converted from html with wkhtmltopdf
+		const pdf::TitlePageRenderer* title_renderer = nullptr;
+		// Regenerates the html title pages from their publication's template when set, otherwise they are patched
+		pdf::TitleTemplates* html_templates = nullptr;
+		// Skips converting and splicing title pages whose inputs did not change since the last run when set
+		pdf::RenderCache* render_cache = nullptr;
+		// Steps recorded here as completed are skipped, and completed steps are recorded when set
+		StepJournal* journal = nullptr;
+	};
+
+	// Computes the new value of every tablepaper column of the paper
+	void plan_columns(const IssueSettings&, PaperPlan&);
+
+	// Computes the new value of every rdf line of the paper
+	void plan_rdf_fields(const IssueSettings&, PaperPlan&);
+
+	// True if plan_columns can write the column, plans naming any other column are rejected
+	bool is_plan_column(const std::string&);
+
+	// True if plan_rdf_fields can write the rdf field, e.g. "Pages:"
+	bool is_plan_rdf_field(const std::string&);
+
+	// Fills the plan of a single paper, paper_num and last_pub_page are only used when renumbering
+	// Returns false if the paper has no row in the catalog
+	bool plan_paper(const IssueSettings&, const sql_agent::PaperCatalog&,
+					const file::PaperEntry&, const int, const std::string&, PaperPlan&);
+
+	// Computes the paper numbers, page ranges and new filenames of every paper up front
+	// as a prefix sum over NumberOfPages, papers without a database row are skipped
+	std::vector<PaperPlan> build_plan(const IssueSettings&, const sql_agent::PaperCatalog&,
+									  const std::vector<file::PaperEntry>&, int, std::string);
+
+	// Renames the paper in the filesystem to its new filename
+	bool rename_paper(const IssueContext&, const PaperPlan&);
+
+	// Updates the fields in the paper's rdf
+	bool update_rdf(const IssueContext&, const PaperPlan&);
+
+	// Collects what the pdf title page of a paper shows, the authors are read from its rdf
+	pdf::TitlePageFields title_fields(const IssueSettings&, const PaperPlan&);
+
+	// Updates the html and pdf title pages, then replaces the title page of the published paper
+	// Each of the three is a step of its own in the journal
+	bool update_title_pages(const IssueContext&, const PaperPlan&);
+
+	// Runs every stage after the database update for a paper, stopping at the first stage that fails
+	// Returns the last stage that completed, the database update counts as done
+	Stage process_files(IssueContext&, const PaperPlan&);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <algorithm>
+
+namespace process
+{
+	// An external program started directly from its argument list, no shell is involved
+	// so paths with spaces or quotes are passed through as they are
+	struct Job
+	{
+		std::string program;
+		std::vector<std::string> args;
+		// The program is killed once it runs longer than this, zero waits for it indefinitely
+		std::chrono::milliseconds timeout{ 0 };
+	};
+
+	struct Result
+	{
+		// False if the program could not be started at all, error then holds the reason
+		bool launched = false;
+		int exit_code = -1;
+		bool timed_out = false;
+		// What the program wrote to stderr, cut off after the first 64 KiB
+		std::string error;
+		std::chrono::milliseconds elapsed{ 0 };
+
+		bool ok() const { return launched && !timed_out && exit_code == 0; }
+	};
+
+	// Starts the program and waits for it on the calling thread
+	// stdout is discarded, stderr is captured into the result
+	Result run_process(const Job&);
+
+	// Runs jobs on a fixed number of worker threads, so no more than that many programs
+	// are running at once however many papers are being processed
+	class ProcessRunner
+	{
+	public:
+		explicit ProcessRunner(const size_t);
+
+		// Waits for every queued job before returning
+		~ProcessRunner();
+
+		ProcessRunner(const ProcessRunner&) = delete;
+		ProcessRunner& operator=(const ProcessRunner&) = delete;
+
+		// Queues the job, the future is ready once the program exited or was killed
+		std::future<Result> submit(Job);
+
+		// Queues the job and waits for it
+		Result run(Job);
+
+		size_t get_max_concurrent() const;
+	private:
+		void work();
+
+		std::vector<std::thread> m_workers;
+		std::deque<std::packaged_task<Result()>> m_queue;
+		std::mutex m_mutex;
+		std::condition_variable m_ready;
+		bool m_stopping = false;
+	};
+
+	// Formats a failed result for an error message, e.g. "exited with code 1: <stderr>"
+	std::string describe(const Result&);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "atomic_file.h"
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -9,6 +10,8 @@
 #include <array>
 #include <cstdlib>
 #include <cassert>
+#include <utility>
+#include <stdexcept>
 
 namespace rdf
 {
@@ -19,18 +22,45 @@ namespace rdf
 
 	// Determines the high level directory based on the id's acronym
 	// Only supports: EB, EBFT08, VUECON, and 777WPS
-	std::string find_rdf_dir(const std::string&);
+	std::string get_rdf_dir(const std::string&);
+
+	// True if the id's acronym belongs to a series with an rdf directory, reports nothing otherwise
+	bool has_rdf_dir(const std::string&);
+
+	// Lists the rdf directory of every supported series: ebfull, ecbull, 777wps, and wpaper
+	std::vector<std::string> get_rdf_dirs();
 
 	// Determines the full path of an .rdf for the given paper's id
 	std::string get_rdf_path(const std::string&);
 
-	// Read from the current state of an rdf into a temp file 
-	// while updating lines containing the criteria
-	void write_to_temp(const std::string&, const std::string&, 
-					   const std::string, const std::string);
+	// Gathers every criteria -> value pair for the rdf of a single paper so the 
+	// file is read once and written once, instead of twice per field
+	class RdfPatch
+	{
+	public:
+		// What happened when the patch was applied
+		struct Result
+		{
+			// False when every line already held its new value and the write was skipped
+			bool written;
+			// Criteria that did not begin any line of the rdf
+			std::vector<std::string> missing;
+		};
+
+		RdfPatch(const std::string&);
+
+		// Queues a new value for the line beginning with the criteria, e.g. "Volume:" or "Pages:"
+		RdfPatch& set(const std::string, const std::string);
+
+		// Rewrites the queued lines of the given rdf, throws std::runtime_error if it cannot be read or written
+		Result apply(const std::string&, const file::SyncPolicy = file::SyncPolicy::None) const;
 
-	// Read from a temp file and overwrite the current state of an rdf file
-	void read_from_temp(const std::string&, const std::string&);
+		// Rewrites the queued lines of the rdf found for the paper's id
+		Result apply(const file::SyncPolicy = file::SyncPolicy::None) const;
+	private:
+		std::string m_id;
+		std::vector<std::pair<std::string, std::string>> m_fields;
+	};
 
 	// Updates a line in an rdf where the line contains a search criteria
 	void update_rdf_line(const std::string&, const std::string, const std::string);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "rdf_actions.h"
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+#include <unordered_map>
+
+namespace rdf
+{
+	// A "Field:" line of an rdf, e.g. "Volume: 44"
+	struct RdfField
+	{
+		// Includes the colon so it can be used as a criteria, e.g. "Volume:"
+		std::string name;
+		// Byte offset of the line within the file and the length of the field,
+		// including any continuation lines of multi-line values such as abstracts
+		uint32_t offset;
+		uint32_t length;
+		// Value on the first line of the field
+		std::string value;
+	};
+
+	// Everything indexed for a single rdf
+	struct RdfRecord
+	{
+		std::string id;
+		std::string path;
+		uint64_t size;
+		int64_t mtime;
+		std::vector<RdfField> fields;
+	};
+
+	// Persistent index of every rdf in the RePEc archive, keyed by paper id
+	// Turns questions like "which rdfs still say Volume: 44" into lookups instead of a full scan
+	class RdfIndex
+	{
+	public:
+		// Loads a previously saved index, returns false if it is missing or unreadable
+		bool load(const std::string&);
+
+		// Saves the index in a compact binary format, returns false if it cannot be written
+		bool save(const std::string&) const;
+
+		// Scans the directories in parallel and only re-reads the rdfs that are new or whose
+		// size or mtime changed since the index was saved, dropping rdfs that no longer exist
+		// or cannot be read
+		// Returns the number of rdfs that were read
+		size_t refresh(const std::vector<std::string>&, const size_t);
+
+		// Returns nullptr if the id is not indexed
+		const RdfRecord* find(const std::string&) const;
+
+		// Lists the rdfs whose field holds the given value on its first line
+		std::vector<const RdfRecord*> find_by_field(const std::string&, const std::string&) const;
+
+		size_t size() const;
+	private:
+		std::unordered_map<std::string, RdfRecord> m_records;
+	};
+
+	// Fills the fields of a record from the raw contents of its rdf
+	void index_fields(const std::string&, RdfRecord&);
+
+	// Returns the first-line value of a field in the record, or nullptr if the rdf has no such field
+	const std::string* find_field(const RdfRecord&, const std::string&);
+
+	// Lists the first-line values of every occurrence of a field, e.g. each "Author-Name:"
+	std::vector<std::string> find_fields(const RdfRecord&, const std::string&);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "content_hash.h"
+#include "atomic_file.h"
+#include <map>
+#include <unordered_map>
+#include <mutex>
+
+namespace pdf
+{
+	// Hashes of the input an output file was produced from and of the output as it was written
+	struct CacheEntry
+	{
+		uint64_t input;
+		uint64_t output;
+	};
+
+	// Remembers which inputs the stand-alone title page and the published paper of every paper
+	// were last produced from, so an unchanged paper skips wkhtmltopdf and ghostscript entirely
+	// Each publication has a small store of its own, <publication dir>/GeneralPDF<pub>.qfc
+	class RenderCache
+	{
+	public:
+		// True if an earlier run produced the output from the same input and it was not changed since
+		// The step names what produced it, e.g. "title-pdf", the input hash covers the input files and the tool settings
+		bool is_fresh(const std::string&, const std::string&, const uint64_t, const std::string&);
+
+		// Records that the output was just produced from the input
+		void store(const std::string&, const std::string&, const uint64_t, const std::string&);
+
+		// Writes back every store that changed, returns false if one could not be written
+		bool save(const file::SyncPolicy = file::SyncPolicy::None);
+
+		// Entries that were found fresh or stored during this run
+		size_t get_hits() const;
+		size_t get_stored() const;
+	private:
+		struct Store
+		{
+			std::string path;
+			std::unordered_map<std::string, CacheEntry> entries;
+			bool changed = false;
+		};
+
+		// Reads the store of the paper's publication the first time it is needed, nullptr if it has none
+		Store* find_store(const std::string&);
+
+		std::map<std::string, Store> m_stores;
+		size_t m_hits = 0;
+		size_t m_stored = 0;
+		mutable std::mutex m_mutex;
+	};
+
+	// Location of the cache store of the paper's publication, empty for unknown publications
+	std::string get_cache_path(const std::string&);
+}
@@ -1,25 +1,41 @@
 #pragma once
 
 #include "sql_agent.h"
+#include "paper_store.h"
+#include <cppconn/prepared_statement.h>
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <cctype>
 
 namespace sql_agent
 {
-	// Execute a SELECT query to retrieve a field for the entry from "tablepaper" table
-	// For when only one condition is needed to find the field's value
-	std::string retrieve_field(sql::Statement*, sql::ResultSet*, 
-						       const std::string, const std::string);
+	// Sends the updates of many papers as few statements, papers with the same column list share
+	// UPDATE tablepaper SET a = CASE id WHEN ? THEN ? ... END, ... WHERE id IN (?, ...)
+	// with at most the given number of papers per statement, returns the affected row count
+	int execute_batch(MySQL_Interface&, const std::vector<PaperUpdate>&, const size_t = UPDATE_BATCH_SIZE);
 
-	// Execute a SELECT query to retrieve a field for the entry from "tablepaper" table
-	// For when two conditions is needed to find the field's value
-	std::string retrieve_field(sql::Statement*, sql::ResultSet*, const std::string, 
-							   const std::string, const std::string);
+	// The PaperStore of the MySQL server, owns the connection it sends every query on
+	class MySqlPaperStore : public PaperStore
+	{
+	public:
+		// The interface is configured and connected by the caller through get_interface()
+		MySQL_Interface& get_interface();
 
-	// Retrieves a field from the "tablepaperofarticles" table
-	// Useful to retrieve a paper's abstract or title
-	std::string retrieve_article_field(sql::Statement*, sql::ResultSet*, 
-								       const std::string, const std::string);
+		std::vector<PaperRow> find_by_filenames(const std::vector<std::string>&) override;
+		void fill_articles(std::vector<PaperRow>&) override;
+		bool find_last_paper(const std::string&, const int, PaperRow&) override;
+		void for_each_paper(const std::function<void(const PaperRow&)>&) override;
+		int update(const PaperUpdate&) override;
+		int update_batch(const std::vector<PaperUpdate>&) override;
 
-	// Execute query to UPDATE field in "tablepaper" table with input string for the given id
-	void update_field_by_ID(sql::Statement*, const std::string, 
-						    const std::string, const std::string);
+		// Disables autocommit until the transaction is committed or rolled back
+		void begin() override;
+		void commit() override;
+		void rollback() override;
+	private:
+		MySQL_Interface m_db;
+	};
 }
\ No newline at end of file
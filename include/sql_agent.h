@@ -5,9 +5,11 @@
 #include <mysql_connection.h>
 #include <cppconn/resultset.h>
 #include <cppconn/statement.h>
+#include <cppconn/prepared_statement.h>
 // standard library headers
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace sql_agent
 {
@@ -30,6 +32,13 @@ namespace sql_agent
 
 		sql::Connection* get_connection();
 
+		// Returns the prepared statement cached for a statement template, 
+		// preparing it on the connection the first time it is requested
+		sql::PreparedStatement* prepare(const std::string&);
+
+		// Releases every cached prepared statement
+		void clear_statements();
+
 		~MySQL_Interface();
 	private:
 		ServerInfo m_server;
@@ -38,5 +47,8 @@ namespace sql_agent
 
 		sql::mysql::MySQL_Driver* m_sql_driver;
 		sql::Connection* m_conn;
+
+		// Keyed by statement template, only valid for the lifetime of m_conn
+		std::unordered_map<std::string, std::unique_ptr<sql::PreparedStatement>> m_statements;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace pipeline
+{
+	// Side effects of a paper that are recorded once they completed
+	// The old title page is dropped and the new one put in front in a single replacement, so they are one step
+	enum class Step : uint8_t {
+		Sql,		// "sql", the transaction holding the paper's UPDATE was committed
+		Rename,		// "rename"
+		Rdf,		// "rdf"
+		Html,		// "html", the stand-alone html title page
+		TitlePdf,	// "title-pdf", the stand-alone pdf title page
+		Splice		// "pdf-splice", the title page of the published paper was replaced
+	};
+
+	const char* get_step_name(const Step);
+
+	// Append-only record of the completed steps of every paper, one "<id>\t<step>" line each
+	// Every line is written as soon as its step completed, so a crashed process loses nothing,
+	// but lines are only flushed to disk in batches since a flush costs far more than the step
+	class StepJournal
+	{
+	public:
+		// Opens the journal for appending and reads back the steps it already holds, creating it
+		// with the path of its plan if it does not exist, throws std::runtime_error if it cannot be opened
+		StepJournal(const std::string&, const std::string&, const size_t = 32,
+					const std::chrono::milliseconds = std::chrono::milliseconds(2000));
+
+		StepJournal(const StepJournal&) = delete;
+		StepJournal& operator=(const StepJournal&) = delete;
+
+		// Flushes the lines that were not flushed yet
+		~StepJournal();
+
+		// Reads the plan path a journal was created with, empty if the file is not a journal
+		static std::string read_plan_path(const std::string&);
+
+		bool is_done(const std::string&, const Step) const;
+
+		// Papers with at least one completed step
+		size_t get_started() const;
+
+		// Thread safe, throws std::runtime_error if the line could not be written
+		void record(const std::string&, const Step);
+
+		// Flushes every written line to disk
+		void sync();
+
+		const std::string& get_plan_path() const;
+	private:
+		void write_line(std::string_view);
+		void sync_locked();
+
+		std::string m_path;
+		std::string m_plan_path;
+		std::FILE* m_file = nullptr;
+		size_t m_sync_every;
+		std::chrono::milliseconds m_sync_interval;
+		size_t m_unsynced = 0;
+		std::chrono::steady_clock::time_point m_last_sync;
+		// One bit per step for every paper id
+		std::unordered_map<std::string, uint8_t> m_done;
+		mutable std::mutex m_mutex;
+	};
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "pdf_fonts.h"
+
+namespace pdf
+{
+	// What a title page shows, text is UTF-8
+	struct TitlePageFields
+	{
+		std::string id;
+		std::string pub;
+		std::string title;
+		std::string abstract;
+		std::vector<std::string> authors;
+		int volume;
+		int issue;
+		std::string year;
+		std::array<std::string, 2> page_range;
+		// e.g. "March 30, 2024"
+		std::string published;
+	};
+
+	enum class FontStyle {
+		Regular,
+		Bold,
+		Italic
+	};
+
+	// Lines of a title page, each filled from the fields
+	enum class TitleLine {
+		Journal,
+		Issue,
+		Title,
+		Authors,
+		Citation,
+		Published,
+		// A horizontal line across the text width, size is its thickness
+		Rule
+	};
+
+	struct TitleBlock
+	{
+		TitleLine line;
+		FontStyle style;
+		double size;
+		// Space above the block in points
+		double space_before;
+		bool centered;
+	};
+
+	// Fixed layout of the title pages of one publication, sizes and positions in points
+	struct TitleLayout
+	{
+		std::string pub;
+		std::string journal;
+		// TrueType files of the regular, bold, and italic styles, and the standard fonts used in their place
+		std::array<std::string, 3> font_files;
+		std::array<StandardFont, 3> standard_fonts;
+		double width;
+		double height;
+		double margin;
+		double top;
+		std::vector<TitleBlock> blocks;
+	};
+
+	// Layouts of EB, EBFT08, VUECON, and 777wps777
+	const std::vector<TitleLayout>& get_title_layouts();
+
+	// Returns nullptr for publications without a layout
+	const TitleLayout* find_title_layout(const std::string&);
+
+	// "A", "A and B", "A, B and C"
+	std::string join_authors(const std::vector<std::string>&);
+
+	// "12-25", empty if either end of the page range is unknown
+	std::string format_pages(const TitlePageFields&);
+
+	// Authors, (year) ''Title'', Journal, Volume #, Issue #, pages #-#.
+	std::string format_citation(const TitlePageFields&, const std::string&);
+
+	// Text with characters outside WinAnsi, e.g. Polish or Greek author names, which would be set as '?'
+	class UnencodableText : public PdfError
+	{
+	public:
+		using PdfError::PdfError;
+	};
+
+	// Writes one-page title pdfs straight from the fields of a paper, without an html renderer
+	// Output only depends on the fields, the same paper always gives the same bytes
+	class TitlePageRenderer
+	{
+	public:
+		// Loads the fonts of every layout once, fonts that cannot be embedded are replaced by standard fonts
+		TitlePageRenderer();
+
+		// Throws PdfError for publications without a layout, and UnencodableText for text the fonts cannot show
+		std::string render(const TitlePageFields&) const;
+	private:
+		std::map<std::string, Font> m_fonts;
+		// Fonts of each layout in style order, pointing into m_fonts
+		std::vector<std::array<const Font*, 3>> m_layout_fonts;
+	};
+}
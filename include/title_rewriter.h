@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pdf_actions.h"
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace pdf
+{
+	// Rewrites the volume, issue, pages, year, and "Published:" patterns of a title page in one scan
+	// The result is byte for byte the same as pdf::update_citation(pdf::update_title(html)),
+	// which stays the reference and is used for pages where a single scan cannot guarantee that,
+	// e.g. when matches of different patterns overlap
+	class TitleRewriter
+	{
+	public:
+		TitleRewriter(const int, const int, const std::array<std::string,2>&, const std::array<std::string,2>&);
+
+		std::string rewrite(const std::string&) const;
+
+		// Returns false without touching the output when the page has to go through the regex chain
+		bool rewrite_single_pass(std::string_view, std::string&) const;
+	private:
+		// The patterns of update_title() and update_citation() in the order they are applied,
+		// the "Published:" date is left out since it is applied to the output of all the others
+		enum Pattern {
+			TitleVolume,		// Volume #
+			TitleIssue,			// Issue #
+			CitationVolume,		// Vol. #
+			CitationIssueNo,	// No. #
+			CitationIssueIss,	// Iss. #
+			PagesRange,			// pages #-#
+			PagesPPRange,		// pp. #-#
+			PagesPRange,		// p. #-#
+			PagesAppendix,		// pages A#
+			PagesPAppendix,		// p. A#
+			PagesPAAppendix,	// p.A#
+			Year,				// , (year) ''
+			PatternCount
+		};
+
+		// Returns the end of the first pattern before the limit that matches at the cursor, or nullptr
+		const char* first_match(const char*, const char*, const int, int&) const;
+
+		int m_new_vol;
+		int m_new_iss;
+		std::array<std::string, 2> m_page_range;
+		std::array<std::string, 2> m_date_array;
+		// Replacement text of every pattern
+		std::array<std::string, PatternCount> m_replacements;
+		std::string m_publish_date;
+		// The single scan relies on replacements that no pattern can match into
+		bool m_single_pass;
+	};
+}
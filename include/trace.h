@@ -0,0 +1,65 @@
+#pragma once
+
+#include "json.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <cstdint>
+#include <cstdio>
+
+namespace trace
+{
+	// A finished span, times in microseconds since the process started tracing
+	struct Event
+	{
+		const char* name;
+		std::string detail;
+		int64_t start;
+		int64_t duration;
+	};
+
+	// Times the scope it lives in and records it in a buffer owned by the calling thread, so
+	// recording never takes a lock, names are string literals such as "sql" or "ghostscript"
+	// The detail, usually the paper id, is only written to the Chrome trace
+	class Span
+	{
+	public:
+		explicit Span(const char*);
+		Span(const char*, std::string);
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+		~Span();
+	private:
+		const char* m_name;
+		std::string m_detail;
+		int64_t m_start;
+	};
+
+	// Latency of one span name over the whole run, in microseconds
+	struct StageSummary
+	{
+		std::string name;
+		size_t count;
+		int64_t p50;
+		int64_t p95;
+		int64_t max;
+		int64_t total;
+	};
+
+	// Collects the events of every thread, only call this once the traced threads went idle
+	std::vector<StageSummary> summarize();
+
+	// Prints one line per span name with its count, p50, p95, max and total time in milliseconds
+	void print_summary(std::ostream&);
+
+	// Writes every event as a Chrome trace_event file that chrome://tracing or Perfetto can open
+	// Returns false if the file cannot be written
+	bool write_chrome_trace(const std::string&);
+}
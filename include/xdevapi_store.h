@@ -0,0 +1,41 @@
+#pragma once
+
+#include "paper_store.h"
+// mysql_connector/c++ X DevAPI headers
+#include <mysqlx/xdevapi.h>
+// standard library headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace sql_agent
+{
+	// The PaperStore of the MySQL server reached through the X Protocol (mysqlx, port 33060 by default)
+	// Lookups and updates for many papers go out as set-based statements, so an issue
+	// costs a handful of round trips instead of one per paper and column
+	class XDevApiPaperStore : public PaperStore
+	{
+	public:
+		// Opens the session on the host, port, username, password and schema,
+		// throws mysqlx::Error (a std::runtime_error) if it cannot
+		XDevApiPaperStore(const std::string&, const unsigned int, const std::string&,
+						  const std::string&, const std::string&);
+
+		std::vector<PaperRow> find_by_filenames(const std::vector<std::string>&) override;
+		void fill_articles(std::vector<PaperRow>&) override;
+		bool find_last_paper(const std::string&, const int, PaperRow&) override;
+		void for_each_paper(const std::function<void(const PaperRow&)>&) override;
+		int update(const PaperUpdate&) override;
+		int update_batch(const std::vector<PaperUpdate>&) override;
+
+		void begin() override;
+		void commit() override;
+		void rollback() override;
+	private:
+		// Sends the statement with its values bound in order
+		mysqlx::SqlResult execute(const BoundStatement&);
+
+		std::unique_ptr<mysqlx::Session> m_session;
+	};
+}
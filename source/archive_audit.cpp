@@ -0,0 +1,174 @@
+#include "archive_audit.h"
+#include "rdf_actions.h"
+
+namespace audit
+{
+	// Bumped whenever a member is renamed or changes meaning
+	static constexpr int REPORT_VERSION = 1;
+
+	// Paths are compared the way the Windows file system and web server see them
+	static std::string lowercase(std::string_view text)
+	{
+		std::string lower(text);
+		for (auto& c : lower) { c = static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+		return lower;
+	}
+
+	static bool equals_ignore_case(std::string_view a, std::string_view b)
+	{
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+			[](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+	}
+
+	static bool parse_int(const std::string& text, int& number)
+	{
+		auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), number);
+		return ec == std::errc() && end == text.data() + text.size();
+	}
+
+	// What a published row calls for, read from its Published_PDF_File and page numbers
+	struct Expected
+	{
+		// Relative to the archive root, e.g. "EB/2024/Volume44/EB-24-V44-I1-P26.pdf"
+		std::string archive_path;
+		std::string year;
+		std::string volume;
+		std::string issue;
+		// Empty when the row does not have both page numbers
+		std::string pages;
+		std::string citation;
+		std::string url;
+	};
+
+	// "/Pubs/<publication>/<YYYY>/Volume<NN>/<filename>", false for any other shape
+	static bool expected_for(const sql_agent::PaperRow& row, Expected& expected)
+	{
+		constexpr std::string_view root = "/Pubs/";
+		const std::string& path = row.published_pdf_file;
+		if (path.size() <= root.size() || !equals_ignore_case(std::string_view(path).substr(0, root.size()), root)) { return false; }
+		expected.archive_path = path.substr(root.size());
+
+		std::vector<std::string_view> parts;
+		std::string_view rest(expected.archive_path);
+		for (size_t slash = rest.find('/'); slash != std::string_view::npos; slash = rest.find('/')) {
+			parts.push_back(rest.substr(0, slash));
+			rest.remove_prefix(slash + 1);
+		}
+		parts.push_back(rest);
+		constexpr std::string_view volume_prefix = "Volume";
+		if (parts.size() != 4 || parts[1].size() != 4 || parts[2].substr(0, volume_prefix.size()) != volume_prefix) { return false; }
+
+		file::PaperFilename key;
+		if (!file::parse_filename(parts[3], key) || key.issue < 0) { return false; }
+		expected.year = std::string(parts[1]);
+		expected.volume = std::string(parts[2].substr(volume_prefix.size()));
+		expected.issue = std::to_string(key.issue);
+
+		// Same page range and citation as pipeline::plan_columns writes
+		int count = 0;
+		int last = 0;
+		expected.pages.clear();
+		if (parse_int(row.number_of_pages, count) && parse_int(row.total_numpages, last)) {
+			expected.pages = std::to_string(last - count + 1) + " - " + std::to_string(last);
+		}
+		expected.citation = expected.year + ", Volume " + expected.volume + ", Issue " + expected.issue;
+		if (!expected.pages.empty()) { expected.citation += ", pages " + expected.pages; }
+		expected.url = "http://www.accessecon.com" + path;
+		return true;
+	}
+
+	// Joins the rows, the archive and the rdfs and returns every mismatch ordered by id and kind
+	std::vector<Finding> compare(const std::vector<sql_agent::PaperRow>& rows, const std::vector<file::ArchivePaper>& files, const rdf::RdfIndex& rdfs)
+	{
+		// Every paper of the archive by its lowercase relative path, and where each filename lives
+		std::unordered_map<std::string, size_t> by_path;
+		std::unordered_map<std::string, size_t> by_filename;
+		by_path.reserve(files.size());
+		by_filename.reserve(files.size());
+		for (size_t i = 0; i < files.size(); ++i) {
+			by_path.emplace(lowercase(files[i].directory + "/" + files[i].filename), i);
+			by_filename.emplace(lowercase(files[i].filename), i);
+		}
+		std::vector<bool> referenced(files.size(), false);
+
+		std::vector<Finding> findings;
+		auto report = [&](const char* kind, const sql_agent::PaperRow& row, std::string expected, std::string found) {
+			findings.push_back(Finding{ kind, row.id, row.published_pdf_file, std::move(expected), std::move(found) });
+		};
+
+		Expected expected;
+		for (const auto& row : rows) {
+			if (row.published_pdf_file.empty()) { continue; }
+			if (!expected_for(row, expected)) {
+				report("invalid_path", row, "/Pubs/<publication>/<YYYY>/Volume<NN>/<filename>", row.published_pdf_file);
+				continue;
+			}
+
+			auto file = by_path.find(lowercase(expected.archive_path));
+			if (file != by_path.end()) {
+				referenced[file->second] = true;
+			} else {
+				// A file with the same name elsewhere usually means the row or the file was not moved along
+				auto moved = by_filename.find(lowercase(file::fs::path(expected.archive_path).filename().string()));
+				report("missing_file", row, expected.archive_path,
+					   (moved == by_filename.end()) ? "" : files[moved->second].directory + "/" + files[moved->second].filename);
+			}
+
+			if (row.citation_string != expected.citation) { report("wrong_citation", row, expected.citation, row.citation_string); }
+
+			const rdf::RdfRecord* record = rdfs.find(row.id);
+			if (record == nullptr) {
+				// Only the series with an rdf directory have rdfs at all
+				if (rdf::has_rdf_dir(row.id)) { report("missing_rdf", row, rdf::get_rdf_path(row.id), ""); }
+				continue;
+			}
+			auto check = [&](const char* kind, const std::string& field, const std::string& value, const bool ignore_case) {
+				const std::string* found = rdf::find_field(*record, field);
+				std::string actual = found ? *found : "";
+				if (ignore_case ? !equals_ignore_case(actual, value) : actual != value) { report(kind, row, value, actual); }
+			};
+			check("stale_url", "File-URL:", expected.url, true);
+			if (!expected.pages.empty()) { check("wrong_pages", "Pages:", expected.pages, false); }
+			check("wrong_volume", "Volume:", expected.volume, false);
+			check("wrong_issue", "Issue:", expected.issue, false);
+		}
+
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (referenced[i]) { continue; }
+			findings.push_back(Finding{ "unreferenced_file", "", files[i].directory + "/" + files[i].filename, "", "" });
+		}
+
+		std::sort(findings.begin(), findings.end(), [](const Finding& a, const Finding& b) {
+			if (a.id != b.id) { return a.id < b.id; }
+			if (a.kind != b.kind) { return a.kind < b.kind; }
+			return a.path < b.path;
+		});
+		return findings;
+	}
+
+	// Writes the findings as a JSON document with the number of findings of each kind
+	std::string serialize_findings(const std::vector<Finding>& findings, const size_t papers, const size_t files, const size_t rdfs)
+	{
+		json::Value document = json::Value::make_object();
+		document.set("version", REPORT_VERSION);
+		document.set("papers", static_cast<long long>(papers));
+		document.set("files", static_cast<long long>(files));
+		document.set("rdfs", static_cast<long long>(rdfs));
+
+		std::map<std::string, long long> counts;
+		for (const auto& finding : findings) { ++counts[finding.kind]; }
+		json::Value& summary = document.set("summary", json::Value::make_object());
+		for (const auto& count : counts) { summary.set(count.first, count.second); }
+
+		json::Value& items = document.set("findings", json::Value::make_array());
+		for (const auto& finding : findings) {
+			json::Value& item = items.push_back(json::Value::make_object());
+			item.set("kind", finding.kind);
+			item.set("id", finding.id);
+			item.set("path", finding.path);
+			item.set("expected", finding.expected);
+			item.set("found", finding.found);
+		}
+		return document.dump();
+	}
+}
@@ -0,0 +1,239 @@
+#include "archive_scan.h"
+#include "parallel.h"
+#include "logging.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace file
+{
+	enum class EntryKind {
+		File,
+		Directory,
+		Other
+	};
+
+#ifdef _WIN32
+	// Lists the directory with FindFirstFileExW, which returns the attributes along with the
+	// names and skips the short 8.3 names, in large batches per call
+	template <typename Visit>
+	static bool for_each_entry(const std::string& path, Visit&& visit)
+	{
+		std::wstring pattern = fs::path(path).wstring() + L"\\*";
+		WIN32_FIND_DATAW data;
+		HANDLE handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch,
+										 nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if (handle == INVALID_HANDLE_VALUE) { return false; }
+
+		std::string name;
+		do {
+			int length = WideCharToMultiByte(CP_UTF8, 0, data.cFileName, -1, nullptr, 0, nullptr, nullptr);
+			if (length <= 1) { continue; }
+			name.resize(static_cast<size_t>(length - 1));
+			WideCharToMultiByte(CP_UTF8, 0, data.cFileName, -1, name.data(), length, nullptr, nullptr);
+			if (name == "." || name == "..") { continue; }
+			visit(std::string_view(name), (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? EntryKind::Directory : EntryKind::File);
+		} while (FindNextFileW(handle, &data));
+		FindClose(handle);
+		return true;
+	}
+#elif defined(__linux__)
+	// Lists the directory with getdents64 into a 64 KiB buffer, d_type tells files from directories
+	// Only file systems that leave d_type unknown, and symbolic links, cost a stat
+	template <typename Visit>
+	static bool for_each_entry(const std::string& path, Visit&& visit)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) { return false; }
+
+		alignas(struct dirent64) char buffer[64 * 1024];
+		for (;;) {
+			long count = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+			if (count < 0) {
+				::close(fd);
+				return false;
+			}
+			if (count == 0) { break; }
+
+			for (long offset = 0; offset < count;) {
+				const struct dirent64* record = reinterpret_cast<const struct dirent64*>(buffer + offset);
+				offset += record->d_reclen;
+				std::string_view name(record->d_name);
+				if (name == "." || name == "..") { continue; }
+
+				EntryKind kind = EntryKind::Other;
+				if (record->d_type == DT_REG) { kind = EntryKind::File; }
+				else if (record->d_type == DT_DIR) { kind = EntryKind::Directory; }
+				else if (record->d_type == DT_UNKNOWN || record->d_type == DT_LNK) {
+					struct stat info;
+					if (::fstatat(fd, record->d_name, &info, 0) == 0) {
+						if (S_ISREG(info.st_mode)) { kind = EntryKind::File; }
+						else if (S_ISDIR(info.st_mode)) { kind = EntryKind::Directory; }
+					}
+				}
+				visit(name, kind);
+			}
+		}
+		::close(fd);
+		return true;
+	}
+#else
+	template <typename Visit>
+	static bool for_each_entry(const std::string& path, Visit&& visit)
+	{
+		std::error_code ec;
+		fs::directory_iterator entries(path, ec);
+		if (ec) { return false; }
+		for (const auto& entry : entries) {
+			std::string name = entry.path().filename().string();
+			EntryKind kind = entry.is_directory(ec) ? EntryKind::Directory
+						   : entry.is_regular_file(ec) ? EntryKind::File : EntryKind::Other;
+			visit(std::string_view(name), kind);
+		}
+		return true;
+	}
+#endif
+
+	// Parses a name made of a prefix followed by 1 to 4 digits, e.g. "Volume44" or "2024"
+	static bool parse_numbered(std::string_view name, std::string_view prefix, int& number)
+	{
+		if (name.size() <= prefix.size() || name.size() > prefix.size() + 4 || name.substr(0, prefix.size()) != prefix) { return false; }
+		number = 0;
+		for (size_t i = prefix.size(); i < name.size(); ++i) {
+			if (name[i] < '0' || name[i] > '9') { return false; }
+			number = number * 10 + (name[i] - '0');
+		}
+		return true;
+	}
+
+	// A directory waiting to be read, the level tells what its entries are
+	struct ScanTask
+	{
+		enum class Level {
+			Root,
+			Publication,
+			Year,
+			Volume
+		};
+
+		Level level;
+		std::string directory;
+		int year;
+		int volume;
+	};
+
+	// Directories found by one thread are read by whichever thread is free next
+	// The scan is over once no directory is queued or being read
+	class ScanQueue
+	{
+	public:
+		explicit ScanQueue(ScanTask root) : m_pending(1) { m_tasks.push_back(std::move(root)); }
+
+		// Waits for the next directory, false once the scan is over
+		bool pop(ScanTask& task)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_ready.wait(lock, [this]() { return !m_tasks.empty() || m_pending == 0; });
+			if (m_tasks.empty()) { return false; }
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			return true;
+		}
+
+		// Queues the subdirectories of a directory and marks it as read
+		void finish(std::vector<ScanTask>& found)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& task : found) { m_tasks.push_back(std::move(task)); }
+			m_pending += found.size();
+			m_pending -= 1;
+			if (m_pending == 0) { m_ready.notify_all(); }
+			else if (!found.empty()) { (found.size() == 1) ? m_ready.notify_one() : m_ready.notify_all(); }
+		}
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_ready;
+		std::deque<ScanTask> m_tasks;
+		// Directories queued or being read
+		size_t m_pending;
+	};
+
+	// Walks <root>/<publication>/<YYYY>/Volume<NN> on the given number of threads
+	size_t scan_archive(const std::string& root, const size_t jobs, const ArchiveConsumer& consumer)
+	{
+		using Level = ScanTask::Level;
+		ScanQueue queue(ScanTask{ Level::Root, "", 0, 0 });
+		std::atomic<size_t> papers_found{ 0 };
+
+		auto worker = [&](size_t) {
+			ScanTask task;
+			std::vector<ScanTask> found;
+			std::vector<ArchivePaper> papers;
+			while (queue.pop(task)) {
+				found.clear();
+				papers.clear();
+				std::string path = task.directory.empty() ? root : root + "/" + task.directory;
+				std::string prefix = task.directory.empty() ? "" : task.directory + "/";
+
+				bool listed = for_each_entry(path, [&](std::string_view name, EntryKind kind) {
+					int number = 0;
+					switch (task.level) {
+					case Level::Root:
+						if (kind == EntryKind::Directory) {
+							found.push_back(ScanTask{ Level::Publication, std::string(name), 0, 0 });
+						}
+						break;
+					case Level::Publication:
+						if (kind == EntryKind::Directory && name.size() == 4 && parse_numbered(name, "", number)) {
+							found.push_back(ScanTask{ Level::Year, prefix + std::string(name), number, 0 });
+						}
+						break;
+					case Level::Year:
+						if (kind == EntryKind::Directory && parse_numbered(name, "Volume", number)) {
+							found.push_back(ScanTask{ Level::Volume, prefix + std::string(name), task.year, number });
+						}
+						break;
+					case Level::Volume: {
+						PaperFilename key;
+						if (kind == EntryKind::File && parse_filename(name, key)) {
+							papers.push_back(ArchivePaper{ task.directory, std::string(name), key, task.year, task.volume });
+						}
+						break;
+					}
+					}
+				});
+				if (!listed) { logging::warning() << "Unable to read archive directory " << path; }
+
+				// Queued first, so a consumer that throws never leaves the other threads waiting
+				queue.finish(found);
+				if (!papers.empty()) {
+					papers_found += papers.size();
+					consumer(papers);
+				}
+			}
+		};
+		parallel::for_each_index(std::max<size_t>(1, jobs), std::max<size_t>(1, jobs), worker);
+		return papers_found;
+	}
+
+	// Collects every paper of the archive, in no particular order
+	std::vector<ArchivePaper> scan_archive(const std::string& root, const size_t jobs)
+	{
+		std::vector<ArchivePaper> all;
+		std::mutex all_mutex;
+		scan_archive(root, jobs, [&](std::vector<ArchivePaper>& papers) {
+			std::lock_guard<std::mutex> lock(all_mutex);
+			all.insert(all.end(), std::make_move_iterator(papers.begin()), std::make_move_iterator(papers.end()));
+		});
+		return all;
+	}
+}
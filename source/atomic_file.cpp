@@ -0,0 +1,153 @@
+#include "atomic_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace file
+{
+	// Distinguishes the temp files of writers that are open at the same time
+	static std::atomic<unsigned long> temp_counter{ 0 };
+
+	static unsigned long process_id()
+	{
+#ifdef _WIN32
+		return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+		return static_cast<unsigned long>(getpid());
+#endif
+	}
+
+	// Flushes a closed file to disk
+	static bool sync_file(const std::string& path)
+	{
+#ifdef _WIN32
+		HANDLE handle = CreateFileW(fs::path(path).wstring().c_str(), GENERIC_WRITE, 0, nullptr,
+									OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) { return false; }
+		bool flushed = FlushFileBuffers(handle) != 0;
+		CloseHandle(handle);
+		return flushed;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) { return false; }
+		bool flushed = ::fsync(fd) == 0;
+		::close(fd);
+		return flushed;
+#endif
+	}
+
+	// Moves the temp file over the target in a single step
+	static bool replace_target(const std::string& temp, const std::string& target, const SyncPolicy sync)
+	{
+#ifdef _WIN32
+		std::wstring wide_temp = fs::path(temp).wstring();
+		std::wstring wide_target = fs::path(target).wstring();
+		if (fs::exists(target)) {
+			// ReplaceFile keeps the security descriptor, owner, and attributes of the target
+			// so permissions no longer have to be re-enabled by hand after an update
+			if (ReplaceFileW(wide_target.c_str(), wide_temp.c_str(), nullptr,
+							 REPLACEFILE_IGNORE_MERGE_ERRORS, nullptr, nullptr) != 0) {
+				return true;
+			}
+		}
+		DWORD flags = MOVEFILE_REPLACE_EXISTING;
+		if (sync == SyncPolicy::Flush) { flags |= MOVEFILE_WRITE_THROUGH; }
+		return MoveFileExW(wide_temp.c_str(), wide_target.c_str(), flags) != 0;
+#else
+		struct stat target_stat;
+		if (::stat(target.c_str(), &target_stat) == 0) {
+			::chmod(temp.c_str(), target_stat.st_mode & 07777);
+			if (::chown(temp.c_str(), target_stat.st_uid, target_stat.st_gid) != 0) {
+				// Only root can hand a file to another user, the temp file then keeps the current owner
+			}
+		}
+		if (::rename(temp.c_str(), target.c_str()) != 0) { return false; }
+
+		if (sync == SyncPolicy::Flush) {
+			// The rename itself is only durable once the directory is flushed
+			std::string dir = fs::path(target).parent_path().string();
+			int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+			if (dir_fd >= 0) {
+				::fsync(dir_fd);
+				::close(dir_fd);
+			}
+		}
+		return true;
+#endif
+	}
+
+	// Unique name for a temp file in the same directory as the target
+	std::string sibling_temp_path(const std::string& target)
+	{
+		// A sibling of the target so the final rename never crosses filesystems
+		fs::path target_path(target);
+		std::string temp_name = "." + target_path.filename().string() + ".tmp." +
+			std::to_string(process_id()) + "." + std::to_string(temp_counter++);
+		return (target_path.parent_path() / temp_name).string();
+	}
+
+	// Moves a finished temp file over the target in a single step, keeping the target's permissions
+	void replace_file(const std::string& temp, const std::string& target, const SyncPolicy sync)
+	{
+		if (sync == SyncPolicy::Flush && !sync_file(temp)) {
+			throw std::runtime_error("Failed to flush temporary file " + temp);
+		}
+		if (!replace_target(temp, target, sync)) {
+			throw std::runtime_error("Failed to replace " + target + " with " + temp);
+		}
+	}
+
+	AtomicFileWriter::AtomicFileWriter(const std::string& target, const SyncPolicy sync, const std::ios::openmode mode)
+		: m_target(target), m_sync(sync), m_committed(false)
+	{
+		m_temp = sibling_temp_path(target);
+		m_stream.open(m_temp, mode | std::ios::out | std::ios::trunc);
+		if (!m_stream.is_open()) {
+			throw std::runtime_error("Unable to open temporary file " + m_temp + " for write");
+		}
+	}
+
+	std::ostream& AtomicFileWriter::stream() { return m_stream; }
+
+	void AtomicFileWriter::write(std::string_view content)
+	{
+		m_stream.write(content.data(), static_cast<std::streamsize>(content.size()));
+	}
+
+	// Replaces the target with the temp file, throws std::runtime_error if it fails
+	void AtomicFileWriter::commit()
+	{
+		m_stream.close();
+		if (!m_stream) {
+			throw std::runtime_error("Failed to write temporary file " + m_temp);
+		}
+		file::replace_file(m_temp, m_target, m_sync);
+		m_committed = true;
+	}
+
+	const std::string& AtomicFileWriter::get_temp_path() const { return m_temp; }
+
+	// Removes the temp file if the writer was never committed
+	AtomicFileWriter::~AtomicFileWriter()
+	{
+		if (m_committed) { return; }
+		if (m_stream.is_open()) { m_stream.close(); }
+		std::error_code ec;
+		fs::remove(m_temp, ec);
+	}
+
+	// Replaces the contents of a file through an AtomicFileWriter, binary files pass std::ios::binary
+	void write_file_atomic(const std::string& path, std::string_view content, const SyncPolicy sync, const std::ios::openmode mode)
+	{
+		AtomicFileWriter writer(path, sync, mode);
+		writer.write(content);
+		writer.commit();
+	}
+}
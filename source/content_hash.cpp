@@ -0,0 +1,147 @@
+#include "content_hash.h"
+
+namespace file
+{
+	static constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+	static constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+	static constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+	static constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+	static constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+	static inline uint64_t rotl(const uint64_t value, const int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Every byte order gives the same hash, the stored hashes are compared across runs
+	static inline uint64_t read64(const unsigned char* p)
+	{
+		uint64_t value = 0;
+		for (int i = 7; i >= 0; --i) { value = (value << 8) | p[i]; }
+		return value;
+	}
+
+	static inline uint32_t read32(const unsigned char* p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+			(static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	static inline uint64_t round(uint64_t lane, const uint64_t input)
+	{
+		lane += input * PRIME2;
+		lane = rotl(lane, 31);
+		return lane * PRIME1;
+	}
+
+	static inline uint64_t merge_round(uint64_t hash, const uint64_t lane)
+	{
+		hash ^= round(0, lane);
+		return hash * PRIME1 + PRIME4;
+	}
+
+	Xxh64::Xxh64(const uint64_t seed)
+		: m_lanes{ seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 }, m_seed(seed) {}
+
+	Xxh64& Xxh64::update(std::string_view data)
+	{
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+		size_t size = data.size();
+		m_length += size;
+
+		// Completes the stripe left over from the previous piece
+		if (m_buffered != 0) {
+			size_t take = std::min(size, m_buffer.size() - m_buffered);
+			std::memcpy(m_buffer.data() + m_buffered, p, take);
+			m_buffered += take;
+			p += take;
+			size -= take;
+			if (m_buffered < m_buffer.size()) { return *this; }
+			for (size_t lane = 0; lane < 4; ++lane) {
+				m_lanes[lane] = round(m_lanes[lane], read64(m_buffer.data() + lane * 8));
+			}
+			m_buffered = 0;
+		}
+
+		while (size >= 32) {
+			for (size_t lane = 0; lane < 4; ++lane) {
+				m_lanes[lane] = round(m_lanes[lane], read64(p + lane * 8));
+			}
+			p += 32;
+			size -= 32;
+		}
+
+		std::memcpy(m_buffer.data(), p, size);
+		m_buffered = size;
+		return *this;
+	}
+
+	// Values that are not text are hashed through their bytes
+	Xxh64& Xxh64::update(const uint64_t value)
+	{
+		unsigned char bytes[8];
+		for (int i = 0; i < 8; ++i) { bytes[i] = static_cast<unsigned char>(value >> (8 * i)); }
+		return update(std::string_view(reinterpret_cast<const char*>(bytes), sizeof(bytes)));
+	}
+
+	uint64_t Xxh64::digest() const
+	{
+		uint64_t hash;
+		if (m_length >= 32) {
+			hash = rotl(m_lanes[0], 1) + rotl(m_lanes[1], 7) + rotl(m_lanes[2], 12) + rotl(m_lanes[3], 18);
+			for (uint64_t lane : m_lanes) { hash = merge_round(hash, lane); }
+		} else {
+			hash = m_seed + PRIME5;
+		}
+		hash += m_length;
+
+		const unsigned char* p = m_buffer.data();
+		size_t size = m_buffered;
+		while (size >= 8) {
+			hash ^= round(0, read64(p));
+			hash = rotl(hash, 27) * PRIME1 + PRIME4;
+			p += 8;
+			size -= 8;
+		}
+		if (size >= 4) {
+			hash ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+			hash = rotl(hash, 23) * PRIME2 + PRIME3;
+			p += 4;
+			size -= 4;
+		}
+		while (size > 0) {
+			hash ^= (*p) * PRIME5;
+			hash = rotl(hash, 11) * PRIME1;
+			++p;
+			--size;
+		}
+
+		hash ^= hash >> 33;
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		hash *= PRIME3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	uint64_t xxh64(std::string_view data, const uint64_t seed)
+	{
+		return Xxh64(seed).update(data).digest();
+	}
+
+	// Hashes a file in chunks without loading all of it, returns false if it cannot be read
+	bool hash_file(const std::string& path, uint64_t& hash)
+	{
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file.is_open()) { return false; }
+
+		Xxh64 hasher;
+		std::vector<char> chunk(1 << 16);
+		while (file.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || file.gcount() > 0) {
+			hasher.update(std::string_view(chunk.data(), static_cast<size_t>(file.gcount())));
+		}
+		if (file.bad()) { return false; }
+		hash = hasher.digest();
+		return true;
+	}
+}
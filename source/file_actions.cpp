@@ -1,4 +1,5 @@
 #include "file_actions.h"
+#include "logging.h"
 
 namespace file
 {
@@ -7,182 +8,212 @@ namespace file
 
     // Verifiesd the filetype is .pdf
     bool is_pdf(const std::string& filename) {
-        // Convert the filename to lowercase for case-insensitive comparison
-        std::string lowercaseFilename = filename;
-        std::transform(lowercaseFilename.begin(), lowercaseFilename.end(), lowercaseFilename.begin(), ::tolower);
-
-        // Check if the filename ends with ".pdf"
-        return lowercaseFilename.size() >= 4 &&
-            lowercaseFilename.substr(lowercaseFilename.size() - 4) == ".pdf";
+        // Case-insensitive comparison of the last 4 characters, without a lowercase copy
+        constexpr std::string_view extension = ".pdf";
+        if (filename.size() < extension.size()) { return false; }
+        size_t start = filename.size() - extension.size();
+        for (size_t i = 0; i < extension.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(filename[start + i])) != extension[i]) { return false; }
+        }
+        return true;
     }
 
-    // Fills a vector with filenames entries for every .pdf in a directory
-    void build_file_vec(const std::string& dir, std::vector<fs::directory_entry>& file_vec)
+    // Reads the digits in [pos, end) as a number, returns false if there are none or too many
+    static bool parse_number(std::string_view name, size_t pos, size_t end, int& number, FieldSpan& span)
     {
-        for (const auto& entry : fs::directory_iterator(dir)) {
-            if (fs::is_regular_file(entry) && is_pdf(entry.path().filename().string())) {
-                file_vec.push_back(entry);
-            }
+        if (pos >= end || end - pos > 9) { return false; }
+
+        number = 0;
+        for (size_t i = pos; i < end; ++i) {
+            if (name[i] < '0' || name[i] > '9') { return false; }
+            number = number * 10 + (name[i] - '0');
         }
+        span = FieldSpan{ static_cast<uint16_t>(pos), static_cast<uint16_t>(end) };
+        return true;
     }
 
-    // Uses regex to determine proper numerical order and avoids cases where -P9 is ordered after -P10, etc
-    bool compare_filenames(const std::filesystem::directory_entry& entry1, const std::filesystem::directory_entry& entry2) 
+    // Parses a filename into its acronym, 2-digit year, volume, issue, and paper number 
+    // without allocating, returns false if the filename does not follow the convention
+    bool parse_filename(std::string_view name, PaperFilename& parsed)
     {
-        // Extract filenames
-        std::string filename1 = entry1.path().filename().string();
-        std::string filename2 = entry2.path().filename().string();
+        // Case-insensitive ".pdf" extension
+        constexpr std::string_view extension = ".pdf";
+        if (name.size() <= extension.size() || name.size() > UINT16_MAX) { return false; }
+        size_t stem_end = name.size() - extension.size();
+        for (size_t i = 0; i < extension.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(name[stem_end + i])) != extension[i]) { return false; }
+        }
 
-        // Define regex pattern to match the numeric part after "P"
-        std::regex pattern(R"((\d+)(?:\.pdf)$)");
+        size_t dash = name.find('-');
+        if (dash == 0 || dash == std::string_view::npos || dash >= stem_end) { return false; }
+        parsed.acronym_len = static_cast<uint16_t>(dash);
+        parsed.year = parsed.volume = parsed.issue = parsed.paper = -1;
+
+        // Every remaining '-' separated token is one of: YY, V##, I##, P##
+        size_t pos = dash + 1;
+        while (pos <= stem_end) {
+            size_t end = name.find('-', pos);
+            if (end == std::string_view::npos || end > stem_end) { end = stem_end; }
+            if (pos == end) { return false; }
+
+            bool ok = false;
+            switch (name[pos]) {
+            case 'V':
+                ok = parsed.volume < 0 && parse_number(name, pos + 1, end, parsed.volume, parsed.volume_span);
+                break;
+            case 'I':
+                ok = parsed.issue < 0 && parse_number(name, pos + 1, end, parsed.issue, parsed.issue_span);
+                break;
+            case 'P':
+                ok = parsed.paper < 0 && parse_number(name, pos + 1, end, parsed.paper, parsed.paper_span);
+                break;
+            default:
+                ok = parsed.year < 0 && parse_number(name, pos, end, parsed.year, parsed.year_span);
+                break;
+            }
+            if (!ok) { return false; }
+            pos = end + 1;
+        }
 
-        // Extract numeric parts from filenames
-        std::smatch match1, match2;
-        std::regex_search(filename1, match1, pattern);
-        std::regex_search(filename2, match2, pattern);
+        // The paper number has to be the last field since it orders the files
+        return parsed.year >= 0 && parsed.volume >= 0 && parsed.issue >= 0 && parsed.paper >= 0 &&
+            parsed.paper_span.end == stem_end;
+    }
 
-        // Convert matched strings to integers
-        int number1 = std::stoi(match1[1]);
-        int number2 = std::stoi(match2[1]);
+    // Fills a vector with the parsed entries for every .pdf in a directory
+    // Filenames that do not follow the convention are reported and left out
+    void build_file_vec(const std::string& dir, std::vector<PaperEntry>& file_vec)
+    {
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            // The entry caches its type from the directory listing, fs::is_regular_file(path) would stat it again
+            std::error_code ec;
+            if (!entry.is_regular_file(ec)) continue;
+            std::string filename = entry.path().filename().string();
+            if (!is_pdf(filename)) continue;
+
+            PaperFilename key;
+            if (!parse_filename(filename, key)) {
+                logging::warning() << "Skipping " << filename << ": does not follow the naming convention ACRONYM-YY-V##-I#-P##.pdf";
+                continue;
+            }
+            file_vec.push_back(PaperEntry{ entry, std::move(filename), key });
+        }
+    }
 
-        // Compare numbers
-        return number1 < number2;
+    // Orders by the parsed paper number and avoids cases where -P9 is ordered after -P10, etc
+    bool compare_filenames(const PaperEntry& entry1, const PaperEntry& entry2) 
+    {
+        // Fall back to the filename so that the order never depends on the directory listing
+        if (entry1.key.paper != entry2.key.paper) { return entry1.key.paper < entry2.key.paper; }
+        return entry1.filename < entry2.filename;
     }
 
     // Deterministically orders the files in vector by their paper number
-    void sort_files(std::vector<std::filesystem::directory_entry>& entries)
+    void sort_files(std::vector<PaperEntry>& entries)
     {
         std::sort(entries.begin(), entries.end(), compare_filenames);
     }
 
-    // Renames the entry's filename in filesystem with the a new year, volume, and issue number
-    void rename_file(const fs::directory_entry& entry, const int new_vol, const int new_iss)
+    // Writes the filename with the new year, volume, issue, and paper number into the 
+    // output buffer in a single pass, a negative paper number keeps the current one
+    void format_filename(
+        std::string_view old_filename,
+        const PaperFilename& parsed,
+        const int new_vol,
+        const int new_iss,
+        const int new_paper_num,
+        std::string& new_filename)
     {
         assert(new_vol >= 0);
         assert(new_iss >= 0);
 
-        std::regex pattern1("-V(\\d+)");
-        std::regex pattern2("-I(\\d+)");
-        std::regex pattern3("-(\\d+)-");
-
-        std::string year = std::to_string(new_vol + 2000 - 20);
+        // Last two digits of the publication year
+        int new_year = (new_vol + 2000 - 20) % 100;
+
+        // The replaced numbers in the order they appear in the filename
+        struct Replacement { FieldSpan span; int value; int min_digits; };
+        std::array<Replacement, 4> replacements{ {
+            { parsed.year_span, new_year, 2 },
+            { parsed.volume_span, new_vol, 1 },
+            { parsed.issue_span, new_iss, 1 },
+            { parsed.paper_span, new_paper_num, 1 }
+        } };
+        std::sort(replacements.begin(), replacements.end(),
+            [](const Replacement& a, const Replacement& b) { return a.span.begin < b.span.begin; });
+
+        new_filename.clear();
+        new_filename.reserve(old_filename.size() + 8);
+
+        size_t copied = 0;
+        for (const auto& replacement : replacements) {
+            // Negative values keep the number as it is written in the old filename
+            if (replacement.value < 0) { continue; }
+            new_filename.append(old_filename.data() + copied, replacement.span.begin - copied);
+
+            char digits[16];
+            char* digits_end = std::to_chars(digits, digits + sizeof(digits), replacement.value).ptr;
+            for (int pad = static_cast<int>(digits_end - digits); pad < replacement.min_digits; ++pad) {
+                new_filename.push_back('0');
+            }
+            new_filename.append(digits, digits_end);
+            copied = replacement.span.end;
+        }
+        new_filename.append(old_filename.data() + copied, old_filename.size() - copied);
+    }
 
+    // Renames the entry's filename in filesystem to the given filename
+    void rename_file(const fs::directory_entry& entry, const std::string& new_filename)
+    {
         if (fs::is_regular_file(entry)) {
-            std::string oldFileName = entry.path().filename().string();
-            std::cout << "Changing filename locally: " + oldFileName + " -> ";
-            std::smatch match;
-
-            if (std::regex_search(oldFileName, match, pattern1) && 
-                std::regex_search(oldFileName, match, pattern2) &&
-                std::regex_search(oldFileName, match, pattern3)) {
-                // Construct the new file name
-                std::string newFileName = std::regex_replace(oldFileName, pattern1, "-V" + std::to_string(new_vol));
-                newFileName = std::regex_replace(newFileName, pattern2, "-I" + std::to_string(new_iss));
-                newFileName = std::regex_replace(newFileName, pattern3, "-" + year.substr(2,2) + "-");
-
-                // Rename the file
-                fs::rename(entry.path(), entry.path().parent_path() / newFileName);
-
-                std::cout << newFileName << std::endl;
-            }
+            logging::info() << "Changing filename locally: " << entry.path().filename().string() << " -> " << new_filename;
+            fs::rename(entry.path(), entry.path().parent_path() / new_filename);
         } else {
-            std::cerr << "Unexpected filetype, returning without updating filename." << std::endl;
+            logging::error() << "Unexpected filetype, returning without updating filename.";
             return;
         }
     }
 
+    // Renames the entry's filename in filesystem with the a new year, volume, and issue number
+    void rename_file(const fs::directory_entry& entry, const int new_vol, const int new_iss)
+    {
+        std::string new_filename = entry.path().filename().string();
+        rename_temp_filename(new_filename, new_vol, new_iss);
+        rename_file(entry, new_filename);
+    }
+
     // Renames the entry's filename in filesystem with the a new year, volume, issue, and paper number
     void rename_file(const fs::directory_entry& entry, const int new_vol, const int new_iss, const int new_paper_num)
     {
-        assert(new_vol >= 0);
-        assert(new_iss >= 0);
         assert(new_paper_num >= 0);
 
-        std::regex pattern1("-V(\\d+)");
-        std::regex pattern2("-I(\\d+)");
-        std::regex pattern3("-P(\\d+)");
-        std::regex pattern4("-(\\d+)-");
-
-        std::string year = std::to_string(new_vol + 2000 - 20);
-
-        if (fs::is_regular_file(entry)) {
-            std::string oldFileName = entry.path().filename().string();
-            std::cout << "Changing filename locally: " + oldFileName + " -> ";
-            std::smatch match;
-
-            if (std::regex_search(oldFileName, match, pattern1) && 
-                std::regex_search(oldFileName, match, pattern2) &&
-                std::regex_search(oldFileName, match, pattern3) &&
-                std::regex_search(oldFileName, match, pattern4)) {
-                // Construct the new file name
-                std::string newFileName = std::regex_replace(oldFileName, pattern1, "-V" + std::to_string(new_vol));
-                newFileName = std::regex_replace(newFileName, pattern2, "-I" + std::to_string(new_iss));
-                newFileName = std::regex_replace(newFileName, pattern3, "-P" + std::to_string(new_paper_num));
-                newFileName = std::regex_replace(newFileName, pattern4, "-" + year.substr(2, 2) + "-");
-
-                // Rename the file
-                fs::rename(entry.path(), entry.path().parent_path() / newFileName);
-
-                std::cout << newFileName << std::endl;
-            }
-        }
-        else {
-            std::cerr << "Unexpected filetype, returning without updating filename." << std::endl;
-            return;
-        }
+        std::string new_filename = entry.path().filename().string();
+        rename_temp_filename(new_filename, new_vol, new_iss, new_paper_num);
+        rename_file(entry, new_filename);
     }
 
     // Renames a temp string for updating fields in a database since the entry class is non-mutable
     void rename_temp_filename(std::string& temp_filename, const int new_vol, const int new_iss)
     {
-        assert(new_vol >= 0);
-        assert(new_iss >= 0);
-
-        std::regex pattern1("-V(\\d+)");
-        std::regex pattern2("-I(\\d+)");
-        std::regex pattern3("-(\\d+)-");
-
-        std::string year = std::to_string(new_vol + 2000 - 20);
-
-        std::string oldFileName = temp_filename;
-        std::smatch match;
+        // Filenames that do not follow the convention are left untouched
+        PaperFilename parsed;
+        if (!parse_filename(temp_filename, parsed)) { return; }
 
-        if (std::regex_search(temp_filename, match, pattern1) && 
-            std::regex_search(temp_filename, match, pattern2) && 
-            std::regex_search(temp_filename, match, pattern3)) {
-            // Construct the new file name
-            temp_filename = std::regex_replace(oldFileName, pattern1, "-V" + std::to_string(new_vol));
-            temp_filename = std::regex_replace(temp_filename, pattern2, "-I" + std::to_string(new_iss));
-            temp_filename = std::regex_replace(temp_filename, pattern3, "-" + year.substr(2, 2) + "-");
-        }
+        std::string new_filename;
+        format_filename(temp_filename, parsed, new_vol, new_iss, -1, new_filename);
+        temp_filename.swap(new_filename);
     }
 
     // Renames a temp string for updating fields in a database since the entry class is non-mutable, overloads to update paper number
     void rename_temp_filename(std::string& temp_filename, const int new_vol, const int new_iss, const int new_paper_num)
     {
-        assert(new_vol >= 0);
-        assert(new_iss >= 0);
         assert(new_paper_num >= 0);
 
-        std::regex pattern1("-V(\\d+)");
-        std::regex pattern2("-I(\\d+)");
-        std::regex pattern3("-P(\\d+)");
-        std::regex pattern4("-(\\d+)-");
-
-        std::string year = std::to_string(new_vol + 2000 - 20);
-
-        std::string old_filename = temp_filename;
-        std::smatch match;
-
-        if (std::regex_search(temp_filename, match, pattern1) && 
-            std::regex_search(temp_filename, match, pattern2) &&
-            std::regex_search(temp_filename, match, pattern3) &&
-            std::regex_search(temp_filename, match, pattern4)) {
-            // Construct the new file name
-            temp_filename = std::regex_replace(old_filename, pattern1, "-V" + std::to_string(new_vol));
-            temp_filename = std::regex_replace(temp_filename, pattern2, "-I" + std::to_string(new_iss));
-            temp_filename = std::regex_replace(temp_filename, pattern3, "-P" + std::to_string(new_paper_num));
-            temp_filename = std::regex_replace(temp_filename, pattern4, "-" + year.substr(2, 2) + "-");
-        }
+        // Filenames that do not follow the convention are left untouched
+        PaperFilename parsed;
+        if (!parse_filename(temp_filename, parsed)) { return; }
+
+        std::string new_filename;
+        format_filename(temp_filename, parsed, new_vol, new_iss, new_paper_num, new_filename);
+        temp_filename.swap(new_filename);
     }
 }
\ No newline at end of file
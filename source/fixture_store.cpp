@@ -0,0 +1,196 @@
+#include "fixture_store.h"
+#include "logging.h"
+#include "paper_catalog.h"
+
+namespace sql_agent
+{
+	// Dumps may hold numbers for numeric columns and null for empty ones
+	static std::string column_value(const json::Value& value)
+	{
+		switch (value.get_type()) {
+		case json::Value::Type::Null: return "";
+		case json::Value::Type::Number: return std::to_string(value.as_int());
+		default: return value.as_string();
+		}
+	}
+
+	// Column names are not case sensitive in MySQL, e.g. "Status_date" updates "Status_Date"
+	static bool same_column(const std::string& a, const std::string& b)
+	{
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+			[](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); });
+	}
+
+	// Returns nullptr if the row has no such column, const rows give a const value
+	template <typename Row>
+	static auto find_column(Row& row, const std::string& column) -> decltype(&row.begin()->second)
+	{
+		auto found = row.find(column);
+		if (found != row.end()) { return &found->second; }
+		for (auto& field : row) {
+			if (same_column(field.first, column)) { return &field.second; }
+		}
+		return nullptr;
+	}
+
+	static bool ends_with(const std::string& text, const std::string& suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// Reads the dump, throws std::runtime_error if it cannot be read and json::ParseError if it is malformed
+	FixtureStore::FixtureStore(const std::string& path)
+	{
+		std::ifstream fixture_file(path, std::ios::binary);
+		if (!fixture_file) { throw std::runtime_error("Unable to open fixture: " + path); }
+		std::string text((std::istreambuf_iterator<char>(fixture_file)), std::istreambuf_iterator<char>());
+
+		json::Value document = json::Value::parse(text);
+		for (const auto& item : document.at("tablepaper").as_array()) {
+			Row row;
+			for (const auto& column : item.as_object()) { row[column.first] = column_value(column.second); }
+			const std::string* id = find_column(row, "ID");
+			if (id == nullptr || id->empty()) { throw json::ParseError("Fixture row of tablepaper without an ID"); }
+			if (!m_by_id.emplace(*id, m_papers.size()).second) { throw json::ParseError("Duplicate ID in the fixture: " + *id); }
+			m_papers.push_back(std::move(row));
+		}
+		if (const json::Value* articles = document.find("tablepaperofarticles")) {
+			for (const auto& item : articles->as_array()) {
+				const json::Value* title = item.find("Title");
+				const json::Value* abstract = item.find("Abstract");
+				m_articles.emplace(column_value(item.at("Article_ID")),
+					std::make_pair(title ? column_value(*title) : "", abstract ? column_value(*abstract) : ""));
+			}
+		}
+		logging::info() << "Loaded " << m_papers.size() << " papers and " << m_articles.size() << " articles from the fixture " << path;
+	}
+
+	PaperRow FixtureStore::to_paper_row(const Row& row) const
+	{
+		auto column = [&](const std::string& name) {
+			const std::string* value = find_column(row, name);
+			return value ? *value : std::string();
+		};
+		PaperRow paper;
+		paper.id = column("ID");
+		paper.published_pdf_file = column("Published_PDF_File");
+		paper.number_of_pages = column("NumberOfPages");
+		paper.total_numpages = column("TotalNumpages");
+		return paper;
+	}
+
+	// The rows whose Published_PDF_File ends with any of the given filenames, in the order of the dump
+	std::vector<PaperRow> FixtureStore::find_by_filenames(const std::vector<std::string>& filenames)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const std::unordered_set<std::string> wanted(filenames.begin(), filenames.end());
+
+		std::vector<PaperRow> rows;
+		for (const auto& row : m_papers) {
+			PaperRow paper = to_paper_row(row);
+			if (wanted.count(basename_of(paper.published_pdf_file)) != 0) { rows.push_back(std::move(paper)); }
+		}
+		return rows;
+	}
+
+	// Fills the title and abstract of each row from the articles of the dump
+	void FixtureStore::fill_articles(std::vector<PaperRow>& rows)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& row : rows) {
+			auto found = m_articles.find(row.id);
+			if (found == m_articles.end()) { continue; }
+			if (row.title.empty()) { row.title = found->second.first; }
+			if (row.abstract.empty()) { row.abstract = found->second.second; }
+		}
+	}
+
+	// Same match as the LIKE '%-P<num>.pdf' AND LIKE '<dir>%' query of the MySQL store
+	bool FixtureStore::find_last_paper(const std::string& pub_dir, const int paper_num, PaperRow& row)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const std::string suffix = "-P" + std::to_string(paper_num) + ".pdf";
+		for (const auto& paper : m_papers) {
+			const std::string* path = find_column(paper, "Published_PDF_File");
+			if (path == nullptr || path->compare(0, pub_dir.size(), pub_dir) != 0 || !ends_with(*path, suffix)) { continue; }
+			row = to_paper_row(paper);
+			return true;
+		}
+		return false;
+	}
+
+	// Every row in the order of the dump
+	void FixtureStore::for_each_paper(const std::function<void(const PaperRow&)>& visit)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const auto& row : m_papers) {
+			PaperRow paper = to_paper_row(row);
+			const std::string* citation = find_column(row, "citationString");
+			if (citation != nullptr) { paper.citation_string = *citation; }
+			visit(paper);
+		}
+	}
+
+	// Sets every queued column of the paper, columns the dump did not have are added
+	int FixtureStore::update(const PaperUpdate& paper_update)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_by_id.find(paper_update.get_id());
+		if (paper_update.empty() || found == m_by_id.end()) { return 0; }
+
+		Row& row = m_papers[found->second];
+		for (const auto& field : paper_update.get_fields()) {
+			std::string* value = find_column(row, field.first);
+			if (value != nullptr) { *value = field.second; }
+			else { row[field.first] = field.second; }
+		}
+		return 1;
+	}
+
+	int FixtureStore::update_batch(const std::vector<PaperUpdate>& updates)
+	{
+		int affected = 0;
+		for (const auto& paper_update : updates) { affected += update(paper_update); }
+		return affected;
+	}
+
+	// The rows are copied when the transaction begins and put back on rollback
+	void FixtureStore::begin()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_snapshot = m_papers;
+		m_in_transaction = true;
+	}
+
+	void FixtureStore::commit()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_snapshot.clear();
+		m_in_transaction = false;
+	}
+
+	void FixtureStore::rollback()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_in_transaction) { return; }
+		m_papers.swap(m_snapshot);
+		m_snapshot.clear();
+		m_in_transaction = false;
+	}
+
+	// Current value of a column of a "tablepaper" row, empty if the row or column does not exist
+	std::string FixtureStore::get_column(const std::string& id, const std::string& column) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_by_id.find(id);
+		if (found == m_by_id.end()) { return ""; }
+		const std::string* value = find_column(m_papers[found->second], column);
+		return value ? *value : "";
+	}
+
+	size_t FixtureStore::size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_papers.size();
+	}
+}
@@ -0,0 +1,142 @@
+#include "html_template.h"
+#include "logging.h"
+#include "pdf_actions.h"
+
+namespace pdf
+{
+	static const std::array<std::string_view, static_cast<size_t>(TitleSlot::SlotCount)> slot_names{
+		"id", "title", "abstract", "authors", "journal", "volume", "issue", "year",
+		"first_page", "last_page", "pages", "published", "citation" };
+
+	// Escapes &, <, >, " and ' so a value shows up as text
+	std::string escape_html(std::string_view text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char c : text) {
+			switch (c) {
+			case '&': escaped += "&amp;"; break;
+			case '<': escaped += "&lt;"; break;
+			case '>': escaped += "&gt;"; break;
+			case '"': escaped += "&quot;"; break;
+			case '\'': escaped += "&#39;"; break;
+			default: escaped += c; break;
+			}
+		}
+		return escaped;
+	}
+
+	// Throws std::runtime_error for unknown slots or unclosed braces
+	HtmlTemplate::HtmlTemplate(std::string_view source)
+	{
+		m_literals.reserve(source.size());
+		size_t pos = 0;
+		while (pos < source.size()) {
+			size_t open = source.find("{{", pos);
+			if (open == std::string_view::npos) {
+				m_literals.append(source.substr(pos));
+				break;
+			}
+			m_literals.append(source.substr(pos, open - pos));
+
+			bool raw = source.compare(open, 3, "{{{") == 0;
+			std::string_view closing = raw ? "}}}" : "}}";
+			size_t name_begin = open + (raw ? 3 : 2);
+			size_t close = source.find(closing, name_begin);
+			if (close == std::string_view::npos) {
+				throw std::runtime_error("Unclosed slot at offset " + std::to_string(open));
+			}
+
+			std::string_view name = source.substr(name_begin, close - name_begin);
+			while (!name.empty() && name.front() == ' ') { name.remove_prefix(1); }
+			while (!name.empty() && name.back() == ' ') { name.remove_suffix(1); }
+			size_t index = 0;
+			while (index < slot_names.size() && slot_names[index] != name) { ++index; }
+			if (index == slot_names.size()) {
+				throw std::runtime_error("Unknown slot '" + std::string(name) + "' at offset " + std::to_string(open));
+			}
+
+			m_slots.push_back({ m_literals.size(), static_cast<TitleSlot>(index), !raw });
+			m_used[index] = true;
+			pos = close + closing.size();
+		}
+	}
+
+	std::string HtmlTemplate::render(const TitlePageFields& fields) const
+	{
+		// Every value is formatted once, however often the template uses it
+		std::array<std::string, static_cast<size_t>(TitleSlot::SlotCount)> values;
+		auto value = [&](const TitleSlot slot) -> std::string& { return values[static_cast<size_t>(slot)]; };
+		const TitleLayout* layout = find_title_layout(fields.pub);
+		std::string journal = (layout != nullptr) ? layout->journal : fields.pub;
+		for (size_t index = 0; index < values.size(); ++index) {
+			if (!m_used[index]) { continue; }
+			switch (static_cast<TitleSlot>(index)) {
+			case TitleSlot::Id: values[index] = fields.id; break;
+			case TitleSlot::Title: values[index] = fields.title; break;
+			case TitleSlot::Abstract: values[index] = fields.abstract; break;
+			case TitleSlot::Authors: values[index] = join_authors(fields.authors); break;
+			case TitleSlot::Journal: values[index] = journal; break;
+			case TitleSlot::Volume: values[index] = std::to_string(fields.volume); break;
+			case TitleSlot::Issue: values[index] = std::to_string(fields.issue); break;
+			case TitleSlot::Year: values[index] = fields.year; break;
+			case TitleSlot::FirstPage: values[index] = fields.page_range[0]; break;
+			case TitleSlot::LastPage: values[index] = fields.page_range[1]; break;
+			case TitleSlot::Pages: values[index] = format_pages(fields); break;
+			case TitleSlot::Published: values[index] = fields.published; break;
+			case TitleSlot::Citation: values[index] = format_citation(fields, journal); break;
+			default: break;
+			}
+		}
+		std::array<std::string, static_cast<size_t>(TitleSlot::SlotCount)> escaped;
+		for (size_t index = 0; index < values.size(); ++index) {
+			if (m_used[index]) { escaped[index] = escape_html(values[index]); }
+		}
+
+		size_t size = m_literals.size();
+		for (const auto& slot : m_slots) {
+			size += slot.escape ? escaped[static_cast<size_t>(slot.slot)].size() : value(slot.slot).size();
+		}
+		std::string html;
+		html.reserve(size);
+		size_t literal = 0;
+		for (const auto& slot : m_slots) {
+			html.append(m_literals, literal, slot.offset - literal);
+			html += slot.escape ? escaped[static_cast<size_t>(slot.slot)] : value(slot.slot);
+			literal = slot.offset;
+		}
+		html.append(m_literals, literal, std::string::npos);
+		return html;
+	}
+
+	// Where the canonical title page template of a publication is kept
+	std::string get_template_path(const std::string& pub)
+	{
+		std::string dir = pdf::get_dir(pub);
+		return (dir == "") ? "" : dir + "/TitlePageTemplate.html";
+	}
+
+	// Returns nullptr if the publication has no template or it does not compile
+	const HtmlTemplate* TitleTemplates::find(const std::string& pub)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_templates.find(pub);
+		if (found != m_templates.end()) { return found->second.get(); }
+
+		std::unique_ptr<HtmlTemplate> compiled;
+		std::string path = get_template_path(pub);
+		std::ifstream template_file;
+		if (path != "") { template_file.open(path); }
+		if (!template_file.is_open()) {
+			logging::warning() << "Warning: No title page template for " << pub << " at " << path << ", patching its html title pages instead.";
+		} else {
+			std::string source((std::istreambuf_iterator<char>(template_file)), std::istreambuf_iterator<char>());
+			try {
+				compiled = std::make_unique<HtmlTemplate>(source);
+			} catch (const std::exception& e) {
+				logging::error() << "Error: " << path << ": " << e.what() << ", patching the html title pages of " << pub << " instead.";
+			}
+		}
+		return m_templates.emplace(pub, std::move(compiled)).first->second.get();
+	}
+}
@@ -0,0 +1,48 @@
+#include "issue_batch.h"
+
+namespace pipeline
+{
+	static int as_job_int(const json::Value& value, const char* name)
+	{
+		long long number = value.as_int();
+		if (number < 0 || number > 1000000) { throw json::ParseError(std::string("Invalid ") + name + ": " + std::to_string(number)); }
+		return static_cast<int>(number);
+	}
+
+	// Reads a job file, throws json::ParseError if it is malformed
+	std::vector<IssueJob> parse_jobs(std::string_view text)
+	{
+		json::Value document = json::Value::parse(text);
+
+		std::vector<IssueJob> jobs;
+		for (const auto& item : document.at("issues").as_array()) {
+			IssueJob& job = jobs.emplace_back();
+			job.directory = item.at("directory").as_string();
+			job.volume = as_job_int(item.at("volume"), "volume");
+			job.issue = as_job_int(item.at("issue"), "issue");
+			job.last_article = as_job_int(item.at("last_article"), "last_article");
+			job.title_offset = as_job_int(item.at("title_offset"), "title_offset");
+			job.publication = item.at("publication").as_string();
+			if (job.directory.empty() || job.publication.empty()) {
+				throw json::ParseError("Every issue needs a directory and a publication");
+			}
+		}
+		return jobs;
+	}
+
+	// Groups the jobs by publication and volume, keeping the order of the job file inside a group
+	std::vector<std::vector<size_t>> group_jobs(const std::vector<IssueJob>& jobs)
+	{
+		std::vector<std::vector<size_t>> groups;
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			auto same_volume = [&](const std::vector<size_t>& group) {
+				const IssueJob& first = jobs[group.front()];
+				return first.publication == jobs[i].publication && first.volume == jobs[i].volume;
+			};
+			auto group = std::find_if(groups.begin(), groups.end(), same_volume);
+			if (group == groups.end()) { groups.push_back({ i }); }
+			else { group->push_back(i); }
+		}
+		return groups;
+	}
+}
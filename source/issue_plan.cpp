@@ -0,0 +1,207 @@
+#include "issue_plan.h"
+#include "rdf_actions.h"
+#include "pdf_actions.h"
+
+namespace pipeline
+{
+	// Bumped whenever a member is renamed or changes meaning
+	static constexpr int PLAN_VERSION = 1;
+
+	static json::Value pairs_to_object(const std::vector<std::pair<std::string, std::string>>& pairs)
+	{
+		json::Value object = json::Value::make_object();
+		for (const auto& pair : pairs) {
+			object.set(pair.first, pair.second);
+		}
+		return object;
+	}
+
+	static std::vector<std::pair<std::string, std::string>> object_to_pairs(const json::Value& object)
+	{
+		std::vector<std::pair<std::string, std::string>> pairs;
+		for (const auto& member : object.as_object()) {
+			pairs.emplace_back(member.first, member.second.as_string());
+		}
+		return pairs;
+	}
+
+	static int as_small_int(const json::Value& value)
+	{
+		long long number = value.as_int();
+		if (number < -1000000 || number > 1000000) { throw json::ParseError("Number out of range: " + std::to_string(number)); }
+		return static_cast<int>(number);
+	}
+
+	// Writes the plan as a JSON document, one object per paper with its new filename, page range,
+	// column values, rdf field values and how its title pages are produced
+	std::string serialize_plan(const IssuePlan& plan)
+	{
+		const IssueSettings& settings = plan.settings;
+		json::Value document = json::Value::make_object();
+		document.set("version", PLAN_VERSION);
+		document.set("directory", plan.directory);
+
+		json::Value& issue = document.set("settings", json::Value::make_object());
+		issue.set("volume", settings.volume);
+		issue.set("issue", settings.issue);
+		issue.set("title_offset", settings.title_offset);
+		issue.set("renumber", settings.renumber);
+		issue.set("year", settings.year_str);
+		json::Value& date = issue.set("date", json::Value::make_array());
+		date.push_back(settings.date_array[0]);
+		date.push_back(settings.date_array[1]);
+
+		json::Value& papers = document.set("papers", json::Value::make_array());
+		for (const auto& paper : plan.papers) {
+			json::Value& item = papers.push_back(json::Value::make_object());
+			item.set("id", paper.id);
+			item.set("pub", paper.pub);
+			item.set("old_filename", paper.old_filename);
+			item.set("new_filename", paper.new_filename);
+			item.set("paper_num", paper.paper_num);
+			json::Value& pages = item.set("page_range", json::Value::make_array());
+			pages.push_back(paper.page_range[0]);
+			pages.push_back(paper.page_range[1]);
+			item.set("title", paper.title);
+			item.set("abstract", paper.abstract);
+			item.set("sql", pairs_to_object(paper.columns));
+			item.set("rdf", pairs_to_object(paper.rdf_fields));
+			json::Value& title_page = item.set("title_page", json::Value::make_object());
+			title_page.set("html", paper.regen_html ? "template" : "patch");
+			title_page.set("pdf", paper.native_pdf ? "native" : "wkhtmltopdf");
+		}
+		return document.dump();
+	}
+
+	// Reads a plan written by serialize_plan, throws json::ParseError if it is malformed
+	IssuePlan parse_plan(std::string_view text)
+	{
+		json::Value document = json::Value::parse(text);
+		long long version = document.at("version").as_int();
+		if (version != PLAN_VERSION) {
+			throw json::ParseError("Unsupported plan version " + std::to_string(version));
+		}
+
+		IssuePlan plan;
+		plan.directory = document.at("directory").as_string();
+
+		const json::Value& issue = document.at("settings");
+		IssueSettings& settings = plan.settings;
+		settings.volume = as_small_int(issue.at("volume"));
+		settings.issue = as_small_int(issue.at("issue"));
+		settings.title_offset = as_small_int(issue.at("title_offset"));
+		settings.renumber = issue.at("renumber").as_bool();
+		settings.year_str = issue.at("year").as_string();
+		settings.vol_str = std::to_string(settings.volume);
+		settings.iss_str = std::to_string(settings.issue);
+		const auto& date = issue.at("date").as_array();
+		if (date.size() != 2) { throw json::ParseError("Expected a date of two strings"); }
+		settings.date_array = { date[0].as_string(), date[1].as_string() };
+		settings.sync = file::SyncPolicy::None;
+		settings.regen_html = false;
+		settings.native_title_pages = false;
+
+		for (const auto& item : document.at("papers").as_array()) {
+			PaperPlan paper;
+			paper.id = item.at("id").as_string();
+			paper.pub = item.at("pub").as_string();
+			paper.old_filename = item.at("old_filename").as_string();
+			paper.new_filename = item.at("new_filename").as_string();
+			// Only bare filenames are renamed, never paths that leave the directory
+			for (const std::string* filename : { &paper.old_filename, &paper.new_filename }) {
+				if (filename->empty() || filename->find_first_of("/\\") != std::string::npos) {
+					throw json::ParseError("Invalid filename \"" + *filename + "\" for " + paper.id);
+				}
+			}
+			paper.paper_num = as_small_int(item.at("paper_num"));
+			const auto& pages = item.at("page_range").as_array();
+			if (pages.size() != 2) { throw json::ParseError("Expected a page range of two strings for " + paper.id); }
+			paper.page_range = { pages[0].as_string(), pages[1].as_string() };
+			paper.title = item.at("title").as_string();
+			paper.abstract = item.at("abstract").as_string();
+			paper.columns = object_to_pairs(item.at("sql"));
+			paper.rdf_fields = object_to_pairs(item.at("rdf"));
+			// Column names end up in the query text, so only the columns an issue run writes are accepted
+			for (const auto& column : paper.columns) {
+				if (!is_plan_column(column.first)) {
+					throw json::ParseError("Column \"" + column.first + "\" cannot be written for " + paper.id);
+				}
+			}
+			for (const auto& field : paper.rdf_fields) {
+				if (!is_plan_rdf_field(field.first)) {
+					throw json::ParseError("Rdf field \"" + field.first + "\" cannot be written for " + paper.id);
+				}
+			}
+
+			const json::Value& title_page = item.at("title_page");
+			paper.regen_html = (title_page.at("html").as_string() == "template");
+			paper.native_pdf = (title_page.at("pdf").as_string() == "native");
+			settings.regen_html = settings.regen_html || paper.regen_html;
+			settings.native_title_pages = settings.native_title_pages || paper.native_pdf;
+
+			// The path is kept even when the file is gone, e.g. when a resumed run already renamed it
+			std::error_code ec;
+			paper.entry.assign(fs::path(plan.directory) / paper.old_filename, ec);
+			plan.papers.push_back(std::move(paper));
+		}
+		return plan;
+	}
+
+	// Checks that every file the plan reads or replaces is where it expects it to be
+	std::vector<std::string> preflight(const IssuePlan& plan, const StepJournal* journal)
+	{
+		auto done = [&](const PaperPlan& paper, const Step step) { return journal != nullptr && journal->is_done(paper.id, step); };
+		std::vector<std::string> problems;
+		std::error_code ec;
+		if (!fs::is_directory(plan.directory, ec)) {
+			problems.push_back("Directory does not exist: " + plan.directory);
+			return problems;
+		}
+
+		for (const auto& paper : plan.papers) {
+			const std::string prefix = "(ID: " + paper.id + ") ";
+			fs::path old_path = fs::path(plan.directory) / paper.old_filename;
+			fs::path new_path = fs::path(plan.directory) / paper.new_filename;
+			if (done(paper, Step::Rename)) {
+				if (!fs::is_regular_file(new_path, ec)) {
+					problems.push_back(prefix + "Missing renamed pdf: " + new_path.string());
+				}
+			} else {
+				if (!fs::is_regular_file(old_path, ec)) {
+					problems.push_back(prefix + "Missing pdf: " + old_path.string());
+				}
+				if (paper.new_filename != paper.old_filename && fs::exists(new_path, ec)) {
+					problems.push_back(prefix + "New filename is already taken: " + new_path.string());
+				}
+			}
+
+			if (!done(paper, Step::Rdf)) {
+				if (rdf::get_rdf_dir(paper.id) == "") {
+					problems.push_back(prefix + "No rdf directory for the publication");
+				} else if (std::string rdf_path = rdf::get_rdf_path(paper.id); !fs::is_regular_file(rdf_path, ec)) {
+					problems.push_back(prefix + "Missing rdf: " + rdf_path);
+				}
+			}
+
+			std::string pub_dir = pdf::get_dir(paper.id);
+			if (pub_dir == "") {
+				problems.push_back(prefix + "No title page directory for the publication");
+				continue;
+			}
+			// A regenerated html title page only needs the template, a patched one needs the page itself
+			std::string template_path = pdf::get_template_path(paper.pub);
+			bool has_template = paper.regen_html && template_path != "" && fs::is_regular_file(template_path, ec);
+			if (!done(paper, Step::Html) && !has_template) {
+				std::string html_path = pdf::get_path(paper.id, pdf::FileType::HTML);
+				if (!fs::is_regular_file(html_path, ec)) {
+					problems.push_back(prefix + "Missing html title page: " + html_path);
+				}
+			}
+			std::string general_dir = pub_dir + "/GeneralPDF" + paper.pub;
+			if (!done(paper, Step::Splice) && !fs::is_directory(general_dir, ec)) {
+				problems.push_back(prefix + "Missing directory: " + general_dir);
+			}
+		}
+		return problems;
+	}
+}
@@ -0,0 +1,376 @@
+#include "json.h"
+
+namespace json
+{
+	Value::Value(const bool value) : m_type(Type::Boolean), m_bool(value) {}
+
+	Value::Value(const int value) : m_type(Type::Number), m_number(value) {}
+
+	Value::Value(const long long value) : m_type(Type::Number), m_number(value) {}
+
+	Value::Value(const char* value) : m_type(Type::String), m_string(value) {}
+
+	Value::Value(std::string value) : m_type(Type::String), m_string(std::move(value)) {}
+
+	Value Value::make_array()
+	{
+		Value value;
+		value.m_type = Type::Array;
+		return value;
+	}
+
+	Value Value::make_object()
+	{
+		Value value;
+		value.m_type = Type::Object;
+		return value;
+	}
+
+	Value::Type Value::get_type() const { return m_type; }
+
+	static void expect(const Value::Type actual, const Value::Type expected, const char* name)
+	{
+		if (actual != expected) { throw ParseError(std::string("Expected ") + name); }
+	}
+
+	bool Value::as_bool() const
+	{
+		expect(m_type, Type::Boolean, "a boolean");
+		return m_bool;
+	}
+
+	long long Value::as_int() const
+	{
+		expect(m_type, Type::Number, "a number");
+		return m_number;
+	}
+
+	const std::string& Value::as_string() const
+	{
+		expect(m_type, Type::String, "a string");
+		return m_string;
+	}
+
+	const std::vector<Value>& Value::as_array() const
+	{
+		expect(m_type, Type::Array, "an array");
+		return m_items;
+	}
+
+	const std::vector<std::pair<std::string, Value>>& Value::as_object() const
+	{
+		expect(m_type, Type::Object, "an object");
+		return m_members;
+	}
+
+	// Appends to an array
+	Value& Value::push_back(Value value)
+	{
+		expect(m_type, Type::Array, "an array");
+		m_items.push_back(std::move(value));
+		return m_items.back();
+	}
+
+	// Replaces the value of a member or appends it
+	Value& Value::set(const std::string& key, Value value)
+	{
+		expect(m_type, Type::Object, "an object");
+		for (auto& member : m_members) {
+			if (member.first == key) {
+				member.second = std::move(value);
+				return member.second;
+			}
+		}
+		m_members.emplace_back(key, std::move(value));
+		return m_members.back().second;
+	}
+
+	// Returns nullptr if the object has no such member
+	const Value* Value::find(std::string_view key) const
+	{
+		if (m_type != Type::Object) { return nullptr; }
+		for (const auto& member : m_members) {
+			if (member.first == key) { return &member.second; }
+		}
+		return nullptr;
+	}
+
+	// Throws ParseError if the object has no such member
+	const Value& Value::at(std::string_view key) const
+	{
+		const Value* value = find(key);
+		if (value == nullptr) { throw ParseError("Missing member \"" + std::string(key) + "\""); }
+		return *value;
+	}
+
+	static void dump_string(const std::string& text, std::string& out)
+	{
+		out += '"';
+		for (char c : text) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					static const char hex[] = "0123456789abcdef";
+					out += "\\u00";
+					out += hex[(c >> 4) & 0xf];
+					out += hex[c & 0xf];
+				} else {
+					out += c;
+				}
+			}
+		}
+		out += '"';
+	}
+
+	// Writes the value with two spaces of indentation per level
+	std::string Value::dump() const
+	{
+		std::string out;
+		dump(out, 0);
+		out += '\n';
+		return out;
+	}
+
+	void Value::dump(std::string& out, const int depth) const
+	{
+		std::string indent(static_cast<size_t>(depth + 1) * 2, ' ');
+		switch (m_type) {
+		case Type::Null:
+			out += "null";
+			break;
+		case Type::Boolean:
+			out += m_bool ? "true" : "false";
+			break;
+		case Type::Number:
+			out += std::to_string(m_number);
+			break;
+		case Type::String:
+			dump_string(m_string, out);
+			break;
+		case Type::Array:
+			if (m_items.empty()) {
+				out += "[]";
+				break;
+			}
+			out += "[\n";
+			for (size_t i = 0; i < m_items.size(); ++i) {
+				out += indent;
+				m_items[i].dump(out, depth + 1);
+				out += (i + 1 < m_items.size()) ? ",\n" : "\n";
+			}
+			out += indent.substr(2) + "]";
+			break;
+		case Type::Object:
+			if (m_members.empty()) {
+				out += "{}";
+				break;
+			}
+			out += "{\n";
+			for (size_t i = 0; i < m_members.size(); ++i) {
+				out += indent;
+				dump_string(m_members[i].first, out);
+				out += ": ";
+				m_members[i].second.dump(out, depth + 1);
+				out += (i + 1 < m_members.size()) ? ",\n" : "\n";
+			}
+			out += indent.substr(2) + "}";
+			break;
+		}
+	}
+
+	// Recursive descent over the text, nesting is limited so a hostile file cannot exhaust the stack
+	class Parser
+	{
+	public:
+		explicit Parser(std::string_view text) : m_text(text) {}
+
+		Value parse_document()
+		{
+			Value value = parse_value(0);
+			skip_space();
+			if (m_pos != m_text.size()) { fail("Unexpected text after the document"); }
+			return value;
+		}
+	private:
+		static constexpr int MAX_DEPTH = 64;
+
+		[[noreturn]] void fail(const std::string& message) const
+		{
+			throw ParseError(message + " at offset " + std::to_string(m_pos));
+		}
+
+		void skip_space()
+		{
+			while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) { ++m_pos; }
+		}
+
+		bool consume(const char c)
+		{
+			skip_space();
+			if (m_pos < m_text.size() && m_text[m_pos] == c) {
+				++m_pos;
+				return true;
+			}
+			return false;
+		}
+
+		void literal(std::string_view word)
+		{
+			if (m_text.compare(m_pos, word.size(), word) != 0) { fail("Unexpected character"); }
+			m_pos += word.size();
+		}
+
+		Value parse_value(const int depth)
+		{
+			if (depth > MAX_DEPTH) { fail("Nesting too deep"); }
+			skip_space();
+			if (m_pos >= m_text.size()) { fail("Unexpected end of document"); }
+			char c = m_text[m_pos];
+			if (c == '{') { return parse_object(depth); }
+			if (c == '[') { return parse_array(depth); }
+			if (c == '"') { return Value(parse_string()); }
+			if (c == 't') { literal("true"); return Value(true); }
+			if (c == 'f') { literal("false"); return Value(false); }
+			if (c == 'n') { literal("null"); return Value(); }
+			if (c == '-' || (c >= '0' && c <= '9')) { return parse_number(); }
+			fail("Unexpected character");
+		}
+
+		Value parse_object(const int depth)
+		{
+			++m_pos;
+			Value object = Value::make_object();
+			if (consume('}')) { return object; }
+			do {
+				skip_space();
+				if (m_pos >= m_text.size() || m_text[m_pos] != '"') { fail("Expected a member name"); }
+				std::string key = parse_string();
+				if (!consume(':')) { fail("Expected ':'"); }
+				object.set(key, parse_value(depth + 1));
+			} while (consume(','));
+			if (!consume('}')) { fail("Expected ',' or '}'"); }
+			return object;
+		}
+
+		Value parse_array(const int depth)
+		{
+			++m_pos;
+			Value array = Value::make_array();
+			if (consume(']')) { return array; }
+			do {
+				array.push_back(parse_value(depth + 1));
+			} while (consume(','));
+			if (!consume(']')) { fail("Expected ',' or ']'"); }
+			return array;
+		}
+
+		Value parse_number()
+		{
+			size_t begin = m_pos;
+			if (m_text[m_pos] == '-') { ++m_pos; }
+			size_t digits = m_pos;
+			while (m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9') { ++m_pos; }
+			if (m_pos == digits) { fail("Expected a digit"); }
+			if (m_pos < m_text.size() && (m_text[m_pos] == '.' || m_text[m_pos] == 'e' || m_text[m_pos] == 'E')) {
+				fail("Only integers are supported");
+			}
+			try {
+				return Value(std::stoll(std::string(m_text.substr(begin, m_pos - begin))));
+			} catch (const std::out_of_range&) {
+				fail("Number out of range");
+			}
+		}
+
+		uint32_t parse_hex4()
+		{
+			if (m_pos + 4 > m_text.size()) { fail("Truncated \\u escape"); }
+			uint32_t code = 0;
+			for (int i = 0; i < 4; ++i) {
+				char c = m_text[m_pos++];
+				code <<= 4;
+				if (c >= '0' && c <= '9') { code |= static_cast<uint32_t>(c - '0'); }
+				else if (c >= 'a' && c <= 'f') { code |= static_cast<uint32_t>(c - 'a' + 10); }
+				else if (c >= 'A' && c <= 'F') { code |= static_cast<uint32_t>(c - 'A' + 10); }
+				else { fail("Invalid \\u escape"); }
+			}
+			return code;
+		}
+
+		static void append_utf8(std::string& out, const uint32_t code)
+		{
+			if (code < 0x80) {
+				out += static_cast<char>(code);
+			} else if (code < 0x800) {
+				out += static_cast<char>(0xc0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			} else if (code < 0x10000) {
+				out += static_cast<char>(0xe0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			} else {
+				out += static_cast<char>(0xf0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			}
+		}
+
+		std::string parse_string()
+		{
+			++m_pos;
+			std::string out;
+			while (true) {
+				if (m_pos >= m_text.size()) { fail("Unterminated string"); }
+				char c = m_text[m_pos++];
+				if (c == '"') { return out; }
+				if (static_cast<unsigned char>(c) < 0x20) { fail("Control character in string"); }
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (m_pos >= m_text.size()) { fail("Unterminated string"); }
+				char escaped = m_text[m_pos++];
+				switch (escaped) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					uint32_t code = parse_hex4();
+					// Characters outside the basic plane are written as a surrogate pair
+					if (code >= 0xd800 && code < 0xdc00 && m_text.compare(m_pos, 2, "\\u") == 0) {
+						m_pos += 2;
+						uint32_t low = parse_hex4();
+						if (low < 0xdc00 || low >= 0xe000) { fail("Invalid surrogate pair"); }
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					}
+					append_utf8(out, code);
+					break;
+				}
+				default:
+					fail("Invalid escape");
+				}
+			}
+		}
+
+		std::string_view m_text;
+		size_t m_pos = 0;
+	};
+
+	// Throws ParseError for anything that is not a single JSON value
+	Value Value::parse(std::string_view text)
+	{
+		return Parser(text).parse_document();
+	}
+}
@@ -0,0 +1,351 @@
+#include "logging.h"
+
+namespace logging
+{
+	namespace fs = std::filesystem;
+
+	struct Record
+	{
+		Level level;
+		std::chrono::system_clock::time_point time;
+		std::string paper;
+		const char* stage;
+		std::string message;
+	};
+
+	// Bounded multi-producer queue drained by the writer thread, producers claim a slot with a
+	// single compare-exchange and never take a lock (Vyukov's bounded queue)
+	// A producer that finds the queue full yields until the writer made room, records are never dropped
+	class RecordQueue
+	{
+	public:
+		explicit RecordQueue(const size_t capacity) : m_slots(capacity), m_mask(capacity - 1)
+		{
+			for (size_t i = 0; i < capacity; ++i) { m_slots[i].sequence.store(i, std::memory_order_relaxed); }
+		}
+
+		bool try_push(Record& record)
+		{
+			size_t position = m_enqueue.load(std::memory_order_relaxed);
+			for (;;) {
+				Slot& slot = m_slots[position & m_mask];
+				size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+				if (difference == 0) {
+					if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						slot.record = std::move(record);
+						slot.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = m_enqueue.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Only the writer thread pops
+		bool try_pop(Record& record)
+		{
+			size_t position = m_dequeue;
+			Slot& slot = m_slots[position & m_mask];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence != position + 1) { return false; }
+			record = std::move(slot.record);
+			slot.sequence.store(position + m_mask + 1, std::memory_order_release);
+			m_dequeue = position + 1;
+			return true;
+		}
+
+		// Only the writer thread checks, true if the next record can be popped
+		bool ready() const
+		{
+			return m_slots[m_dequeue & m_mask].sequence.load(std::memory_order_acquire) == m_dequeue + 1;
+		}
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			Record record;
+		};
+
+		std::vector<Slot> m_slots;
+		const size_t m_mask;
+		alignas(64) std::atomic<size_t> m_enqueue{ 0 };
+		alignas(64) size_t m_dequeue = 0;
+	};
+
+	// Appends to a file and moves it aside to <file>.1 once it reaches its size limit
+	class RotatingFile
+	{
+	public:
+		RotatingFile(const std::string& path, const uint64_t max_bytes, const size_t max_files)
+			: m_path(path), m_max_bytes(max_bytes), m_max_files(max_files)
+		{
+			open();
+		}
+
+		~RotatingFile()
+		{
+			if (m_file != nullptr) { std::fclose(m_file); }
+		}
+
+		void write(const std::string& line)
+		{
+			if (m_file != nullptr && m_size > 0 && m_size + line.size() > m_max_bytes) { rotate(); }
+			if (m_file == nullptr) { return; }
+			std::fwrite(line.data(), 1, line.size(), m_file);
+			m_size += line.size();
+		}
+
+		void flush()
+		{
+			if (m_file != nullptr) { std::fflush(m_file); }
+		}
+	private:
+		void open()
+		{
+			m_file = std::fopen(m_path.c_str(), "ab");
+			if (m_file == nullptr) {
+				std::fprintf(stderr, "Error: Unable to open the log file %s\n", m_path.c_str());
+				return;
+			}
+			std::error_code ec;
+			uintmax_t size = fs::file_size(m_path, ec);
+			m_size = ec ? 0 : static_cast<uint64_t>(size);
+		}
+
+		// <file>.N-1 -> <file>.N, ..., <file> -> <file>.1, the oldest one is dropped
+		void rotate()
+		{
+			std::fclose(m_file);
+			m_file = nullptr;
+			std::error_code ec;
+			if (m_max_files == 0) {
+				fs::remove(m_path, ec);
+			} else {
+				fs::remove(m_path + "." + std::to_string(m_max_files), ec);
+				for (size_t i = m_max_files; i > 1; --i) {
+					fs::rename(m_path + "." + std::to_string(i - 1), m_path + "." + std::to_string(i), ec);
+				}
+				fs::rename(m_path, m_path + ".1", ec);
+			}
+			open();
+		}
+
+		std::string m_path;
+		uint64_t m_max_bytes;
+		size_t m_max_files;
+		std::FILE* m_file = nullptr;
+		uint64_t m_size = 0;
+	};
+
+	static const char* level_name(const Level level)
+	{
+		switch (level) {
+		case Level::Debug: return "DEBUG";
+		case Level::Info: return "INFO";
+		case Level::Warning: return "WARN";
+		default: return "ERROR";
+		}
+	}
+
+	// Returns the level for "debug", "info", "warning" or "error", false for anything else
+	bool parse_level(std::string_view name, Level& level)
+	{
+		if (name == "debug") { level = Level::Debug; }
+		else if (name == "info") { level = Level::Info; }
+		else if (name == "warning") { level = Level::Warning; }
+		else if (name == "error") { level = Level::Error; }
+		else { return false; }
+		return true;
+	}
+
+	// Everything the writer owns, the sinks are only touched by one thread at a time
+	struct Logger
+	{
+		Options options;
+		std::unique_ptr<RotatingFile> file;
+		std::unique_ptr<RecordQueue> queue;
+		std::thread writer;
+		// Set by producers when the writer may be asleep, the writer waits on it
+		std::atomic<bool> signaled{ false };
+		std::atomic<bool> stopping{ false };
+		std::atomic<bool> running{ false };
+		// Serializes writes made without the writer thread, before start() and after stop()
+		std::mutex direct_mutex;
+	};
+
+	static Logger& logger()
+	{
+		static Logger instance;
+		return instance;
+	}
+
+	static std::atomic<Level> min_level{ Level::Info };
+
+	static thread_local std::string current_paper;
+	static thread_local const char* current_stage = nullptr;
+
+	// Console lines keep the message as it was logged, prefixed by the paper and stage it belongs to
+	// File lines also carry the time and level, without the blank lines used to separate console output
+	static void emit(Logger& state, const Record& record)
+	{
+		std::string tag;
+		if (!record.paper.empty()) {
+			tag = "[" + record.paper;
+			if (record.stage != nullptr) { tag += std::string("/") + record.stage; }
+			tag += "] ";
+		}
+
+		if (state.options.console) {
+			std::string line;
+			size_t body = record.message.find_first_not_of('\n');
+			if (body == std::string::npos) { body = record.message.size(); }
+			line.reserve(record.message.size() + tag.size() + 1);
+			line.append(record.message, 0, body);
+			line += tag;
+			line.append(record.message, body, std::string::npos);
+			line += '\n';
+			std::FILE* stream = (record.level >= Level::Warning || state.options.console_stderr_only) ? stderr : stdout;
+			std::fwrite(line.data(), 1, line.size(), stream);
+		}
+
+		if (state.file) {
+			std::time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+			long long millis = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+			std::tm local_time{};
+#ifdef _WIN32
+			localtime_s(&local_time, &seconds);
+#else
+			localtime_r(&seconds, &local_time);
+#endif
+			char stamp[48];
+			size_t length = std::strftime(stamp, sizeof(stamp), "%F %T", &local_time);
+			std::snprintf(stamp + length, sizeof(stamp) - length, ".%03lld %-5s ", millis, level_name(record.level));
+
+			size_t body = record.message.find_first_not_of('\n');
+			if (body == std::string::npos) { return; }
+			std::string line = stamp + tag;
+			line.append(record.message, body, std::string::npos);
+			line += '\n';
+			state.file->write(line);
+		}
+	}
+
+	static void flush(Logger& state)
+	{
+		if (state.options.console) {
+			std::fflush(stdout);
+			std::fflush(stderr);
+		}
+		if (state.file) { state.file->flush(); }
+	}
+
+	// Writes records as they come and flushes once the queue runs dry, not after every line
+	static void drain(Logger& state)
+	{
+		Record record;
+		for (;;) {
+			bool wrote = false;
+			while (state.queue->try_pop(record)) {
+				emit(state, record);
+				wrote = true;
+			}
+			if (wrote) {
+				flush(state);
+				continue;
+			}
+
+			// A record pushed before the flag is cleared is still seen by the check below
+			state.signaled.store(false);
+			if (state.queue->ready()) { continue; }
+			if (state.stopping.load()) { break; }
+			state.signaled.wait(false);
+		}
+	}
+
+	// Starts the thread that writes the records
+	void start(const Options& options)
+	{
+		Logger& state = logger();
+		if (state.running.load()) { return; }
+
+		state.options = options;
+		min_level.store(options.min_level);
+		if (!options.file_path.empty()) {
+			state.file = std::make_unique<RotatingFile>(options.file_path, options.max_file_bytes, options.max_files);
+		}
+		state.queue = std::make_unique<RecordQueue>(8192);
+		state.stopping.store(false);
+		state.writer = std::thread(drain, std::ref(state));
+		state.running.store(true);
+	}
+
+	// Writes every queued record and joins the writer thread
+	void stop()
+	{
+		Logger& state = logger();
+		if (!state.running.exchange(false)) { return; }
+
+		state.stopping.store(true);
+		state.signaled.store(true);
+		state.signaled.notify_one();
+		state.writer.join();
+
+		// Records of threads that were still logging while the writer stopped
+		std::lock_guard<std::mutex> lock(state.direct_mutex);
+		Record record;
+		while (state.queue->try_pop(record)) { emit(state, record); }
+		flush(state);
+	}
+
+	Session::Session(const Options& options) { start(options); }
+
+	Session::~Session() { stop(); }
+
+	Context::Context(const std::string& paper, const char* stage) : m_previous_paper(current_paper), m_previous_stage(current_stage)
+	{
+		current_paper = paper;
+		current_stage = stage;
+	}
+
+	Context::~Context()
+	{
+		current_paper = std::move(m_previous_paper);
+		current_stage = m_previous_stage;
+	}
+
+	// True if records of the level are written at all
+	bool enabled(const Level level)
+	{
+		return level >= min_level.load(std::memory_order_relaxed);
+	}
+
+	// Queues a record tagged with the calling thread's context, never waits for any output
+	void write(const Level level, std::string message)
+	{
+		if (!enabled(level)) { return; }
+		Record record{ level, std::chrono::system_clock::now(), current_paper, current_stage, std::move(message) };
+
+		Logger& state = logger();
+		if (!state.running.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(state.direct_mutex);
+			emit(state, record);
+			flush(state);
+			return;
+		}
+
+		while (!state.queue->try_push(record)) { std::this_thread::yield(); }
+		// Only the first record after the writer went idle pays for waking it
+		if (!state.signaled.exchange(true)) { state.signaled.notify_one(); }
+	}
+
+	Line::Line(const Level level) : m_level(level), m_enabled(enabled(level)) {}
+
+	Line::~Line()
+	{
+		if (m_enabled) { write(m_level, std::move(m_text).str()); }
+	}
+}
@@ -1,484 +1,860 @@
 #include "sql_agent.h"
 #include "file_actions.h"
 #include "sql_actions.h"
+#include "paper_catalog.h"
+#include "fixture_store.h"
+#include "xdevapi_store.h"
 #include "rdf_actions.h"
+#include "rdf_index.h"
 #include "pdf_actions.h"
+#include "pipeline.h"
+#include "parallel.h"
+#include "issue_plan.h"
+#include "issue_batch.h"
+#include "archive_scan.h"
+#include "archive_audit.h"
+#include "trace.h"
+#include "logging.h"
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
-int main(int argc, char* argv[]) 
+// The publication directories of the archive, pubs/<ID>/<YYYY>/Volume<NN>
+static const std::string ARCHIVE_ROOT = "C:/inetpub/vhosts/accessecon.com/httpdocs/pubs";
+
+// Where the paper rows come from, a fixture replaces the database server when its path is set
+struct DatabaseOptions
 {
-    /* Testing and capturing .exe inputs */
-    if (argc != 9) {
-        std::cerr << "Usage: " << argv[0] << " <directory_path> <new_volume_number> <new_issue_number> <last_article_number> <titlepage-offset> <db_schema_name> <username> <password>" << std::endl;
+    std::string fixture_path;
+    std::string schema;
+    std::string username;
+    std::string password;
+    // Whether the server is reached through the X Protocol instead of the classic protocol
+    bool x_protocol = false;
+};
+
+// Loads the fixture or connects to the local database server,
+// returns nullptr after reporting why it could not
+static std::unique_ptr<sql_agent::PaperStore> open_store(const DatabaseOptions& options)
+{
+    if (options.fixture_path != "") {
+        try {
+            return std::make_unique<sql_agent::FixtureStore>(options.fixture_path);
+        } catch (const std::exception& e) {
+            logging::error() << "Error: " << e.what();
+            return nullptr;
+        }
+    }
+
+    if (options.x_protocol) {
+        try {
+            return std::make_unique<sql_agent::XDevApiPaperStore>("127.0.0.1", 33060, options.username, options.password, options.schema);
+        } catch (const std::exception& e) {
+            logging::error() << "Error: Unable to open an X Protocol session: " << e.what();
+            return nullptr;
+        }
+    }
+
+    auto store = std::make_unique<sql_agent::MySqlPaperStore>();
+    sql_agent::MySQL_Interface& mysql_db = store->get_interface();
+    mysql_db.set_driver();
+    mysql_db.set_server(sql_agent::Protocol::TCP, "127.0.0.1", "3306");
+    mysql_db.set_user(options.username, options.password);
+    mysql_db.set_schema(options.schema);
+    try {
+        mysql_db.set_connection();
+    } 
+    catch (const std::exception& e) {
+        logging::error() << "Error: " << e.what();
+        return nullptr;
+    }
+    if (mysql_db.get_connection() == nullptr) {
+        logging::error() << "Error: Unable to connect to the database.";
+        return nullptr;
+    }
+    return store;
+}
+
+// Tools shared by the workers of every issue in a run
+struct IssueTools
+{
+    IssueTools(const size_t tool_jobs, const bool native_title_pages, const bool use_cache)
+        : runner(tool_jobs), use_cache(use_cache)
+    {
+        if (native_title_pages) { title_renderer = std::make_unique<pdf::TitlePageRenderer>(); }
+    }
+
+    // External tools are started without a shell, at most tool_jobs at a time
+    process::ProcessRunner runner;
+    // Fonts are loaded once here and shared by every worker
+    std::unique_ptr<pdf::TitlePageRenderer> title_renderer;
+    // Templates are compiled once per publication, the first time one of its papers needs it
+    pdf::TitleTemplates html_templates;
+    // Title pages whose html and paper did not change since the last run are not converted or spliced again
+    pdf::RenderCache render_cache;
+    bool use_cache;
+};
+
+// Checks every file the plan reads or replaces, returns false after reporting each problem
+static bool preflight_issue(const pipeline::IssuePlan& plan, const pipeline::StepJournal* journal)
+{
+    // Nothing is touched unless every paper can be applied
+    std::vector<std::string> problems = pipeline::preflight(plan, journal);
+    if (!problems.empty()) {
+        for (const auto& problem : problems) { logging::error() << "Pre-flight: " << problem; }
+        logging::error() << "Error: " << problems.size() << " problems found, the plan was not applied.";
+        return false;
+    }
+    logging::info() << "Pre-flight passed for " << plan.papers.size() << " papers in " << plan.directory;
+    return true;
+}
+
+// Updates the database in batches, processes the files of every paper on the given number of jobs
+// and commits the updates of the issue once every paper was processed
+// With a journal every completed step is recorded, and steps it already holds are skipped
+static bool apply_issue(const pipeline::IssuePlan& plan, sql_agent::PaperStore& store, IssueTools& tools,
+                        const size_t jobs, pipeline::StepJournal* journal)
+{
+    // All paper updates for the issue are committed together at the end of the run
+    sql_agent::Transaction issue_transaction(store);
+    try {
+        std::vector<sql_agent::PaperUpdate> updates;
+        updates.reserve(plan.papers.size());
+        for (const auto& paper : plan.papers) {
+            if (journal && journal->is_done(paper.id, pipeline::Step::Sql)) { continue; }
+            sql_agent::PaperUpdate& update = updates.emplace_back(paper.id);
+            for (const auto& column : paper.columns) { update.set(column.first, column.second); }
+        }
+        int affected = store.update_batch(updates);
+        logging::info() << "Updated " << affected << " rows for " << updates.size() << " papers.";
+    } catch (const std::exception& e) {
+        logging::error() << "Query error: " << e.what();
+        logging::error() << "Failed to update the SQL Database, no file was changed.";
+        return false;
+    }
+
+    pipeline::IssueContext context(plan.settings, tools.runner);
+    context.journal = journal;
+    if (plan.settings.native_title_pages) { context.title_renderer = tools.title_renderer.get(); }
+    if (plan.settings.regen_html) { context.html_templates = &tools.html_templates; }
+    if (tools.use_cache) { context.render_cache = &tools.render_cache; }
+
+    logging::info() << "\nProcessing " << plan.papers.size() << " papers with " << jobs << " jobs.";
+    std::atomic<size_t> papers_completed{ 0 };
+    parallel::for_each_index(jobs, plan.papers.size(), [&](size_t i) {
+        const pipeline::PaperPlan& paper = plan.papers[i];
+        logging::info() << "\nWorking on: " << paper.old_filename;
+        if (pipeline::process_files(context, paper) == pipeline::Stage::TitlePages) {
+            ++papers_completed;
+        } else {
+            logging::error() << "Error (ID: " << paper.id << "): Not every update was applied to " << paper.old_filename;
+        }
+    });
+    logging::info() << "\nCompleted " << papers_completed << " of " << plan.papers.size() << " papers in " << plan.directory;
+
+    try {
+        issue_transaction.commit();
+        logging::info() << "\nCommitted SQL Database updates for the issue in " << plan.directory;
+    } catch (const std::exception& e) {
+        logging::error() << "Query error: " << e.what();
+        logging::error() << "Failed to commit the SQL Database updates for the issue.";
+        return false;
+    }
+    // The updates only count as done once they are committed, a run that dies before sends them again
+    if (journal) {
+        for (const auto& paper : plan.papers) {
+            if (!journal->is_done(paper.id, pipeline::Step::Sql)) { journal->record(paper.id, pipeline::Step::Sql); }
+        }
+        journal->sync();
+    }
+    return true;
+}
+
+// Journal of an issue run without --journal, next to its directory, e.g. C:/upload/EB-44-2.journal
+static std::string default_journal_path(const std::string& directory)
+{
+    fs::path path(directory);
+    if (!path.has_filename()) { path = path.parent_path(); }
+    return path.string() + ".journal";
+}
+
+// A journal at its default path is removed once every paper of the plan completed, or when nothing was
+// changed at all, along with the plan when it was only saved for the journal, so the next run of the issue
+// does not take it for a crashed one
+// Journals given with --journal are kept, and so is every journal of a run that stopped half way
+static void finish_journal(std::unique_ptr<pipeline::StepJournal>& journal, const pipeline::IssuePlan& plan,
+                           const std::string& plan_path, const std::string& journal_path)
+{
+    bool completed = std::all_of(plan.papers.begin(), plan.papers.end(), [&](const pipeline::PaperPlan& paper) {
+        return journal->is_done(paper.id, pipeline::Step::Sql) && journal->is_done(paper.id, pipeline::Step::Splice);
+    });
+    if (!completed && journal->get_started() != 0) {
+        logging::warning() << "Not every paper was completed, continue the run with --resume " << journal_path;
+        return;
+    }
+
+    std::error_code ec;
+    bool default_path = fs::equivalent(journal_path, default_journal_path(plan.directory), ec) ||
+                        fs::equivalent(journal_path, plan_path + ".journal", ec);
+    if (!default_path) { return; }
+    bool saved_plan = fs::equivalent(plan_path, journal_path + ".plan.json", ec);
+    journal.reset();
+    fs::remove(journal_path, ec);
+    if (saved_plan) { fs::remove(plan_path, ec); }
+}
+
+// Executes a plan written by --plan: every target is checked first, then the database
+// is updated in batches and the files of every paper are processed on the given number of jobs
+// Every completed step is recorded in the journal, <plan_path>.journal unless one is given,
+// and steps it already holds are skipped
+static int apply_plan(const std::string& plan_path, const DatabaseOptions& database, size_t jobs, size_t tool_jobs,
+                      const file::SyncPolicy sync, std::string journal_path, const bool use_cache)
+{
+    std::ifstream plan_file(plan_path, std::ios::binary);
+    if (!plan_file) {
+        logging::error() << "Error: Could not open plan " << plan_path;
         return 1;
     }
-    std::string directoryPath = argv[1];
-    // Check if the directory exists
-    if (!file::directory_exists(directoryPath)) {
-        std::cerr << "Error: Directory does not exist." << std::endl;
+    std::string plan_text((std::istreambuf_iterator<char>(plan_file)), std::istreambuf_iterator<char>());
+
+    pipeline::IssuePlan plan;
+    try {
+        plan = pipeline::parse_plan(plan_text);
+    } catch (const json::ParseError& e) {
+        logging::error() << "Error: Invalid plan " << plan_path << ": " << e.what();
         return 1;
     }
-    int newVolumeNum = std::stoi(argv[2]);
-    // Check if the new volume number makes sense
-    if (newVolumeNum < 20 || newVolumeNum >= 100) {
-        std::cerr << "Error: invalid new volume number. Must be in the range of [20,99]." << std::endl;
+    plan.settings.sync = sync;
+
+    // The database is only committed once every paper was processed, without a journal a run that
+    // stopped half way could neither be rolled forward nor find its renamed papers again
+    if (journal_path == "") { journal_path = plan_path + ".journal"; }
+    std::unique_ptr<pipeline::StepJournal> journal;
+    try {
+        journal = std::make_unique<pipeline::StepJournal>(journal_path, fs::absolute(plan_path).string());
+    } catch (const std::exception& e) {
+        logging::error() << "Error: " << e.what();
         return 1;
     }
-    int newIssueNum = std::stoi(argv[3]);
+    if (journal->get_started() != 0) {
+        logging::info() << "Resuming from " << journal_path << ", " << journal->get_started() << " papers already have completed steps.";
+    }
+
+    bool applied = false;
+    std::unique_ptr<sql_agent::PaperStore> store;
+    if (preflight_issue(plan, journal.get()) && (store = open_store(database))) {
+        IssueTools tools(tool_jobs, plan.settings.native_title_pages, use_cache);
+        applied = apply_issue(plan, *store, tools, jobs, journal.get());
+        if (use_cache) {
+            logging::info() << tools.render_cache.get_hits() << " title pages reused from the render cache.";
+            tools.render_cache.save(sync);
+        }
+    }
+    finish_journal(journal, plan, plan_path, journal_path);
+    return applied ? 0 : 1;
+}
+
+// Saves the plan of an issue of a batch next to its journal and applies it, the run can be continued
+// with --resume like a run of the issue on its own, returns false if the issue was not applied
+static bool apply_journaled_issue(const pipeline::IssuePlan& plan, sql_agent::PaperStore& store, IssueTools& tools, const size_t jobs)
+{
+    std::string journal_path = default_journal_path(plan.directory);
+    std::string plan_path = journal_path + ".plan.json";
+    std::unique_ptr<pipeline::StepJournal> journal;
+    try {
+        file::write_file_atomic(plan_path, pipeline::serialize_plan(plan), plan.settings.sync, std::ios::binary);
+        journal = std::make_unique<pipeline::StepJournal>(journal_path, fs::absolute(plan_path).string());
+    } catch (const std::exception& e) {
+        logging::error() << "Error: " << e.what();
+        logging::error() << "Could not start the journal of " << plan.directory;
+        return false;
+    }
+
+    bool applied = preflight_issue(plan, journal.get()) && apply_issue(plan, store, tools, jobs, journal.get());
+    finish_journal(journal, plan, plan_path, journal_path);
+    return applied;
+}
+
+// Reports why the numbers of an issue cannot be used, returns false if any of them is out of range
+static bool check_issue(const pipeline::IssueJob& job)
+{
+    // Check if the directory exists
+    if (!file::directory_exists(job.directory)) {
+        logging::error() << "Error: Directory does not exist: " << job.directory;
+        return false;
+    }
+    // Check if the new volume number makes sense
+    if (job.volume < 20 || job.volume >= 100) {
+        logging::error() << "Error: invalid new volume number. Must be in the range of [20,99].";
+        return false;
+    }
     // Check if the new issue number makes sense
-    if (newIssueNum < 0 || newIssueNum >= 10) {
-       std::cerr << "Error: invalid new issue number. Must be in the range of [0,9]." << std::endl;
-       return 1;
+    if (job.issue < 0 || job.issue >= 10) {
+       logging::error() << "Error: invalid new issue number. Must be in the range of [0,9].";
+       return false;
     }
     // This should be initialized to the last paper's sequence number published in a volume
     // For example: EB-V44-I1-P26, newPaperNum should be set to 26
-    int newPaperNum = std::stoi(argv[4]);
-    if (newPaperNum < 0) {
-        std::cerr << "Error: invalid last article number. Should be equivalent to the sequence number for the last paper published to the desired volume." << std::endl;
-        std::cerr << "For example: if the last published article in volume 44 has the filename 'V44-I1-P26', ";
-        std::cerr << "then last article number should be set to 26." << std::endl;
-        std::cerr << "If this is a new volume with no prior issues then set last article number to 0." << std::endl;
-        return 1;
+    if (job.last_article < 0) {
+        logging::error() << "Error: invalid last article number. Should be equivalent to the sequence number for the last paper published to the desired volume.";
+        logging::error() << "For example: if the last published article in volume 44 has the filename 'V44-I1-P26', " << "then last article number should be set to 26.";
+        logging::error() << "If this is a new volume with no prior issues then set last article number to 0.";
+        return false;
     }
     // Check if the first page of the paper itself makes sense
     // This value should equal the page number of the first page after any previously generated title pages
-    int titleOffset = std::stoi(argv[5]);
-    if (titleOffset < 0 || titleOffset > 4) {
-        std::cerr << "Error: unexpected value for title page offset. Verify the page number for the introduction section is in the range [0,4]." << std::endl;
-        return 1;
+    if (job.title_offset < 0 || job.title_offset > 4) {
+        logging::error() << "Error: unexpected value for title page offset. Verify the page number for the introduction section is in the range [0,4].";
+        return false;
     }
-    std::string schema = argv[6];
-    std::string username = argv[7];
-    std::string password = argv[8];
+    return true;
+}
 
-    /* Build MySQL Interface and try to connect to the DB Server */
-    sql_agent::MySQL_Interface mysql_db;
-    mysql_db.set_driver();
-    mysql_db.set_server(sql_agent::Protocol::TCP, "127.0.0.1", "3306");
-    mysql_db.set_user(username, password);
-    mysql_db.set_schema(schema);
-    try {
-        mysql_db.set_connection();
-    } 
-    catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
-    }
-    sql::Statement* query = mysql_db.get_connection()->createStatement();
-    sql::ResultSet* result = nullptr;
-
-    /* Build array of all .pdf files in array, and verify they match the expected naming convention */
-    std::vector<fs::directory_entry> file_vec;
-    file::build_file_vec(directoryPath, file_vec);
+/* Build array of all .pdf files in array, and verify they match the expected naming convention */
+static bool collect_papers(const std::string& directory, std::vector<file::PaperEntry>& file_vec)
+{
+    file::build_file_vec(directory, file_vec);
     file::sort_files(file_vec);
-
+    if (file_vec.empty()) {
+        logging::error() << "Error: No .pdf files following the naming convention were found in " << directory;
+        return false;
+    }
+    return true;
+}
+
+// Fills the settings of the issue, the sync policy and title page options are left as they are
+// When the volume already has published papers, paper_num becomes the number of the first paper
+// of the issue and last_pub_page the last page of the paper before it
+// Returns false after reporting why the last published paper could not be found
+static bool settings_for_issue(const pipeline::IssueJob& job, const std::vector<file::PaperEntry>& file_vec,
+                               sql_agent::PaperStore& store, pipeline::IssueSettings& settings,
+                               int& paper_num, std::string& last_pub_page)
+{
     // Convert integers to strings for updating the database for an entry
-    std::string year_str = std::to_string((newVolumeNum - 20) + 2000);
-    std::string vol_str = std::to_string(newVolumeNum);
-    std::string iss_str = std::to_string(newIssueNum);
-    std::array<std::string, 2> date_array = { pdf::date_short(newIssueNum), pdf::date_month(newIssueNum) };
+    std::string year_str = std::to_string((job.volume - 20) + 2000);
+    std::string vol_str = std::to_string(job.volume);
+    std::string iss_str = std::to_string(job.issue);
 
     // Check assumed last published paper and initial newPaperNum passes basic sanity checks
     bool prev_published_paper = false;
-    std::string l_paper_pub; 
-    std::string l_paper_dir; 
-    std::string l_paper_sql_path; 
-    std::string l_pub_id;
-    if (newPaperNum != 0) {
-        l_paper_pub = rdf::get_acronym(file_vec[0].path().filename().string(), '-');
-        l_paper_dir = "/Pubs/" + l_paper_pub + "/" + year_str + "/Volume" + vol_str;
+    paper_num = job.last_article;
+    // Only consulted when renumbering the papers of an existing volume
+    last_pub_page = "";
+    if (job.last_article != 0) {
+        std::string l_paper_pub = job.publication.empty() ? file_vec[0].filename.substr(0, file_vec[0].key.acronym_len) : job.publication;
+        std::string l_paper_dir = "/Pubs/" + l_paper_pub + "/" + year_str + "/Volume" + vol_str;
+        // The ID, path and last page of the last paper are read in a single lookup
+        sql_agent::PaperRow l_paper;
         try {
-            l_paper_sql_path = sql_agent::retrieve_field(query, result, std::to_string(newPaperNum), l_paper_dir, "Published_PDF_File");
-            l_pub_id = sql_agent::retrieve_field(query, result, l_paper_sql_path, "ID");
-        } catch (const sql::SQLException& e) {
-            std::cerr << "Query error: " << e.what() << std::endl;
-            std::cerr << "Could not find an ID for that last paper published in Volume " + vol_str << std::endl;
-            return 1;
+            if (!store.find_last_paper(l_paper_dir, job.last_article, l_paper)) {
+                logging::error() << "Error: No paper " << job.last_article << " was found in " << l_paper_dir;
+                logging::error() << "Could not find an ID for that last paper published in Volume " << vol_str;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logging::error() << "Query error: " << e.what();
+            logging::error() << "Could not find an ID for that last paper published in Volume " << vol_str;
+            return false;
         }
-        std::cout << "Deduced last published paper in " + year_str + ", volume " + vol_str + " is: " + l_paper_sql_path << std::endl;
+        logging::info() << "Deduced last published paper in " << year_str << ", volume " << vol_str << " is: " << l_paper.published_pdf_file;
 
-        std::string l_pub_dir = pdf::get_dir(l_pub_id);
-        std::string l_paper_filename = pdf::get_filename(l_paper_sql_path, '/');
+        std::string l_pub_dir = pdf::get_dir(l_paper.id);
+        std::string l_paper_filename = pdf::get_filename(l_paper.published_pdf_file, '/');
         // example: C:/inetpub/vhosts/accessecon.com/httpdocs/pubs/ID/YYYY/Volume##/filename
         std::string l_pub_full_path = l_pub_dir + "/" + year_str + "/Volume" + vol_str + "/" + l_paper_filename;
         if (fs::exists(l_pub_full_path)) {
-            std::cout << "Found: " + l_pub_full_path << std::endl;
+            logging::info() << "Found: " << l_pub_full_path;
         } else {
-            std::cerr << "Error: Expected file at location " + l_pub_full_path + " to exist"; 
-            std::cout << " and contain the last published paper in the targeted Volume " + vol_str << std::endl;
+            logging::error() << "Error: Expected file at location " << l_pub_full_path << " to exist and contain the last published paper in the targeted Volume " << vol_str;
             // Remove for debugging:
-            return 1;
+            return false;
         }
         prev_published_paper = true;
+        last_pub_page = l_paper.total_numpages;
+        paper_num += 1;
     } else {
-        std::cout << "Continuing with script and assuming no previously published papers exist in the targeted volume." << std::endl;
-    }
-    
-    /* LOOP OPERATION OVERVIEW
-    * 1) Verify the file entry is acceptable to use
-    * 2) Reset loop variables
-    * 3) Retrieve the ID of the file from the database, 
-         if we find an ID do the following:
-    *   3.1) Execute query to UPDATE Volume_Number
-    *   3.2) Execute query to UPDATE NumIssue
-    *   3.3) Execute query to UPDATE citationString
-    *   3.4) Execute query to UPDATE Published_PDF_File
-    *       3.4.1) If we updated the published pdf filepath 
-                   then set pub_path_updated = true;
-    * 4) If pub_path_updated = true then,
-    *   4.1) Update the filename in file explorer to match 
-             the new Published_PDF_File field in the database
-    * 5) If local_path_update = true then,
-    *   5.1) Update the associated rdf
-    * 6) If local_path_updated = true && rdf_updated = true
-    *   6.1) Update the title page for published paper entry
-    */
-    if (prev_published_paper) {
-        std::string last_paper_id = l_pub_id;
-        std::string last_pub_page = sql_agent::retrieve_field(query, result, l_paper_sql_path, "TotalNumpages");
-        newPaperNum += 1;
-        std::string paper_num_str = std::to_string(newPaperNum);
+        logging::info() << "Continuing with script and assuming no previously published papers exist in the targeted volume.";
+    }
 
-        for (const auto& entry : file_vec) {
-            if (!fs::is_regular_file(entry) && !file::is_pdf(entry.path().filename().string())) continue;
+    settings.volume = job.volume;
+    settings.issue = job.issue;
+    settings.title_offset = job.title_offset;
+    settings.renumber = prev_published_paper;
+    settings.year_str = year_str;
+    settings.vol_str = vol_str;
+    settings.iss_str = iss_str;
+    settings.date_array = { pdf::date_short(job.issue), pdf::date_month(job.issue) };
+    return true;
+}
+
+// Runs every issue of a job file in one process: the stores are opened once, the rows of every
+// issue are prefetched together, and issues of different publications or volumes run at the same
+// time while the issues of one volume run in the order of the job file
+// The title page options and sync policy of the defaults apply to every issue
+static int run_batch(const std::string& batch_path, const DatabaseOptions& database, const size_t connections,
+                     const size_t jobs, const size_t tool_jobs, const pipeline::IssueSettings& defaults, const bool use_cache)
+{
+    std::ifstream batch_file(batch_path, std::ios::binary);
+    if (!batch_file) {
+        logging::error() << "Error: Could not open job file " << batch_path;
+        return 1;
+    }
+    std::string batch_text((std::istreambuf_iterator<char>(batch_file)), std::istreambuf_iterator<char>());
 
-            std::cout << "\nWorking on: " << entry.path().filename().string() << std::endl;
-            std::string temp_filename = entry.path().filename().string();
+    std::vector<pipeline::IssueJob> issues;
+    try {
+        issues = pipeline::parse_jobs(batch_text);
+    } catch (const json::ParseError& e) {
+        logging::error() << "Error: Invalid job file " << batch_path << ": " << e.what();
+        return 1;
+    }
 
-            // Initialize and reset result_id
-            std::string result_id = "";
+    // Every issue is checked before the first one is touched
+    std::vector<std::vector<file::PaperEntry>> file_vecs(issues.size());
+    std::unordered_map<std::string, size_t> batch_filenames;
+    for (size_t i = 0; i < issues.size(); ++i) {
+        const pipeline::IssueJob& job = issues[i];
+        if (!check_issue(job) || !collect_papers(job.directory, file_vecs[i])) { return 1; }
+        // Groups run at the same time, so two jobs over the same files would rename and rewrite them concurrently
+        for (size_t j = 0; j < i; ++j) {
+            std::error_code ec;
+            if (fs::equivalent(job.directory, issues[j].directory, ec)) {
+                logging::error() << "Error: " << job.directory << " is listed more than once in " << batch_path;
+                return 1;
+            }
+        }
+        // Each issue keeps the journal a run of its directory alone would keep
+        std::string journal_path = default_journal_path(job.directory);
+        if (fs::exists(journal_path)) {
+            logging::error() << "Error: " << journal_path << " already exists, continue it with --resume " << journal_path
+                             << " and leave " << job.directory << " out of " << batch_path;
+            return 1;
+        }
+        for (const auto& paper : file_vecs[i]) {
+            auto listed = batch_filenames.emplace(paper.filename, i);
+            if (!listed.second) {
+                logging::error() << "Error: " << paper.filename << " is in both " << issues[listed.first->second].directory << " and " << job.directory;
+                return 1;
+            }
+        }
+        for (const auto& paper : file_vecs[i]) {
+            if (paper.filename.compare(0, paper.key.acronym_len, job.publication) != 0 || paper.key.acronym_len != job.publication.size()) {
+                logging::error() << "Error: " << paper.filename << " in " << job.directory << " is not a paper of " << job.publication;
+                return 1;
+            }
+        }
+    }
 
-            // Keeps us from updating later on if there are failures early on
-            bool db_path_updated = false;
-            bool local_path_updated = false;
-            bool rdf_updated = false;
+    std::vector<std::vector<size_t>> groups = pipeline::group_jobs(issues);
+    std::vector<std::unique_ptr<sql_agent::PaperStore>> stores;
+    for (size_t i = 0; i < std::max<size_t>(1, std::min(connections, groups.size())); ++i) {
+        std::unique_ptr<sql_agent::PaperStore> store = open_store(database);
+        if (!store) { return 1; }
+        stores.push_back(std::move(store));
+    }
+    sql_agent::PaperStorePool pool(std::move(stores));
 
-            // Reset page range tracker array
-            std::array<std::string, 2> page_range{ "","" };
-            // Reset extracted pub acronym
-            std::string pub = "";
+    /* Load the rows of every issue up front, the issues only read them */
+    sql_agent::PaperCatalog catalog;
+    try {
+        std::vector<std::string> filenames;
+        for (const auto& file_vec : file_vecs) {
+            for (const auto& paper : file_vec) { filenames.push_back(paper.filename); }
+        }
+        sql_agent::PaperStorePool::Lease lease = pool.acquire();
+        trace::Span span("prefetch");
+        catalog.prefetch(lease.get(), filenames);
+    } catch (const std::exception& e) {
+        logging::error() << "Query error: " << e.what();
+        logging::error() << "Could not prefetch the papers of " << batch_path;
+        return 1;
+    }
 
-            /* UPDATING SQL DATABASE FOR PUBLISHED PAPER */
-            try {
-                // Execute a SELECT query to retrieve ID field for the entry
-                result_id = sql_agent::retrieve_field(query, result, temp_filename, "ID");
-                std::cout << "Retrieved ID: " + result_id << std::endl;
-
-                if (result_id != "") {
-                    std::cout << "Starting SQL Database Updates for ID: " + result_id << std::endl;
-                    pub = rdf::get_acronym(result_id, '-');
-
-                    // Constructing new volume string
-                    std::string new_vol_str = year_str + vol_str + "000" + iss_str;
-                    std::cout << "New Volume Number (ID: " + result_id + "): " + new_vol_str << std::endl;
-                    // Execute query to UPDATE Volume_Number for the given ID
-                    sql_agent::update_field_by_ID(query, result_id, "Volume_Number", new_vol_str);
-
-                    // Execute query to UPDATE NumIssue for the given ID
-                    std::cout << "New Issue Number (ID: " + result_id + "): " + iss_str << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "NumIssue", iss_str);
-
-                    // Execute query to UPDATE TotalPaper for the given ID
-                    std::cout << "New Paper Number (ID: " + result_id + "): " + paper_num_str << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "TotalPaper", paper_num_str);
-
-                    // Constructing new citiation string
-                    std::string new_citationString = year_str + ", Volume " + vol_str + ", Issue " + iss_str;
-                    std::string page_count = sql_agent::retrieve_field(query, result, temp_filename, "NumberOfPages");
-                    page_range[1] = std::to_string(std::stoi(last_pub_page) + std::stoi(page_count));
-                    if (page_range[1] != "" && page_count != "") {
-                        int first_page_num = std::stoi(page_range[1]) - std::stoi(page_count) + 1;
-                        page_range[0] = std::to_string(first_page_num);
-                        // Execute query to UPDATE TotalNumpages for the given ID
-                        sql_agent::update_field_by_ID(query, result_id, "TotalNumpages", page_range[1]);
-                        new_citationString += ", pages " + page_range[0] + " - " + page_range[1];
-                    }
-                    // Execute query to UPDATE citationString for the given ID
-                    std::cout << "New Citation String (ID: " + result_id + "): " + new_citationString << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "citationString", new_citationString);
-
-                    // Updating the temp copy of the filename to update the DB
-                    file::rename_temp_filename(temp_filename, newVolumeNum, newIssueNum, newPaperNum);
-                    std::string new_Published_PDF_File = "/Pubs/" + pub + "/" + year_str + "/Volume" + vol_str + "/" + temp_filename;
-                    std::cout << "New Published PDF Filepath (ID: " + result_id + "): " + new_Published_PDF_File << std::endl;
-                    // Execute query to UPDATE Published_PDF_File for the given ID
-                    sql_agent::update_field_by_ID(query, result_id, "Published_PDF_File", new_Published_PDF_File);
-
-                    // Build calendar stamp for new publish date
-                    // Year_str is required for it to populate properly on the site
-                    // Site will order by publish date, not page #
-                    std::string new_Publish_Date = year_str + date_array[0]; // CHANGE THIS
-                    // Get current time for the timestamp and convert to std::string format
-                    std::time_t current_time = std::time(nullptr);
-                    char pub_buffer[20];
-                    std::strftime(pub_buffer, sizeof(pub_buffer), "%T", std::localtime(&current_time));
-                    std::string time_str = std::string(pub_buffer);
-                    new_Publish_Date += " " + time_str;
-                    // Execute query to UPDATE Publish_Date for the given ID
-                    std::cout << "New Published Date (ID: " + result_id + "): " + new_Publish_Date << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "Publish_Date", new_Publish_Date);
-
-                    // Build calendar stamp for new status date (today's date)
-                    std::time_t status_timestamp = std::time(nullptr);
-                    char status_buffer[25];
-                    std::strftime(status_buffer, sizeof(status_buffer), "%F %T", std::localtime(&status_timestamp));
-                    std::string status_str = std::string(status_buffer);
-                    // Execute query to UPDATE Status_Date for the given ID
-                    std::cout << "New Status Date (ID: " + result_id + "): " + status_str << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "Status_date", status_str);
-
-                    db_path_updated = true;
-                    std::cout << "Successfully Updated SQL Database for ID: " << result_id << std::endl;
-                } else {
-                    std::cerr << "Retrieved empty ID string, moving to next file." << std::endl;
-                }
-            } catch (const sql::SQLException& e) {
-                std::cerr << "Query error: " << e.what() << std::endl;
-                std::cerr << "Failed to update all SQL fields for ID: " + result_id << std::endl;
-                continue;
+    logging::info() << "\nRunning " << issues.size() << " issues in " << groups.size() << " volumes on " << pool.size() << " connections.";
+    IssueTools tools(tool_jobs, defaults.native_title_pages, use_cache);
+    std::atomic<size_t> issues_completed{ 0 };
+    parallel::for_each_index(pool.size(), groups.size(), [&](size_t g) {
+        // The issues of a volume share one store, so each one sees the papers the one before committed
+        sql_agent::PaperStorePool::Lease lease = pool.acquire();
+        for (size_t i : groups[g]) {
+            const pipeline::IssueJob& job = issues[i];
+            pipeline::IssueSettings settings = defaults;
+            int paper_num = 0;
+            std::string last_pub_page;
+            bool applied = false;
+            if (settings_for_issue(job, file_vecs[i], lease.get(), settings, paper_num, last_pub_page)) {
+                pipeline::IssuePlan plan{ job.directory, settings, pipeline::build_plan(settings, catalog, file_vecs[i], paper_num, last_pub_page) };
+                applied = apply_journaled_issue(plan, lease.get(), tools, jobs);
             }
-
-            /* UPDATING FILENAME FOR PUBLISHED PAPER */
+            if (!applied) {
+                // Later issues of the volume would continue from papers that were not published
+                logging::error() << "Error: Issue " << job.issue << " of " << job.publication << " volume " << job.volume
+                                 << " failed, the later issues of the volume were not run.";
+                return;
+            }
+            ++issues_completed;
+        }
+    });
+    logging::info() << "\nCompleted " << issues_completed << " of " << issues.size() << " issues.";
+    if (use_cache) {
+        logging::info() << tools.render_cache.get_hits() << " title pages reused from the render cache.";
+        tools.render_cache.save(defaults.sync);
+    }
+    return (issues_completed == issues.size()) ? 0 : 1;
+}
+
+// Compares every published row of tablepaper with the archive and the rdfs in one pass: the table
+// is streamed while the archive and the rdf directories are read on other threads, then the three
+// are joined in memory and the findings are written as JSON to the report path, or stdout without one
+// Returns 0 when everything agrees, 2 when there are findings and 1 when the audit could not run
+static int run_audit(const DatabaseOptions& database, const std::string& archive_root, const std::string& rdf_index_path,
+                     const std::string& report_path, const size_t jobs)
+{
+    if (!file::directory_exists(archive_root)) {
+        logging::error() << "Error: Archive directory does not exist: " << archive_root;
+        return 1;
+    }
+    std::unique_ptr<sql_agent::PaperStore> store = open_store(database);
+    if (!store) { return 1; }
+
+    std::vector<sql_agent::PaperRow> rows;
+    std::vector<file::ArchivePaper> files;
+    rdf::RdfIndex rdfs;
+    bool streamed = false;
+    parallel::for_each_index(3, 3, [&](size_t part) {
+        if (part == 0) {
+            trace::Span span("audit-table");
             try {
-                if (db_path_updated) {
-                    // Update filename
-                    file::rename_file(entry, newVolumeNum, newIssueNum, newPaperNum);
-                    local_path_updated = true;
-                } else {
-                    std::cout << "Skipped updating the filename locally." << std::endl;
-                }
+                store->for_each_paper([&](const sql_agent::PaperRow& row) {
+                    // Rows without a file are not published yet
+                    if (!row.published_pdf_file.empty()) { rows.push_back(row); }
+                });
+                streamed = true;
             } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update filename: " + entry.path().string() << std::endl;
-                continue;
+                logging::error() << "Query error: " << e.what();
             }
-
-            /* UPDATING RDF CONTENTS FOR PUBLISHED PAPER */
-            try {
-                if (local_path_updated) {
-                    // Updates RDF, uses the ID to find associated rdf 
-                    // then finds line containing the given criteria with the given string
-                    std::string new_url = "http://";
-                    new_url += "www.accessecon.com/Pubs/";
-                    new_url += pub + "/" + year_str + "/Volume" + vol_str + "/" + temp_filename;
-                    std::string new_creation_date = year_str + date_array[0];
-                    std::string new_title = sql_agent::retrieve_article_field(query, result, result_id, "Title");
-                    std::string new_abstract = sql_agent::retrieve_article_field(query, result, result_id, "Abstract");
-
-                    // Update rdf for each line that contains the following fields
-                    if (new_title != "") rdf::update_rdf_line(result_id, "Title:", new_title);
-                    if (new_abstract != "") rdf::update_rdf_line(result_id, "Abstract:", new_abstract);
-                    rdf::update_rdf_line(result_id, "Creation-Date:", new_creation_date);
-                    rdf::update_rdf_line(result_id, "File-URL:", new_url);
-                    rdf::update_rdf_line(result_id, "Pages:", page_range[0] + " - " + page_range[1]);
-                    rdf::update_rdf_line(result_id, "Year:", year_str);
-                    rdf::update_rdf_line(result_id, "Volume:", vol_str);
-                    rdf::update_rdf_line(result_id, "Issue:", iss_str);
-
-                    rdf_updated = true;
-                } else {
-                    std::cout << "Skipped updating the rdf contents." << std::endl;
-                }
+        } else if (part == 1) {
+            trace::Span span("audit-archive");
+            files = file::scan_archive(archive_root, jobs);
+        } else {
+            trace::Span span("audit-rdf");
+            if (!rdfs.load(rdf_index_path)) {
+                logging::info() << "Building a new rdf index: " << rdf_index_path;
             }
-            catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update all rdf contents for ID: " + result_id << std::endl;
-                continue;
+            rdfs.refresh(rdf::get_rdf_dirs(), jobs);
+            if (!rdfs.save(rdf_index_path)) {
+                logging::warning() << "The rdf index was not saved, the next run reads every rdf again.";
             }
+        }
+    });
+    if (!streamed) {
+        logging::error() << "Could not read tablepaper, the audit was not run.";
+        return 1;
+    }
+    logging::info() << "Read " << rows.size() << " published papers, " << files.size() << " archive files and " << rdfs.size() << " rdfs.";
 
-            /* UPDATING HTML AND PDF TITLE PAGES FOR PUBLISHED PAPER */
-            try {
-                if (local_path_updated && rdf_updated) {
-                    // Updates the stand-alone html title page (if it exists)
-                    pdf::update_html(result_id, newVolumeNum, newIssueNum, page_range, date_array);
-                    // Overwrites existing stand-alone pdf title page with updated html version
-                    pdf::update_pdf(result_id);
-                    // Removes the current title page from a published paper
-                    pdf::remove_title_page(entry, result_id, temp_filename, titleOffset);
-                    // Cats the title created during update_pdf() with the original published paper (minus old title) 
-                    pdf::update_title_page(entry, result_id, temp_filename);
-                } else {
-                    std::cout << "Skipped updating with new title page." << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update title page for ID: " + result_id << std::endl;
-                continue;
-            }
+    std::vector<audit::Finding> findings;
+    {
+        trace::Span span("audit-join");
+        findings = audit::compare(rows, files, rdfs);
+    }
+    std::string report = audit::serialize_findings(findings, rows.size(), files.size(), rdfs.size());
+    if (report_path == "") {
+        std::cout << report << std::endl;
+    } else {
+        try {
+            file::write_file_atomic(report_path, report, file::SyncPolicy::None, std::ios::binary);
+        } catch (const std::exception& e) {
+            logging::error() << "Error: " << e.what();
+            logging::error() << "Could not write the audit report to " << report_path;
+            return 1;
+        }
+        logging::info() << "Audit report written to " << report_path;
+    }
+    logging::info() << findings.size() << " findings.";
+    return findings.empty() ? 0 : 2;
+}
 
-            // Setting current iterated entry to be last published entry
-            if (local_path_updated && rdf_updated) {
-                last_paper_id = result_id;
-                last_pub_page = sql_agent::retrieve_field(query, result, temp_filename, "TotalNumpages");
-                newPaperNum += 1;
-                paper_num_str = std::to_string(newPaperNum);
-            }
+// Reports where the run spent its time when main returns, after every worker was joined
+struct TraceReport
+{
+    // A Chrome trace is only written when --trace is given
+    std::string chrome_trace_path;
+
+    ~TraceReport()
+    {
+        std::ostringstream summary;
+        trace::print_summary(summary);
+        std::string text = summary.str();
+        if (!text.empty()) { logging::info() << text.substr(0, text.size() - 1); }
+        if (chrome_trace_path != "" && trace::write_chrome_trace(chrome_trace_path)) {
+            logging::info() << "Trace written to " << chrome_trace_path;
         }
-    } else {
-        for (const auto& entry : file_vec) {
-            if (!fs::is_regular_file(entry) && !file::is_pdf(entry.path().filename().string())) continue;
-
-            std::cout << "\nWorking on: " << entry.path().filename().string() << std::endl;
-            std::string temp_filename = entry.path().filename().string();
-
-            // Initialize and reset result_id
-            std::string result_id = "";
-            // Keeps us from updating the local filename if the published pdf path is not updated in the mysql DB
-            bool db_path_updated = false;
-            bool local_path_updated = false;
-            bool rdf_updated = false;
-            // Reset page range tracker array
-            std::array<std::string, 2> page_range{"",""};
-            // Reset extracted pub acronym
-            std::string pub = "";
-
-            /* UPDATING SQL DATABASE FOR PUBLISHED PAPER */
-            try {
-                // Execute a SELECT query to retrieve ID field for the entry
-                result_id = sql_agent::retrieve_field(query, result, temp_filename, "ID");
-                std::cout << "Retrieved ID: " + result_id << std::endl;
-
-                if (result_id != "") {
-                    std::cout << "Starting SQL Database Updates for ID: " + result_id << std::endl;
-                    pub = rdf::get_acronym(result_id, '-');
-
-                    // Constructing new volume string
-                    std::string new_vol_str = year_str + vol_str + "000" + iss_str;
-                    std::cout << "New Volume Number (ID: " + result_id + "): " + new_vol_str << std::endl;
-                    // Execute query to UPDATE Volume_Number for the given ID
-                    sql_agent::update_field_by_ID(query, result_id, "Volume_Number", new_vol_str);
-
-                    // Execute query to UPDATE NumIssue for the given ID
-                    std::cout << "New Issue Number (ID: " + result_id + "): " + iss_str << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "NumIssue", iss_str);
-
-                    // Constructing new citiation string
-                    std::string new_citationString = year_str + ", Volume " + vol_str + ", Issue " + iss_str;
-                    page_range[1] = sql_agent::retrieve_field(query, result, temp_filename, "TotalNumpages");
-                    std::string page_count = sql_agent::retrieve_field(query, result, temp_filename, "NumberOfPages");
-                    if (page_range[1] != "" && page_count != "") {
-                        int first_page_num = std::stoi(page_range[1]) - std::stoi(page_count) + 1;
-                        page_range[0] = std::to_string(first_page_num);
-                        new_citationString += ", pages " + page_range[0] + " - " + page_range[1];
-                    }
-                    // Execute query to UPDATE citationString for the given ID
-                    std::cout << "New Citation String (ID: " + result_id + "): " + new_citationString << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "citationString", new_citationString);
-
-                    // Updating the temp copy of the filename to update the DB
-                    file::rename_temp_filename(temp_filename, newVolumeNum, newIssueNum);
-                    std::string new_Published_PDF_File = "/Pubs/" + pub + "/" + year_str + "/Volume" + vol_str + "/" + temp_filename;
-                    std::cout << "New Published PDF Filepath (ID: " + result_id + "): " + new_Published_PDF_File << std::endl;
-                    // Execute query to UPDATE Published_PDF_File for the given ID
-                    sql_agent::update_field_by_ID(query, result_id, "Published_PDF_File", new_Published_PDF_File);
-
-                    // Build calendar stamp for new publish date
-                    // Year_str is required for it to populate properly on the site
-                    // Site will order by publish date, not page #
-                    std::string new_Publish_Date = year_str + date_array[0]; // CHANGE THIS
-                    // Get current time for the timestamp and convert to std::string format
-                    std::time_t current_time = std::time(nullptr);
-                    char pub_buffer[20];
-                    std::strftime(pub_buffer, sizeof(pub_buffer), "%T", std::localtime(&current_time));
-                    std::string time_str = std::string(pub_buffer);
-                    new_Publish_Date += " " + time_str;
-                    // Execute query to UPDATE Publish_Date for the given ID
-                    std::cout << "New Published Date (ID: " + result_id + "): " + new_Publish_Date << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "Publish_Date", new_Publish_Date);
-
-                    // Build calendar stamp for new status date (today's date)
-                    std::time_t status_timestamp = std::time(nullptr);
-                    char status_buffer[25];
-                    std::strftime(status_buffer, sizeof(status_buffer), "%F %T", std::localtime(&status_timestamp));
-                    std::string status_str = std::string(status_buffer);
-                    // Execute query to UPDATE Status_Date for the given ID
-                    std::cout << "New Status Date (ID: " + result_id + "): " + status_str << std::endl;
-                    sql_agent::update_field_by_ID(query, result_id, "Status_date", status_str);
-
-                    db_path_updated = true;
-                    std::cout << "Successfully Updated SQL Database for ID: " << result_id << std::endl;
-                } else {
-                    std::cerr << "Retrieved empty ID string, moving to next file." << std::endl;
-                }
-            } catch (const sql::SQLException& e) {
-                std::cerr << "Query error: " << e.what() << std::endl;
-                std::cerr << "Failed to update all SQL fields for ID: " + result_id << std::endl;
-                continue;
-            }
+    }
+};
 
-            /* UPDATING FILENAME FOR PUBLISHED PAPER */
-            try {
-                if (db_path_updated) {
-                    // Update filename
-                    file::rename_file(entry, newVolumeNum, newIssueNum);
-                    local_path_updated = true;
-                } else {
-                    std::cout << "Skipped updating the filename locally." << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update filename: " + entry.path().string() << std::endl;
-                continue;
-            }
+int main(int argc, char* argv[]) 
+{
+    TraceReport trace_report;
 
-            /* UPDATING RDF CONTENTS FOR PUBLISHED PAPER */
-            try {
-                if (local_path_updated) {
-                    // Updates RDF, uses the ID to find associated rdf 
-                    // then finds line containing the given criteria with the given string
-                    std::string new_url = "http://";
-                    new_url += "www.accessecon.com/Pubs/";
-                    new_url += pub + "/" + year_str + "/Volume" + vol_str + "/" + temp_filename;
-                    std::string new_creation_date = year_str + date_array[0]; // CHANGE THIS
-                    std::string new_title = sql_agent::retrieve_article_field(query, result, result_id, "Title");
-                    std::string new_abstract = sql_agent::retrieve_article_field(query, result, result_id, "Abstract");
-
-                    // Update rdf for each line that contains the following fields
-                    if (new_title != "") rdf::update_rdf_line(result_id, "Title:", new_title);
-                    if (new_abstract != "") rdf::update_rdf_line(result_id, "Abstract:", new_abstract);
-                    rdf::update_rdf_line(result_id, "Creation-Date:", new_creation_date);
-                    rdf::update_rdf_line(result_id, "File-URL:", new_url);
-                    rdf::update_rdf_line(result_id, "Pages:", page_range[0] + " - " + page_range[1]);
-                    rdf::update_rdf_line(result_id, "Year:", year_str);
-                    rdf::update_rdf_line(result_id, "Volume:", vol_str);
-                    rdf::update_rdf_line(result_id, "Issue:", iss_str);
-
-                    rdf_updated = true;
-                } else {
-                    std::cout << "Skipped updating the rdf contents." << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update all rdf contents for ID: " + result_id << std::endl;
-                continue;
+    /* Testing and capturing .exe inputs */
+    // Positional arguments are collected in order, options may appear anywhere
+    std::vector<std::string> args;
+    // 0 until --jobs is given, each mode then picks its own default
+    size_t jobs = 0;
+    // 0 until --tool-jobs is given, then follows --jobs
+    size_t tool_jobs = 0;
+    std::string rdf_query_field = "";
+    std::string rdf_query_value = "";
+    std::string rdf_index_path = "rdf_index.qfi";
+    file::SyncPolicy sync = file::SyncPolicy::None;
+    bool native_title_pages = false;
+    bool regen_html = false;
+    std::string plan_out_path = "";
+    std::string apply_plan_path = "";
+    std::string journal_path = "";
+    bool resume = false;
+    std::string batch_path = "";
+    bool run_audit_mode = false;
+    std::string archive_root = ARCHIVE_ROOT;
+    std::string audit_out_path = "";
+    // 0 until --connections is given, a batch then opens one store per volume up to 4
+    size_t connections = 0;
+    bool use_cache = true;
+    DatabaseOptions database;
+    logging::Options log_options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc) {
+            int requested_jobs = std::stoi(argv[++i]);
+            if (requested_jobs < 1) {
+                logging::error() << "Error: invalid number of jobs. Must be at least 1.";
+                return 1;
             }
-
-            /* UPDATING HTML AND PDF TITLE PAGES FOR PUBLISHED PAPER */
-            try {
-                if (local_path_updated && rdf_updated) {
-                    // Updates the stand-alone html title page (if it exists)
-                    pdf::update_html(result_id, newVolumeNum, newIssueNum, page_range, date_array);
-                    // Overwrites existing stand-alone pdf title page with updated html version
-                    pdf::update_pdf(result_id);
-                    // Removes the current title page from a published paper
-                    pdf::remove_title_page(entry, result_id, temp_filename, titleOffset);
-                    // Cats the title created during update_pdf() with the original published paper (minus old title) 
-                    pdf::update_title_page(entry, result_id, temp_filename);
-                } else {
-                    std::cout << "Skipped updating with new title page." << std::endl;
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                std::cerr << "Failed to update title page for ID: " + result_id << std::endl;
-                continue;
+            jobs = static_cast<size_t>(requested_jobs);
+        } else if (arg == "--tool-jobs" && i + 1 < argc) {
+            int requested_tool_jobs = std::stoi(argv[++i]);
+            if (requested_tool_jobs < 1) {
+                logging::error() << "Error: invalid number of tool jobs. Must be at least 1.";
+                return 1;
+            }
+            tool_jobs = static_cast<size_t>(requested_tool_jobs);
+        } else if (arg == "--connections" && i + 1 < argc) {
+            int requested_connections = std::stoi(argv[++i]);
+            if (requested_connections < 1) {
+                logging::error() << "Error: invalid number of connections. Must be at least 1.";
+                return 1;
             }
+            connections = static_cast<size_t>(requested_connections);
+        } else if (arg == "--audit") {
+            run_audit_mode = true;
+        } else if (arg == "--archive" && i + 1 < argc) {
+            archive_root = argv[++i];
+        } else if (arg == "--audit-out" && i + 1 < argc) {
+            audit_out_path = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (arg == "--rdf-query" && i + 2 < argc) {
+            rdf_query_field = argv[++i];
+            rdf_query_value = argv[++i];
+        } else if (arg == "--rdf-index" && i + 1 < argc) {
+            rdf_index_path = argv[++i];
+        } else if (arg == "--title-renderer" && i + 1 < argc) {
+            std::string renderer = argv[++i];
+            if (renderer != "native" && renderer != "wkhtmltopdf") {
+                logging::error() << "Error: unknown title renderer '" << renderer << "'. Must be native or wkhtmltopdf.";
+                return 1;
+            }
+            native_title_pages = (renderer == "native");
+        } else if (arg == "--plan" && i + 1 < argc) {
+            plan_out_path = argv[++i];
+        } else if (arg == "--apply" && i + 1 < argc) {
+            apply_plan_path = argv[++i];
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (arg == "--resume" && i + 1 < argc) {
+            journal_path = argv[++i];
+            resume = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_report.chrome_trace_path = argv[++i];
+        } else if (arg == "--fixture" && i + 1 < argc) {
+            database.fixture_path = argv[++i];
+        } else if (arg == "--mysqlx") {
+            database.x_protocol = true;
+        } else if (arg == "--no-cache") {
+            use_cache = false;
+        } else if (arg == "--regen-html") {
+            regen_html = true;
+        } else if (arg == "--log" && i + 1 < argc) {
+            log_options.file_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            std::string level = argv[++i];
+            if (!logging::parse_level(level, log_options.min_level)) {
+                logging::error() << "Error: unknown log level '" << level << "'. Must be debug, info, warning or error.";
+                return 1;
+            }
+        } else if (arg == "--fsync") {
+            sync = file::SyncPolicy::Flush;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    // Records are written by a background thread from here on, the trace summary follows after it stopped
+    // The rdf query lists its matches and the audit writes its report on stdout, so they can be piped
+    log_options.console_stderr_only = (rdf_query_field != "" || (run_audit_mode && audit_out_path == ""));
+    logging::Session log_session(log_options);
+
+    /* Query the rdfs of every series through the persistent index, no database needed */
+    if (rdf_query_field != "") {
+        rdf::RdfIndex index;
+        if (!index.load(rdf_index_path)) {
+            logging::info() << "Building a new rdf index: " << rdf_index_path;
+        }
+        size_t reread = index.refresh(rdf::get_rdf_dirs(), (jobs == 0) ? parallel::default_jobs() : jobs);
+        logging::info() << "Indexed " << index.size() << " rdfs, " << reread << " of them read again.";
+        if (!index.save(rdf_index_path)) {
+            logging::warning() << "The rdf index was not saved, the next run reads every rdf again.";
+        }
+
+        std::vector<const rdf::RdfRecord*> matches = index.find_by_field(rdf_query_field, rdf_query_value);
+        for (const auto* record : matches) {
+            std::cout << record->id << "\t" << record->path << "\n";
+        }
+        logging::info() << matches.size() << " rdfs with " << rdf_query_field << " " << rdf_query_value;
+        return 0;
+    }
+
+    /* Apply a saved plan, its papers are processed in parallel unless --jobs says otherwise */
+    /* A resumed run continues the plan its journal was started with */
+    // The schema, username and password are only given when the database server is used
+    const size_t database_args = (database.fixture_path == "") ? 3 : 0;
+    if (resume && apply_plan_path == "" && args.size() == database_args) {
+        apply_plan_path = pipeline::StepJournal::read_plan_path(journal_path);
+        if (apply_plan_path == "") {
+            logging::error() << "Error: " << journal_path << " is not a journal of a previous run.";
+            return 1;
+        }
+    }
+    if (apply_plan_path != "" && args.size() == database_args) {
+        if (jobs == 0) { jobs = parallel::default_jobs(); }
+        if (tool_jobs == 0) { tool_jobs = jobs; }
+        if (database_args != 0) { database = DatabaseOptions{ "", args[0], args[1], args[2], database.x_protocol }; }
+        return apply_plan(apply_plan_path, database, jobs, tool_jobs, sync, journal_path, use_cache);
+    }
+
+    /* Compare the whole table with the archive and the rdfs, nothing is changed */
+    if (run_audit_mode && args.size() == database_args && apply_plan_path == "" && batch_path == "" && !resume) {
+        if (jobs == 0) { jobs = parallel::default_jobs(); }
+        if (database_args != 0) { database = DatabaseOptions{ "", args[0], args[1], args[2], database.x_protocol }; }
+        return run_audit(database, archive_root, rdf_index_path, audit_out_path, jobs);
+    }
+
+    /* Run every issue of a job file on warm connections, issues of different volumes at the same time */
+    if (batch_path != "" && args.size() == database_args && apply_plan_path == "" && journal_path == "" && plan_out_path == "") {
+        if (connections == 0) { connections = 4; }
+        // The cores are split between the issues that run at the same time
+        if (jobs == 0) { jobs = std::max<size_t>(1, parallel::default_jobs() / connections); }
+        if (tool_jobs == 0) { tool_jobs = jobs * connections; }
+        if (database_args != 0) { database = DatabaseOptions{ "", args[0], args[1], args[2], database.x_protocol }; }
+        pipeline::IssueSettings defaults{};
+        defaults.sync = sync;
+        defaults.regen_html = regen_html;
+        defaults.native_title_pages = native_title_pages;
+        return run_batch(batch_path, database, connections, jobs, tool_jobs, defaults, use_cache);
+    }
+
+    if (args.size() != 5 + database_args || apply_plan_path != "" || resume || batch_path != "" || run_audit_mode) {
+        std::cerr << "Usage: " << argv[0] << " <directory_path> <new_volume_number> <new_issue_number> <last_article_number> <titlepage-offset> (<db_schema_name> <username> <password> [--mysqlx] | --fixture <fixture_path>) [--plan <plan_path> | --journal <journal_path>] [--jobs N] [--tool-jobs N] [--title-renderer native|wkhtmltopdf] [--regen-html] [--no-cache] [--trace <trace_path>] [--log <log_path>] [--log-level debug|info|warning|error] [--fsync]" << std::endl;
+        std::cerr << "       " << argv[0] << " --apply <plan_path> (<db_schema_name> <username> <password> [--mysqlx] | --fixture <fixture_path>) [--journal <journal_path>] [--jobs N] [--tool-jobs N] [--no-cache] [--trace <trace_path>] [--log <log_path>] [--log-level debug|info|warning|error] [--fsync]" << std::endl;
+        std::cerr << "       " << argv[0] << " --resume <journal_path> (<db_schema_name> <username> <password> [--mysqlx] | --fixture <fixture_path>) [--jobs N] [--tool-jobs N] [--no-cache] [--trace <trace_path>] [--log <log_path>] [--log-level debug|info|warning|error] [--fsync]" << std::endl;
+        std::cerr << "       " << argv[0] << " --batch <job_file> (<db_schema_name> <username> <password> [--mysqlx] | --fixture <fixture_path>) [--connections N] [--jobs N] [--tool-jobs N] [--title-renderer native|wkhtmltopdf] [--regen-html] [--no-cache] [--trace <trace_path>] [--log <log_path>] [--log-level debug|info|warning|error] [--fsync]" << std::endl;
+        std::cerr << "       " << argv[0] << " --audit (<db_schema_name> <username> <password> [--mysqlx] | --fixture <fixture_path>) [--archive <archive_root>] [--rdf-index <index_path>] [--audit-out <report_path>] [--jobs N] [--trace <trace_path>] [--log <log_path>] [--log-level debug|info|warning|error]" << std::endl;
+        std::cerr << "       " << argv[0] << " --rdf-query <Field:> <value> [--rdf-index <index_path>] [--jobs N] [--log <log_path>] [--log-level debug|info|warning|error]" << std::endl;
+        std::cerr << "--fixture only stands in for the database, the pdfs, rdfs and title pages are still renamed and rewritten, so run it on a copy of the archive." << std::endl;
+        return 1;
+    }
+    // Papers are updated one after another unless --jobs is given
+    if (jobs == 0) { jobs = 1; }
+    // Every worker may run its own converter or ghostscript unless --tool-jobs is given
+    if (tool_jobs == 0) { tool_jobs = jobs; }
+    pipeline::IssueJob job{ args[0], std::stoi(args[1]), std::stoi(args[2]), std::stoi(args[3]), std::stoi(args[4]), "" };
+    if (!check_issue(job)) { return 1; }
+    std::string directoryPath = job.directory;
+    if (database_args != 0) { database = DatabaseOptions{ "", args[5], args[6], args[7], database.x_protocol }; }
+
+    /* Build MySQL Interface and try to connect to the DB Server, or load the fixture instead */
+    std::unique_ptr<sql_agent::PaperStore> store = open_store(database);
+    if (!store) { return 1; }
+
+    std::vector<file::PaperEntry> file_vec;
+    if (!collect_papers(directoryPath, file_vec)) { return 1; }
+
+    /* Load every row the loop needs for the directory up front instead of querying per paper */
+    sql_agent::PaperCatalog catalog;
+    try {
+        std::vector<std::string> filenames;
+        filenames.reserve(file_vec.size());
+        for (const auto& paper : file_vec) { filenames.push_back(paper.filename); }
+        trace::Span span("prefetch");
+        catalog.prefetch(*store, filenames);
+    } catch (const std::exception& e) {
+        logging::error() << "Query error: " << e.what();
+        logging::error() << "Could not prefetch the papers in " << directoryPath;
+        return 1;
+    }
+
+    pipeline::IssueSettings settings{};
+    settings.sync = sync;
+    settings.regen_html = regen_html;
+    settings.native_title_pages = native_title_pages;
+    // The number of the next paper and, when renumbering, the last page of the paper before it
+    int newPaperNum = 0;
+    std::string last_pub_page = "";
+    if (!settings_for_issue(job, file_vec, *store, settings, newPaperNum, last_pub_page)) { return 1; }
+    /* OPERATION OVERVIEW
+    * 1) Verify the file entries are acceptable to use
+    * 2) Plan every entry: retrieve its ID from the prefetched rows,
+         then compute its page range, paper number and new filename
+    * 3) Save the plan next to the journal of the run
+    * 4) Send the UPDATE of Volume_Number, NumIssue, citationString,
+         Published_PDF_File, etc. for every paper in batches
+    * 5) On --jobs threads, for every paper: pipeline::rename_paper,
+         then pipeline::update_rdf, then pipeline::update_title_pages
+    * 6) Commit the updates of the issue
+    */
+
+    // Every run is applied through a plan saved next to its journal, so that a run that stops
+    // half way continues with the same filenames and values even though some files were renamed
+    bool apply_journaled = (plan_out_path == "");
+    if (apply_journaled) {
+        if (journal_path == "") { journal_path = default_journal_path(directoryPath); }
+        if (fs::exists(journal_path)) {
+            logging::error() << "Error: " << journal_path << " already exists, continue it with --resume " << journal_path;
+            return 1;
         }
+        plan_out_path = journal_path + ".plan.json";
     }
 
-    delete query;
-    delete result;
+    pipeline::IssuePlan plan{ directoryPath, settings, pipeline::build_plan(settings, catalog, file_vec, newPaperNum, last_pub_page) };
+    try {
+        file::write_file_atomic(plan_out_path, pipeline::serialize_plan(plan), sync, std::ios::binary);
+    } catch (const std::exception& e) {
+        logging::error() << "Error: " << e.what();
+        logging::error() << "Could not write the plan to " << plan_out_path;
+        return 1;
+    }
+    logging::info() << "\nPlanned " << plan.papers.size() << " papers, written to " << plan_out_path;
+    if (apply_journaled) {
+        store.reset();
+        return apply_plan(plan_out_path, database, jobs, tool_jobs, sync, journal_path, use_cache);
+    }
 
+    /* Only write down what would change, the database and the files are left as they are */
+    std::string database_usage = (database.fixture_path == "") ? " <db_schema_name> <username> <password>" : " --fixture " + database.fixture_path;
+    if (database.x_protocol) { database_usage += " --mysqlx"; }
+    logging::info() << "Apply it with --apply " << plan_out_path << database_usage;
     return 0;
-}
\ No newline at end of file
+}
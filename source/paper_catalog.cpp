@@ -0,0 +1,44 @@
+#include "paper_catalog.h"
+#include "logging.h"
+
+namespace sql_agent
+{
+	// Returns the last path component of a Published_PDF_File value
+	std::string basename_of(const std::string& path)
+	{
+		size_t slash = path.find_last_of('/');
+		return (slash == std::string::npos) ? path : path.substr(slash + 1);
+	}
+
+	// Loads the rows whose Published_PDF_File ends with any of the given filenames
+	// along with the title and abstract of each of those papers
+	void PaperCatalog::prefetch(PaperStore& store, const std::vector<std::string>& filenames)
+	{
+		for (auto& row : store.find_by_filenames(filenames)) {
+			// Keep the first row for a filename, as the LIMIT 1 lookups did
+			std::string filename = basename_of(row.published_pdf_file);
+			if (m_by_filename.count(filename) != 0 || m_by_id.count(row.id) != 0) { continue; }
+
+			m_by_filename.emplace(filename, m_rows.size());
+			m_by_id.emplace(row.id, m_rows.size());
+			m_rows.push_back(std::move(row));
+		}
+		store.fill_articles(m_rows);
+
+		logging::info() << "Prefetched " << m_rows.size() << " of " << filenames.size() << " papers from the database.";
+	}
+
+	const PaperRow* PaperCatalog::find_by_filename(const std::string& filename) const
+	{
+		auto found = m_by_filename.find(filename);
+		return (found == m_by_filename.end()) ? nullptr : &m_rows[found->second];
+	}
+
+	const PaperRow* PaperCatalog::find_by_id(const std::string& id) const
+	{
+		auto found = m_by_id.find(id);
+		return (found == m_by_id.end()) ? nullptr : &m_rows[found->second];
+	}
+
+	size_t PaperCatalog::size() const { return m_rows.size(); }
+}
@@ -0,0 +1,164 @@
+#include "paper_store.h"
+#include "logging.h"
+
+namespace sql_agent
+{
+	PaperUpdate::PaperUpdate(const std::string id) : m_id(id) {}
+
+	// Queues a new value for a column, replacing any value already queued for it
+	PaperUpdate& PaperUpdate::set(const std::string field, const std::string input_str)
+	{
+		// Column names are spliced into the query text, only values are bound
+		if (field.empty() || !std::all_of(field.begin(), field.end(), [](unsigned char c) { return std::isalnum(c) || c == '_'; })) {
+			throw std::invalid_argument("Invalid column name \"" + field + "\" for " + m_id);
+		}
+
+		for (auto& queued : m_fields) {
+			if (queued.first == field) {
+				queued.second = input_str;
+				return *this;
+			}
+		}
+		m_fields.emplace_back(field, input_str);
+		return *this;
+	}
+
+	bool PaperUpdate::empty() const { return m_fields.empty(); }
+
+	const std::string& PaperUpdate::get_id() const { return m_id; }
+
+	const std::vector<std::pair<std::string, std::string>>& PaperUpdate::get_fields() const { return m_fields; }
+
+	// Builds "(?, ?, ..., ?)" for the given number of placeholders
+	std::string placeholder_list(const size_t count)
+	{
+		std::string list = "(";
+		for (size_t i = 0; i < count; ++i) {
+			list += (i == 0) ? "?" : ", ?";
+		}
+		list += ")";
+		return list;
+	}
+
+	// Builds: UPDATE tablepaper SET a = ?, b = ?, ... WHERE id = ?
+	BoundStatement build_update(const PaperUpdate& update)
+	{
+		const auto& fields = update.get_fields();
+		BoundStatement statement{ "UPDATE tablepaper SET ", {} };
+		statement.params.reserve(fields.size() + 1);
+		for (size_t i = 0; i < fields.size(); ++i) {
+			if (i != 0) { statement.query += ", "; }
+			statement.query += fields[i].first + " = ?";
+			statement.params.push_back(fields[i].second);
+		}
+		statement.query += " WHERE id = ?;";
+		statement.params.push_back(update.get_id());
+		return statement;
+	}
+
+	// Builds the updates of many papers as few statements, papers with the same column list share
+	// UPDATE tablepaper SET a = CASE id WHEN ? THEN ? ... END, ... WHERE id IN (?, ...)
+	std::vector<BoundStatement> build_batch_updates(const std::vector<PaperUpdate>& updates, const size_t batch_size)
+	{
+		// Papers of an issue normally all share one column list, so this is a single group
+		std::vector<std::vector<const PaperUpdate*>> groups;
+		for (const auto& update : updates) {
+			if (update.empty()) { continue; }
+			auto same_columns = [&](const std::vector<const PaperUpdate*>& group) {
+				const auto& a = group.front()->get_fields();
+				const auto& b = update.get_fields();
+				return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+					[](const auto& x, const auto& y) { return x.first == y.first; });
+			};
+			auto group = std::find_if(groups.begin(), groups.end(), same_columns);
+			if (group == groups.end()) { groups.push_back({ &update }); }
+			else { group->push_back(&update); }
+		}
+
+		const size_t step = std::max<size_t>(batch_size, 1);
+		std::vector<BoundStatement> statements;
+		for (const auto& group : groups) {
+			const auto& columns = group.front()->get_fields();
+			for (size_t begin = 0; begin < group.size(); begin += step) {
+				size_t end = std::min(group.size(), begin + step);
+
+				BoundStatement& statement = statements.emplace_back();
+				statement.query = "UPDATE tablepaper SET ";
+				for (size_t column = 0; column < columns.size(); ++column) {
+					if (column != 0) { statement.query += ", "; }
+					statement.query += columns[column].first + " = CASE id";
+					for (size_t i = begin; i < end; ++i) {
+						statement.query += " WHEN ? THEN ?";
+						statement.params.push_back(group[i]->get_id());
+						statement.params.push_back(group[i]->get_fields()[column].second);
+					}
+					statement.query += " END";
+				}
+				statement.query += " WHERE id IN " + placeholder_list(end - begin) + ";";
+				for (size_t i = begin; i < end; ++i) {
+					statement.params.push_back(group[i]->get_id());
+				}
+			}
+		}
+		return statements;
+	}
+
+	Transaction::Transaction(PaperStore& store) : m_store(store), m_active(true)
+	{
+		m_store.begin();
+	}
+
+	void Transaction::commit()
+	{
+		if (!m_active) { return; }
+		m_store.commit();
+		m_active = false;
+	}
+
+	void Transaction::rollback()
+	{
+		if (!m_active) { return; }
+		m_active = false;
+		m_store.rollback();
+	}
+
+	Transaction::~Transaction()
+	{
+		// Never let an exception escape the destructor, the connection may already be gone
+		try {
+			rollback();
+		} catch (const std::exception& e) {
+			logging::error() << "Rollback error: " << e.what();
+		}
+	}
+
+	PaperStorePool::PaperStorePool(std::vector<std::unique_ptr<PaperStore>> stores) : m_stores(std::move(stores))
+	{
+		for (const auto& store : m_stores) { m_free.push_back(store.get()); }
+	}
+
+	// Waits until a store is free
+	PaperStorePool::Lease PaperStorePool::acquire()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_released.wait(lock, [this]() { return !m_free.empty(); });
+		PaperStore* store = m_free.back();
+		m_free.pop_back();
+		return Lease(*this, *store);
+	}
+
+	size_t PaperStorePool::size() const { return m_stores.size(); }
+
+	PaperStorePool::Lease::Lease(PaperStorePool& pool, PaperStore& store) : m_pool(pool), m_store(store) {}
+
+	PaperStorePool::Lease::~Lease()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_pool.m_mutex);
+			m_pool.m_free.push_back(&m_store);
+		}
+		m_pool.m_released.notify_one();
+	}
+
+	PaperStore& PaperStorePool::Lease::get() { return m_store; }
+}
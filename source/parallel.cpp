@@ -0,0 +1,38 @@
+#include "parallel.h"
+#include "logging.h"
+
+namespace parallel
+{
+	// Number of threads to use when the caller did not ask for a specific count
+	size_t default_jobs() { return std::max<size_t>(1, std::thread::hardware_concurrency()); }
+
+	// Calls the task for every index in [0, count) on at most the given number of threads
+	// The calling thread takes part, exceptions thrown by a task are reported and do not stop the others
+	void for_each_index(const size_t jobs, const size_t count, const std::function<void(size_t)>& task)
+	{
+		std::atomic<size_t> next_index{ 0 };
+		auto worker = [&]() {
+			for (size_t i = next_index++; i < count; i = next_index++) {
+				try {
+					task(i);
+				} catch (const std::exception& e) {
+					logging::error() << "Error: " << e.what();
+				} catch (...) {
+					logging::error() << "Unknown error occurred while running a parallel task.";
+				}
+			}
+		};
+
+		size_t thread_count = std::max<size_t>(1, std::min(jobs, count));
+		std::vector<std::thread> workers;
+		workers.reserve(thread_count - 1);
+		for (size_t t = 1; t < thread_count; ++t) {
+			workers.emplace_back(worker);
+		}
+		// The calling thread takes part instead of sitting idle
+		worker();
+		for (auto& thread : workers) {
+			thread.join();
+		}
+	}
+}
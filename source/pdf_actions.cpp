@@ -1,8 +1,24 @@
 #include "pdf_actions.h"
+#include "logging.h"
 #include "rdf_actions.h"
+#include "title_rewriter.h"
+#include "pdf_splice.h"
+#include "trace.h"
 
 namespace pdf
 {
+	// Tools already used by the server, a page that takes longer than this is stuck
+	static const std::string HTML_PDF_CONVERTER = "C:/inetpub/vhosts/accessecon.com/httpdocs/wkhtmltopdf/bin/wkhtmltopdf.exe";
+	static const std::string GHOST_SCRIPT_BIN = "C:/inetpub/vhosts/accessecon.com/httpdocs/ghostscript/bin/gswin32c.exe";
+	static const std::chrono::milliseconds TOOL_TIMEOUT = std::chrono::minutes(5);
+
+	// Runs an external tool and records how long the paper waited for it under the tool's name
+	static process::Result run_tool(process::ProcessRunner& runner, const char* tool, const std::string& id, const process::Job& job)
+	{
+		trace::Span span(tool, id);
+		return runner.run(job);
+	}
+
 	// Determines what the datestamp of format: -MM-DD for publication date
 	std::string date_short(const int new_iss)
 	{
@@ -80,7 +96,7 @@ namespace pdf
 		}
 
 		if (dir == "") {
-			std::cerr << "Could not find existing html directory. Returning empty string." << std::endl;
+			logging::error() << "Could not find existing html directory. Returning empty string.";
 		} else {
 			//std::cout << "Returning html dir (ID:" + id + "): " + dir << std::endl;
 		}
@@ -106,9 +122,9 @@ namespace pdf
 	// Updates the top level volume and issue number for the title page
 	std::string update_title(const std::string& html_content, const int new_vol, const int new_iss)
 	{
-		// Define regular expressions for finding volume and issue numbers
-		std::regex volume_pattern(R"(Volume\s+\d+)"); // Volume #
-		std::regex issue_pattern(R"(Issue\s+\d+)"); // Issue #
+		// Define regular expressions for finding volume and issue numbers, compiled once
+		static const std::regex volume_pattern(R"(Volume\s+\d+)"); // Volume #
+		static const std::regex issue_pattern(R"(Issue\s+\d+)"); // Issue #
 
 		// Create replacements for volume and issue numbers
 		std::string title_vol = "Volume " + std::to_string(new_vol);
@@ -129,22 +145,23 @@ namespace pdf
 		const std::array<std::string,2>& page_range,
 		std::array<std::string, 2>& date_array)
 	{
+		// Patterns are compiled once, pdf::TitleRewriter relies on them for pages it cannot rewrite itself
 		// Volume patterns
-		std::regex volume_pattern(R"(Vol.\s+\d+)"); //
+		static const std::regex volume_pattern(R"(Vol.\s+\d+)"); //
 		// Issue patterns
-		std::regex issue_pattern_1(R"(No.\s+\d+)"); // No. #
-		std::regex issue_pattern_2(R"(Iss.\s\d+)"); // Iss. #
+		static const std::regex issue_pattern_1(R"(No.\s+\d+)"); // No. #
+		static const std::regex issue_pattern_2(R"(Iss.\s\d+)"); // Iss. #
 		// Page number patterns
-		std::regex page_pattern_1(R"(pages\s+\d+-\d+)"); // pages #-#
-		std::regex page_pattern_2(R"(pp\.\s+\d+-\d+)"); // pp. #-#
-		std::regex page_pattern_3(R"(p\.\s+\d+-\d+)"); // p. #-#
-		std::regex page_pattern_4(R"(pages\s+A\d+)"); // pages A#
-		std::regex page_pattern_5(R"(p.\s+A\d+)"); // p. A#
-		std::regex page_pattern_6(R"(p.A\d+)"); // p.A#
+		static const std::regex page_pattern_1(R"(pages\s+\d+-\d+)"); // pages #-#
+		static const std::regex page_pattern_2(R"(pp\.\s+\d+-\d+)"); // pp. #-#
+		static const std::regex page_pattern_3(R"(p\.\s+\d+-\d+)"); // p. #-#
+		static const std::regex page_pattern_4(R"(pages\s+A\d+)"); // pages A#
+		static const std::regex page_pattern_5(R"(p.\s+A\d+)"); // p. A#
+		static const std::regex page_pattern_6(R"(p.A\d+)"); // p.A#
 		// Publication year
-		std::regex year_pattern(", \\(\\d{4}\\) ''"); // , (year)
+		static const std::regex year_pattern(", \\(\\d{4}\\) ''"); // , (year)
 		// Publication String
-		std::regex date_pattern("<b>Published:</b> (\\w+ \\d{1,2}, \\d{4})");
+		static const std::regex date_pattern("<b>Published:</b> (\\w+ \\d{1,2}, \\d{4})");
 
 		// Create replacements for regex patterns
 		std::string cit_vol = "Volume " + std::to_string(new_vol);
@@ -175,78 +192,114 @@ namespace pdf
 
 	// Updates the stand-alone title page in the html format
 	// This does NOT update the publication paper itself
-	void update_html(
+	// Returns false if the page could not be read or replaced
+	bool update_html(
 		const std::string& id, 
 		const int new_vol, 
 		const int new_iss, 
 		const std::array<std::string,2>& page_range,
-		std::array<std::string, 2>& date_array)
+		std::array<std::string, 2>& date_array,
+		const file::SyncPolicy sync)
 	{
 		std::string html_path = pdf::get_path(id, pdf::FileType::HTML);
 
 		// Read HTML content from file into an istream buffer container
 		std::ifstream html_file(html_path);
 		if (!html_file.is_open()) {
-			std::cerr << "Error (ID: " + id + "): " + "Unable to open file: " + html_path << std::endl;
-			return;
+			logging::error() << "Error (ID: " << id << "): " << "Unable to open file: " << html_path;
+			return false;
 		}
 		std::string html_content((std::istreambuf_iterator<char>(html_file)), std::istreambuf_iterator<char>());
 		html_file.close();
 
-		std::string updated_html = pdf::update_title(html_content, new_vol, new_iss);
-		updated_html = pdf::update_citation(updated_html, new_vol, new_iss, page_range, date_array);
-
-		// Write updated HTML content to a temporary file
-		std::ofstream temp_file("temp.html");
-		if (!temp_file.is_open()) {
-			std::cerr << "Error (ID: " + id + "): " + "Unable to open file: " + html_path << std::endl;
-			return;
+		// Same result as update_title() followed by update_citation(), in a single scan
+		pdf::TitleRewriter rewriter(new_vol, new_iss, page_range, date_array);
+		std::string updated_html = rewriter.rewrite(html_content);
+
+		// Replace the title page with a sibling temp file in a single rename, 
+		// the title page keeps its permissions and ownership
+		try {
+			file::write_file_atomic(html_path, updated_html, sync);
+		} catch (const std::exception& e) {
+			logging::error() << "Error (ID: " << id << "): " << e.what();
+			return false;
 		}
+		return true;
+	}
 
-		temp_file << updated_html;
-		temp_file.close();
-
-		// This will result in a loss of permissions for some users. May need to reenable inheritances in file explorer:
-		// right click -> properties -> security -> advanced -> enable inheritance -> apply
-		std::remove(html_path.c_str());
-		// Rename the temporary file to the original file name
-		std::rename("temp.html", html_path.c_str());
+	// Regenerates the stand-alone title page in the html format from the publication's template, in place of update_html()
+	bool regenerate_html(const pdf::HtmlTemplate& html_template, const pdf::TitlePageFields& fields, const file::SyncPolicy sync)
+	{
+		std::string html_path = pdf::get_path(fields.id, pdf::FileType::HTML);
+		try {
+			file::write_file_atomic(html_path, html_template.render(fields), sync);
+		} catch (const std::exception& e) {
+			logging::error() << "Error (ID: " << fields.id << "): " << e.what();
+			return false;
+		}
+		return true;
 	}
 
 	// Updates the stand-alone title page in the pdf format by converting the updated html title
 	// This does NOT update the publication paper itself
-	void update_pdf(const std::string& id)
+	bool update_pdf(const std::string& id, process::ProcessRunner& runner, pdf::RenderCache* cache)
 	{
 		std::string html_path = pdf::get_path(id, pdf::FileType::HTML);
 		std::string pdf_path = pdf::get_path(id, pdf::FileType::PDF);
 
-		std::remove(pdf_path.c_str());
+		// The same html converted by the same converter gives the same title page
+		uint64_t html_hash = 0;
+		uint64_t input = 0;
+		bool hashed = (cache != nullptr && file::hash_file(html_path, html_hash));
+		if (hashed) {
+			input = file::Xxh64().update(HTML_PDF_CONVERTER).update(html_hash).digest();
+			if (cache->is_fresh(id, "title-pdf", input, pdf_path)) {
+				logging::info() << "HTML title page unchanged, keeping the converted PDF.";
+				return true;
+			}
+		}
 
-		// Using a 3rd party open source html->pdf converter called wkhtmltopdf on the cmd line
-		std::string html_pdf_converter = "C:/inetpub/vhosts/accessecon.com/httpdocs/wkhtmltopdf/bin/wkhtmltopdf.exe";
-		std::string cmd = html_pdf_converter;
-		cmd += " " + html_path + " " + pdf_path;
+		std::remove(pdf_path.c_str());
 
-		int result = system(cmd.c_str());
+		// Using a 3rd party open source html->pdf converter called wkhtmltopdf, started without a shell
+		process::Result result = run_tool(runner, "wkhtmltopdf", id, { HTML_PDF_CONVERTER, { html_path, pdf_path }, TOOL_TIMEOUT });
 		// For debugging purposes
-		//std::cout << cmd << std::endl; int result = 0;
+		//std::cout << HTML_PDF_CONVERTER + " " + html_path + " " + pdf_path << std::endl;
 		
-		// system() will return 0 if successful, -1 if failed
-		if (result == 0) {
-			std::cout << "HTML file converted to PDF successfully." << std::endl;
+		if (result.ok()) {
+			logging::info() << "HTML file converted to PDF successfully.";
 		} else {
-			std::cerr << "Error (ID: " + id + "): " + "Failed to convert HTML file to PDF." << std::endl;
-			return;
+			logging::error() << "Error (ID: " << id << "): " << "Failed to convert HTML file to PDF, wkhtmltopdf " << process::describe(result);
+			return false;
+		}
+		if (hashed) { cache->store(id, "title-pdf", input, pdf_path); }
+		return true;
+	}
+
+	// Writes the stand-alone title page in the pdf format straight from the paper's fields, in place of update_pdf()
+	bool write_title_pdf(const pdf::TitlePageRenderer& renderer, const pdf::TitlePageFields& fields, const file::SyncPolicy sync)
+	{
+		std::string pdf_path = pdf::get_path(fields.id, pdf::FileType::PDF);
+		try {
+			file::write_file_atomic(pdf_path, renderer.render(fields), sync, std::ios::binary);
+		} catch (const pdf::UnencodableText& e) {
+			logging::warning() << "Warning (ID: " << fields.id << "): " << e.what() << ", converting the html title page instead.";
+			return false;
+		} catch (const std::exception& e) {
+			logging::error() << "Error (ID: " << fields.id << "): " << e.what();
+			return false;
 		}
+		logging::info() << "Title page PDF written successfully.";
+		return true;
 	}
 
 	// Determine the full path of the targeted paper
-	// If the file is moved before the script is run, this will return return an empty string
-	// If the script is run a second time after being moved it will provide a path string
+	// If the directory is moved before the script is run, this will return return an empty string
+	// The entry itself is usually gone by now, it was renamed to the given filename
 	std::string get_pub_paper_path(const fs::directory_entry entry, const std::string& id, const std::string filename)
 	{
 		std::string pdf_path = "";
-		if (fs::exists(entry.path())) {
+		if (fs::is_directory(entry.path().parent_path())) {
 			pdf_path = entry.path().parent_path().string();
 			pdf_path += "/" + filename;
 		} else {
@@ -257,108 +310,100 @@ namespace pdf
 		return pdf_path;
 	}
 
-	// Uses a title offset to determine where the actual paper begins and removes any pages before this number
-	void remove_title_page(const fs::directory_entry entry, const std::string& id, const std::string filename, const int title_offset)
+	// Replaces the pages before the title offset with the stand-alone title page .pdf in a single
+	// in-process splice, falls back to fuse_title_page() for pdfs it cannot read
+	bool replace_title_page(
+		const fs::directory_entry entry, 
+		const std::string& id, 
+		const std::string filename, 
+		const int title_offset,
+		process::ProcessRunner& runner,
+		const file::SyncPolicy sync,
+		pdf::RenderCache* cache)
 	{
 		std::string pub = rdf::get_acronym(id, '-');
 		std::string base_path = pdf::get_dir(id);
-		base_path += "/GeneralPDF" + pub;
-
-		// Mimicking the naming conventions of the paperGenerator.php script used by the 
-		// website: pdf_out <-> pdfOut) and temp_pdf_in <-> tempPdfIn
+		std::string title_page_pdf = base_path + "/" + id + "Pub.pdf";
 		std::string pdf_out = pdf::get_pub_paper_path(entry, id, filename);
 
-		bool copied = false;
-		if (fs::is_regular_file(pdf_out.c_str())) {
-			std::string temp_pdf_in = base_path + "/" + id + "finalPaper_ScriptFix.pdf";
+		if (!fs::is_regular_file(pdf_out.c_str())) {
+			logging::error() << "Unexpected filetype, returning without replacing the title page.";
+			return false;
+		}
 
-			// Creating a copy of the published paper
-			if (fs::exists(temp_pdf_in)) {
-				copied = fs::copy_file(pdf_out, temp_pdf_in, fs::copy_options::overwrite_existing);
-			} else {
-				copied = fs::copy_file(pdf_out, temp_pdf_in, fs::copy_options::none);
+		// Splicing the same title page in again would only drop it along with the old one, so a paper
+		// that still is the output of the last splice with this title page and offset is left alone
+		uint64_t title_hash = 0;
+		uint64_t input = 0;
+		bool hashed = (cache != nullptr && file::hash_file(title_page_pdf, title_hash));
+		if (hashed) {
+			input = file::Xxh64().update(GHOST_SCRIPT_BIN).update(static_cast<uint64_t>(title_offset)).update(title_hash).digest();
+			if (cache->is_fresh(id, "pdf-splice", input, pdf_out)) {
+				logging::info() << "Published PDF already has this title page, nothing to replace.";
+				return true;
 			}
+		}
 
-			if (!copied) {
-				std::cerr << "Error (ID:" + id + "): Did not create copy of " << pdf_out << std::endl;
-				if (fs::exists(temp_pdf_in)) { fs::remove(temp_pdf_in); }
-				else { return; }
-			} else {
-				// Run the ghostscript exe that is already used by the server
-				std::string ghost_script_bin = "C:/inetpub/vhosts/accessecon.com/httpdocs/ghostscript/bin/gswin32c.exe";
-				std::string cmd_options = "-dBATCH -dNOPAUSE -q -sDEVICE=pdfwrite -dFirstPage=" + std::to_string(title_offset) + " -sOutputFile=";
-				std::string cmd = ghost_script_bin + " " + cmd_options + pdf_out + " " + temp_pdf_in;
-
-				int result = std::system(cmd.c_str());
-				// For debugging:
-				//std::cout << cmd << std::endl; int result = 0;
-				
-				// system() will return 0 if successful, -1 if failed
-				if (result == 0) {
-					std::cout << "Old title page successfully removed from the published PDF." << std::endl;
-				} else {
-					std::cerr << "Error (ID: " + id + "): " + "Failed to remove old title page." << std::endl;
-					return;
-				}
-
-				// fs::remove(temp_pdf_in);
-			}
-		} else {
-			std::cerr << "Unexpected filetype, returning without removing original title page." << std::endl;
-			return;
+		// Keeping the same copy of the published paper that the ghostscript path leaves behind
+		std::string temp_pdf_in = base_path + "/GeneralPDF" + pub + "/" + id + "finalPaper_ScriptFix.pdf";
+		std::error_code ec;
+		fs::copy_file(pdf_out, temp_pdf_in, fs::copy_options::overwrite_existing, ec);
+		if (ec) {
+			logging::error() << "Error (ID:" << id << "): Did not create copy of " << pdf_out;
+			return false;
+		}
+
+		try {
+			// Pages, fonts, and images are copied as they are, nothing is rendered again
+			pdf::PdfDocument title_page(pdf::read_pdf(title_page_pdf));
+			pdf::PdfDocument paper(pdf::read_pdf(pdf_out));
+			std::string spliced = pdf::splice_title_page(title_page, paper, title_offset);
+			file::write_file_atomic(pdf_out, spliced, sync, std::ios::binary);
+			logging::info() << "Title page successfully replaced in the published PDF.";
+		} catch (const pdf::PdfError& e) {
+			logging::warning() << "Warning (ID: " << id << "): " << e.what() << ", replacing the title page with ghostscript instead.";
+			if (!pdf::fuse_title_page(entry, id, filename, title_offset, runner, sync)) { return false; }
 		}
+		if (hashed) { cache->store(id, "pdf-splice", input, pdf_out); }
+		return true;
 	}
 
-	// Concatenates a stand-alone title page .pdf with the paper .pdf
-	void update_title_page(const fs::directory_entry entry, const std::string& id, const std::string filename)
+	// Replaces the pages before the title offset with the stand-alone title page .pdf in one ghostscript run,
+	// a page list selects the pages of the paper so there is no intermediate copy to concatenate
+	bool fuse_title_page(
+		const fs::directory_entry entry, 
+		const std::string& id, 
+		const std::string filename, 
+		const int title_offset,
+		process::ProcessRunner& runner,
+		const file::SyncPolicy sync)
 	{
-		std::string pub = rdf::get_acronym(id, '-');
 		std::string base_path = pdf::get_dir(id);
-
-		// Mimicking the naming conventions of the paperGenerator.php script used by the 
-		// website: pdf_out <-> pdfOut) and temp_pdf_in <-> tempPdfIn
-		std::string temp_pdf_in =base_path + "/GeneralPDF" + pub;
-		temp_pdf_in += "/" + id + "_finalPaper_ScriptFix2.pdf";
 		std::string title_page_pdf = base_path + "/" + id + "Pub.pdf";
 		std::string pdf_out = pdf::get_pub_paper_path(entry, id, filename);
 
-		bool copied = false;
-		if (fs::is_regular_file(pdf_out.c_str())) {
-			// Creating a copy of the published paper, copy_file returns true if successful
-			if (fs::exists(temp_pdf_in)) {
-				copied = fs::copy_file(pdf_out, temp_pdf_in, fs::copy_options::overwrite_existing);
-			} else {
-				copied = fs::copy_file(pdf_out, temp_pdf_in, fs::copy_options::none);
-			}
-
-			if (!copied) {
-				std::cerr << "Error (ID:" + id + "): Did not create copy of " << pdf_out << std::endl;
-				if (fs::exists(temp_pdf_in)) { fs::remove(temp_pdf_in); }
-				else { return; }
-			}
-			else {
-				// Run the ghostscript exe that is already used by the server
-				std::string ghost_script_bin = "C:/inetpub/vhosts/accessecon.com/httpdocs/ghostscript/bin/gswin32c.exe";
-				std::string cmd_options = "-dBATCH -dNOPAUSE -q -sDEVICE=pdfwrite -dPDFSETTINGS=/prepress -sOutputFile=";
-				std::string cmd = ghost_script_bin + " " + cmd_options + pdf_out + " " + title_page_pdf + " " + temp_pdf_in;
-
-				int result = std::system(cmd.c_str());
-				// For debugging:
-				//std::cout << cmd << std::endl; int result = 0;
-				
-				// system() will return 0 if successful, -1 if failed
-				if (result == 0) {
-					std::cout << "New title page successfully added to the published PDF." << std::endl;
-				} else {
-					std::cerr << "Error (ID: " + id + "): " + "Failed to remove old title page." << std::endl;
-					return;
-				}
-
-				// fs::remove(temp_pdf_in);
-			}
-		} else {
-			std::cerr << "Unexpected filetype, returning without adding new title page." << std::endl;
-			return;
+		// Ghostscript writes next to the paper, the paper is only replaced once the output is complete
+		std::string temp_pdf_out = file::sibling_temp_path(pdf_out);
+		// -sPageList applies to every input file that follows it, the title page comes before it
+		process::Result result = run_tool(runner, "ghostscript", id, { GHOST_SCRIPT_BIN, {
+			"-dBATCH", "-dNOPAUSE", "-q", "-sDEVICE=pdfwrite", "-dPDFSETTINGS=/prepress",
+			"-sOutputFile=" + temp_pdf_out, title_page_pdf,
+			"-sPageList=" + std::to_string(std::max(title_offset, 1)) + "-", pdf_out }, TOOL_TIMEOUT });
+
+		std::error_code ec;
+		if (!result.ok()) {
+			logging::error() << "Error (ID: " << id << "): " << "Failed to replace the title page, ghostscript " << process::describe(result);
+			fs::remove(temp_pdf_out, ec);
+			return false;
+		}
+		try {
+			file::replace_file(temp_pdf_out, pdf_out, sync);
+		} catch (const std::exception& e) {
+			logging::error() << "Error (ID: " << id << "): " << e.what();
+			fs::remove(temp_pdf_out, ec);
+			return false;
 		}
+		logging::info() << "Title page successfully replaced in the published PDF.";
+		return true;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+#include "pdf_builder.h"
+
+namespace pdf
+{
+	PdfBuilder::PdfBuilder(const std::string& version)
+	{
+		// The comment of high-bit bytes tells transfer tools the file is binary
+		m_out = "%PDF-" + version + "\n%\xE2\xE3\xCF\xD3\n";
+		m_offsets.push_back(0);
+	}
+
+	// Reserves the next object number, objects may be written in any order
+	int PdfBuilder::allocate()
+	{
+		m_offsets.push_back(0);
+		return static_cast<int>(m_offsets.size() - 1);
+	}
+
+	void PdfBuilder::write(const int num, const PdfObject& obj)
+	{
+		m_offsets[num] = m_out.size();
+		m_out += std::to_string(num) + " 0 obj\n";
+		serialize(obj, m_out);
+		m_out += "\nendobj\n";
+	}
+
+	// Appends the xref and the trailer, the builder is empty afterwards
+	std::string PdfBuilder::finish(const PdfObject& trailer)
+	{
+		size_t xref_offset = m_out.size();
+		m_out += "xref\n0 " + std::to_string(m_offsets.size()) + "\n0000000000 65535 f\r\n";
+		char entry[32];
+		for (size_t num = 1; num < m_offsets.size(); ++num) {
+			std::snprintf(entry, sizeof(entry), "%010llu 00000 n\r\n", static_cast<unsigned long long>(m_offsets[num]));
+			m_out += entry;
+		}
+		m_out += "trailer\n";
+		serialize(trailer, m_out);
+		m_out += "\nstartxref\n" + std::to_string(xref_offset) + "\n%%EOF\n";
+		return std::move(m_out);
+	}
+
+	int PdfBuilder::get_size() const
+	{
+		return static_cast<int>(m_offsets.size());
+	}
+}
@@ -0,0 +1,877 @@
+#include "pdf_document.h"
+#include "logging.h"
+
+namespace pdf
+{
+	// Deeply nested arrays or dictionaries only show up in damaged or hostile files
+	constexpr int MAX_DEPTH = 256;
+	// Upper bound on object numbers, keeps a damaged xref from allocating gigabytes
+	constexpr int MAX_OBJECTS = 8388607;
+
+	static const PdfObject null_object;
+
+	static bool is_white(const char c) { return c == '\0' || c == '\t' || c == '\n' || c == '\f' || c == '\r' || c == ' '; }
+
+	static bool is_delimiter(const char c)
+	{
+		return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' ||
+			c == '{' || c == '}' || c == '/' || c == '%';
+	}
+
+	static bool is_integer(std::string_view token)
+	{
+		if (token.empty()) { return false; }
+		for (const char c : token) {
+			if (c < '0' || c > '9') { return false; }
+		}
+		return true;
+	}
+
+	// Tokenizes and parses objects from a pdf body or a decompressed object stream
+	class Parser
+	{
+	public:
+		Parser(std::string_view data, const size_t pos, PdfDocument* doc) : m_data(data), m_pos(pos), m_doc(doc) {}
+
+		void skip_space()
+		{
+			while (m_pos < m_data.size()) {
+				if (is_white(m_data[m_pos])) {
+					++m_pos;
+				} else if (m_data[m_pos] == '%') {
+					while (m_pos < m_data.size() && m_data[m_pos] != '\n' && m_data[m_pos] != '\r') { ++m_pos; }
+				} else {
+					break;
+				}
+			}
+		}
+
+		// Consumes the keyword if it is next, e.g. "obj" but not "objects"
+		bool accept(std::string_view keyword)
+		{
+			skip_space();
+			if (m_data.substr(m_pos, keyword.size()) != keyword) { return false; }
+			size_t end = m_pos + keyword.size();
+			if (end < m_data.size() && !is_white(m_data[end]) && !is_delimiter(m_data[end])) { return false; }
+			m_pos = end;
+			return true;
+		}
+
+		std::string_view read_token()
+		{
+			skip_space();
+			size_t begin = m_pos;
+			while (m_pos < m_data.size() && !is_white(m_data[m_pos]) && !is_delimiter(m_data[m_pos])) { ++m_pos; }
+			return m_data.substr(begin, m_pos - begin);
+		}
+
+		long long read_integer()
+		{
+			std::string_view token = read_token();
+			if (!is_integer(token)) { throw PdfError("Expected an integer at offset " + std::to_string(m_pos)); }
+			return std::stoll(std::string(token));
+		}
+
+		PdfObject parse(const int depth = 0)
+		{
+			if (depth > MAX_DEPTH) { throw PdfError("Objects nested too deeply"); }
+			skip_space();
+			if (m_pos >= m_data.size()) { throw PdfError("Unexpected end of data"); }
+
+			PdfObject obj;
+			size_t begin = m_pos;
+			char c = m_data[m_pos];
+			if (c == '/') {
+				++m_pos;
+				while (m_pos < m_data.size() && !is_white(m_data[m_pos]) && !is_delimiter(m_data[m_pos])) { ++m_pos; }
+				obj.kind = PdfObject::Kind::Name;
+				obj.text = std::string(m_data.substr(begin, m_pos - begin));
+			} else if (c == '(') {
+				// Literal strings may hold balanced parentheses, or escaped ones
+				int nesting = 0;
+				for (; m_pos < m_data.size(); ++m_pos) {
+					char s = m_data[m_pos];
+					if (s == '\\') { ++m_pos; }
+					else if (s == '(') { ++nesting; }
+					else if (s == ')' && --nesting == 0) { break; }
+				}
+				if (m_pos >= m_data.size()) { throw PdfError("Unterminated string"); }
+				++m_pos;
+				obj.kind = PdfObject::Kind::String;
+				obj.text = std::string(m_data.substr(begin, m_pos - begin));
+			} else if (c == '<' && m_pos + 1 < m_data.size() && m_data[m_pos + 1] == '<') {
+				m_pos += 2;
+				obj.kind = PdfObject::Kind::Dictionary;
+				while (true) {
+					skip_space();
+					if (m_data.substr(m_pos, 2) == ">>") {
+						m_pos += 2;
+						break;
+					}
+					PdfObject key = parse(depth + 1);
+					if (key.kind != PdfObject::Kind::Name) { throw PdfError("Dictionary key is not a name"); }
+					obj.keys.push_back(std::move(key.text));
+					obj.items.push_back(parse(depth + 1));
+				}
+			} else if (c == '<') {
+				size_t end = m_data.find('>', m_pos);
+				if (end == std::string_view::npos) { throw PdfError("Unterminated hex string"); }
+				m_pos = end + 1;
+				obj.kind = PdfObject::Kind::String;
+				obj.text = std::string(m_data.substr(begin, m_pos - begin));
+			} else if (c == '[') {
+				++m_pos;
+				obj.kind = PdfObject::Kind::Array;
+				while (true) {
+					skip_space();
+					if (m_pos < m_data.size() && m_data[m_pos] == ']') {
+						++m_pos;
+						break;
+					}
+					obj.items.push_back(parse(depth + 1));
+				}
+			} else {
+				std::string_view token = read_token();
+				if (token.empty()) { throw PdfError("Unexpected character at offset " + std::to_string(m_pos)); }
+				if (token == "true" || token == "false") {
+					obj.kind = PdfObject::Kind::Boolean;
+					obj.text = std::string(token);
+				} else if (token == "null") {
+					obj.kind = PdfObject::Kind::Null;
+				} else if ((token[0] >= '0' && token[0] <= '9') || token[0] == '+' || token[0] == '-' || token[0] == '.') {
+					obj.kind = PdfObject::Kind::Number;
+					obj.text = std::string(token);
+					if (is_integer(token)) { read_reference(obj); }
+				} else {
+					throw PdfError("Unexpected token '" + std::string(token) + "' at offset " + std::to_string(begin));
+				}
+			}
+			return obj;
+		}
+
+		// Parses "num gen obj", the object, and its stream data if it has any
+		PdfObject parse_indirect(int& num)
+		{
+			long long object_num = read_integer();
+			read_integer();
+			if (!accept("obj")) { throw PdfError("Missing 'obj' keyword at offset " + std::to_string(m_pos)); }
+			num = static_cast<int>(object_num);
+
+			PdfObject obj = parse();
+			if (obj.kind == PdfObject::Kind::Dictionary && accept("stream")) {
+				read_stream(obj);
+			}
+			return obj;
+		}
+
+		size_t get_pos() const { return m_pos; }
+	private:
+		// Turns "num gen R" into a reference, the first integer is already read
+		void read_reference(PdfObject& obj)
+		{
+			size_t after_num = m_pos;
+			std::string_view gen = read_token();
+			if (is_integer(gen) && accept("R")) {
+				obj.kind = PdfObject::Kind::Reference;
+				obj.num = static_cast<int>(std::min<long long>(std::stoll(obj.text), MAX_OBJECTS + 1));
+				obj.gen = static_cast<int>(std::min<long long>(std::stoll(std::string(gen)), 65535));
+				obj.text.clear();
+			} else {
+				m_pos = after_num;
+			}
+		}
+
+		void read_stream(PdfObject& obj)
+		{
+			// The data starts after a CRLF or LF, a lone CR is tolerated
+			if (m_pos < m_data.size() && m_data[m_pos] == '\r') { ++m_pos; }
+			if (m_pos < m_data.size() && m_data[m_pos] == '\n') { ++m_pos; }
+			size_t begin = m_pos;
+
+			long long length = -1;
+			const PdfObject* length_obj = obj.get("/Length");
+			if (length_obj != nullptr && m_doc != nullptr) {
+				try {
+					length = m_doc->resolve_int(*length_obj);
+				} catch (const PdfError&) {
+					length = -1;
+				}
+			}
+
+			size_t end = std::string_view::npos;
+			if (length >= 0 && begin + static_cast<size_t>(length) <= m_data.size()) {
+				m_pos = begin + static_cast<size_t>(length);
+				if (accept("endstream")) { end = begin + static_cast<size_t>(length); }
+			}
+			if (end == std::string_view::npos) {
+				// A wrong /Length is common enough to look for the keyword instead
+				size_t keyword = m_data.find("endstream", begin);
+				if (keyword == std::string_view::npos) { throw PdfError("Missing 'endstream' keyword"); }
+				end = keyword;
+				if (end > begin && m_data[end - 1] == '\n') { --end; }
+				if (end > begin && m_data[end - 1] == '\r') { --end; }
+				m_pos = keyword + 9;
+			}
+
+			obj.kind = PdfObject::Kind::Stream;
+			obj.stream = m_data.substr(begin, end - begin);
+		}
+
+		std::string_view m_data;
+		size_t m_pos;
+		PdfDocument* m_doc;
+	};
+
+	const PdfObject* PdfObject::get(std::string_view key) const
+	{
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (keys[i] == key) { return &items[i]; }
+		}
+		return nullptr;
+	}
+
+	// Replaces the value of a key or appends it
+	void PdfObject::set(const std::string& key, PdfObject value)
+	{
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (keys[i] == key) {
+				items[i] = std::move(value);
+				return;
+			}
+		}
+		keys.push_back(key);
+		items.push_back(std::move(value));
+	}
+
+	void PdfObject::erase(std::string_view key)
+	{
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (keys[i] == key) {
+				keys.erase(keys.begin() + i);
+				items.erase(items.begin() + i);
+				return;
+			}
+		}
+	}
+
+	PdfObject PdfObject::make_name(const std::string& name)
+	{
+		PdfObject obj;
+		obj.kind = Kind::Name;
+		obj.text = name;
+		return obj;
+	}
+
+	PdfObject PdfObject::make_number(const long long value)
+	{
+		PdfObject obj;
+		obj.kind = Kind::Number;
+		obj.text = std::to_string(value);
+		return obj;
+	}
+
+	PdfObject PdfObject::make_reference(const int num)
+	{
+		PdfObject obj;
+		obj.kind = Kind::Reference;
+		obj.num = num;
+		return obj;
+	}
+
+	// Written with two decimals, enough for positions and sizes in points
+	PdfObject PdfObject::make_real(const double value)
+	{
+		PdfObject obj;
+		obj.kind = Kind::Number;
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+		obj.text = buffer;
+		// Trailing zeros only take up space
+		while (obj.text.back() == '0') { obj.text.pop_back(); }
+		if (obj.text.back() == '.') { obj.text.pop_back(); }
+		if (obj.text == "-0") { obj.text = "0"; }
+		return obj;
+	}
+
+	// Escapes the bytes into a literal string
+	PdfObject PdfObject::make_string(std::string_view bytes)
+	{
+		PdfObject obj;
+		obj.kind = Kind::String;
+		obj.text.reserve(bytes.size() + 2);
+		obj.text += '(';
+		for (char c : bytes) {
+			unsigned char byte = static_cast<unsigned char>(c);
+			if (c == '(' || c == ')' || c == '\\') {
+				obj.text += '\\';
+				obj.text += c;
+			} else if (byte < 32) {
+				// Line ends inside a string would be read back as a plain newline
+				char escaped[5];
+				std::snprintf(escaped, sizeof(escaped), "\\%03o", byte);
+				obj.text += escaped;
+			} else {
+				obj.text += c;
+			}
+		}
+		obj.text += ')';
+		return obj;
+	}
+
+	PdfObject PdfObject::make_array()
+	{
+		PdfObject obj;
+		obj.kind = Kind::Array;
+		return obj;
+	}
+
+	PdfObject PdfObject::make_dictionary()
+	{
+		PdfObject obj;
+		obj.kind = Kind::Dictionary;
+		return obj;
+	}
+
+	// Writes an object the way it would appear in a pdf body, streams include their data
+	void serialize(const PdfObject& obj, std::string& out)
+	{
+		switch (obj.kind) {
+		case PdfObject::Kind::Null:
+			out += "null";
+			break;
+		case PdfObject::Kind::Boolean:
+		case PdfObject::Kind::Number:
+		case PdfObject::Kind::String:
+		case PdfObject::Kind::Name:
+			out += obj.text;
+			break;
+		case PdfObject::Kind::Reference:
+			out += std::to_string(obj.num) + " " + std::to_string(obj.gen) + " R";
+			break;
+		case PdfObject::Kind::Array:
+			out += '[';
+			for (size_t i = 0; i < obj.items.size(); ++i) {
+				if (i != 0) { out += ' '; }
+				serialize(obj.items[i], out);
+			}
+			out += ']';
+			break;
+		case PdfObject::Kind::Dictionary:
+		case PdfObject::Kind::Stream:
+			out += "<<";
+			for (size_t i = 0; i < obj.keys.size(); ++i) {
+				out += '\n';
+				out += obj.keys[i];
+				out += ' ';
+				serialize(obj.items[i], out);
+			}
+			out += "\n>>";
+			if (obj.kind == PdfObject::Kind::Stream) {
+				out += "\nstream\n";
+				out.append(obj.stream.data(), obj.stream.size());
+				out += "\nendstream";
+			}
+			break;
+		}
+	}
+
+	// Reads a whole file into memory, throws PdfError if it cannot be opened
+	std::string read_pdf(const std::string& path)
+	{
+		std::ifstream pdf_file(path, std::ios::binary);
+		if (!pdf_file.is_open()) { throw PdfError("Unable to open file for read: " + path); }
+		std::string data((std::istreambuf_iterator<char>(pdf_file)), std::istreambuf_iterator<char>());
+		if (pdf_file.bad()) { throw PdfError("Failed to read: " + path); }
+		return data;
+	}
+
+	// Takes the whole file, throws PdfError if the pdf cannot be read
+	PdfDocument::PdfDocument(std::string data) : m_data(std::move(data))
+	{
+		size_t header = m_data.find("%PDF-");
+		if (header == std::string::npos || header > 1024) { throw PdfError("Missing %PDF header"); }
+		m_version = m_data.substr(header + 5, 3);
+
+		read_xref();
+
+		if (m_trailer.get("/Encrypt") != nullptr) { throw PdfError("Encrypted pdfs are not supported"); }
+		const PdfObject* root_ref = m_trailer.get("/Root");
+		if (root_ref == nullptr || !resolve(*root_ref).is_dictionary()) { throw PdfError("Missing document catalog"); }
+
+		// Incremental updates raise the version in the catalog instead of the header
+		const PdfObject* catalog_version = resolve(*root_ref).get("/Version");
+		if (catalog_version != nullptr && catalog_version->kind == PdfObject::Kind::Name &&
+			catalog_version->text.size() > 1 && catalog_version->text.substr(1) > m_version) {
+			m_version = catalog_version->text.substr(1);
+		}
+	}
+
+	// Version from the header, or the catalog if it was raised by an incremental update
+	std::string PdfDocument::get_version() const { return m_version; }
+
+	const PdfObject& PdfDocument::get_trailer() const { return m_trailer; }
+
+	int PdfDocument::get_size() const { return static_cast<int>(m_xref.size()); }
+
+	void PdfDocument::read_xref()
+	{
+		try {
+			size_t startxref = m_data.rfind("startxref");
+			if (startxref == std::string::npos) { throw PdfError("Missing startxref"); }
+			Parser parser(m_data, startxref + 9, this);
+			size_t offset = static_cast<size_t>(parser.read_integer());
+
+			std::unordered_set<size_t> visited;
+			read_xref_section(offset, visited);
+			if (m_trailer.get("/Root") == nullptr) { throw PdfError("Trailer without /Root"); }
+		} catch (const PdfError&) {
+			rebuild_xref();
+		}
+	}
+
+	// Reads a classic xref table or an xref stream, then the sections it updates
+	void PdfDocument::read_xref_section(size_t offset, std::unordered_set<size_t>& visited)
+	{
+		if (offset >= m_data.size() || !visited.insert(offset).second) { throw PdfError("Invalid xref offset"); }
+
+		Parser parser(m_data, offset, this);
+		PdfObject section;
+		if (parser.accept("xref")) {
+			size_t pos = parser.get_pos();
+			read_xref_table(pos);
+			Parser trailer_parser(m_data, pos, this);
+			section = trailer_parser.parse();
+			if (!section.is_dictionary()) { throw PdfError("Invalid trailer"); }
+
+			// Hybrid files list their compressed objects in an xref stream next to the table
+			const PdfObject* xref_stream = section.get("/XRefStm");
+			if (xref_stream != nullptr && xref_stream->kind == PdfObject::Kind::Number) {
+				int num = 0;
+				Parser stream_parser(m_data, static_cast<size_t>(std::stoll(xref_stream->text)), this);
+				read_xref_stream(stream_parser.parse_indirect(num));
+			}
+		} else {
+			int num = 0;
+			section = parser.parse_indirect(num);
+			read_xref_stream(section);
+		}
+
+		// The newest section holds the trailer of the document
+		if (m_trailer.kind == PdfObject::Kind::Null) {
+			m_trailer = section;
+			m_trailer.kind = PdfObject::Kind::Dictionary;
+			m_trailer.stream = std::string_view();
+		}
+
+		const PdfObject* prev = section.get("/Prev");
+		if (prev != nullptr && prev->kind == PdfObject::Kind::Number) {
+			read_xref_section(static_cast<size_t>(std::stoll(prev->text)), visited);
+		}
+	}
+
+	// Reads the subsections of a classic xref table up to its trailer keyword
+	void PdfDocument::read_xref_table(size_t& pos)
+	{
+		Parser parser(m_data, pos, this);
+		while (!parser.accept("trailer")) {
+			long long first = parser.read_integer();
+			long long count = parser.read_integer();
+			if (first < 0 || count < 0 || first + count > MAX_OBJECTS) { throw PdfError("Invalid xref subsection"); }
+			for (long long i = 0; i < count; ++i) {
+				XrefEntry entry;
+				entry.offset = static_cast<size_t>(parser.read_integer());
+				parser.read_integer();
+				std::string_view type = parser.read_token();
+				if (type == "n") { entry.type = 1; }
+				else if (type != "f") { throw PdfError("Invalid xref entry"); }
+				set_entry(static_cast<int>(first + i), entry);
+			}
+		}
+		pos = parser.get_pos();
+	}
+
+	void PdfDocument::read_xref_stream(const PdfObject& stream)
+	{
+		const PdfObject* type = stream.get("/Type");
+		if (stream.kind != PdfObject::Kind::Stream || type == nullptr || type->text != "/XRef") {
+			throw PdfError("Expected an xref stream");
+		}
+
+		const PdfObject* widths = stream.get("/W");
+		if (widths == nullptr || widths->kind != PdfObject::Kind::Array || widths->items.size() != 3) {
+			throw PdfError("Invalid /W in xref stream");
+		}
+		size_t w[3];
+		for (int i = 0; i < 3; ++i) {
+			long long width = resolve_int(widths->items[i]);
+			if (width < 0 || width > 8) { throw PdfError("Invalid /W in xref stream"); }
+			w[i] = static_cast<size_t>(width);
+		}
+
+		std::vector<long long> index;
+		const PdfObject* index_obj = stream.get("/Index");
+		if (index_obj != nullptr && index_obj->kind == PdfObject::Kind::Array) {
+			for (const auto& item : index_obj->items) { index.push_back(resolve_int(item)); }
+		} else {
+			const PdfObject* size = stream.get("/Size");
+			if (size == nullptr) { throw PdfError("Missing /Size in xref stream"); }
+			index = { 0, resolve_int(*size) };
+		}
+
+		std::string data = decode_stream(stream);
+		size_t entry_size = w[0] + w[1] + w[2];
+		size_t pos = 0;
+		auto field = [&](const size_t width) {
+			unsigned long long value = 0;
+			for (size_t i = 0; i < width; ++i) { value = (value << 8) | static_cast<unsigned char>(data[pos++]); }
+			return value;
+		};
+
+		for (size_t i = 0; i + 1 < index.size(); i += 2) {
+			if (index[i] < 0 || index[i + 1] < 0 || index[i] + index[i + 1] > MAX_OBJECTS) { throw PdfError("Invalid /Index in xref stream"); }
+			for (long long n = 0; n < index[i + 1]; ++n) {
+				if (pos + entry_size > data.size()) { throw PdfError("Truncated xref stream"); }
+				// The type defaults to 1 when its field has no width
+				unsigned long long entry_type = (w[0] == 0) ? 1 : field(w[0]);
+				unsigned long long second = field(w[1]);
+				unsigned long long third = field(w[2]);
+
+				XrefEntry entry;
+				entry.type = static_cast<int>(entry_type);
+				if (entry_type == 1) {
+					entry.offset = static_cast<size_t>(second);
+				} else if (entry_type == 2) {
+					entry.stream_num = static_cast<int>(second);
+					entry.index = static_cast<int>(third);
+				} else {
+					entry.type = 0;
+				}
+				set_entry(static_cast<int>(index[i] + n), entry);
+			}
+		}
+	}
+
+	void PdfDocument::set_entry(const int num, const XrefEntry& entry)
+	{
+		if (num < 0 || num > MAX_OBJECTS) { return; }
+		if (static_cast<size_t>(num) >= m_xref.size()) {
+			m_xref.resize(num + 1);
+			m_xref_set.resize(num + 1, false);
+		}
+		if (!m_xref_set[num]) {
+			m_xref[num] = entry;
+			m_xref_set[num] = true;
+		}
+	}
+
+	// Finds every "num gen obj" in the file, later definitions replace earlier ones
+	// the same way an incremental update would
+	void PdfDocument::rebuild_xref()
+	{
+		logging::warning() << "Rebuilding the damaged xref of a pdf.";
+		m_rebuilt = true;
+		m_xref.clear();
+		m_xref_set.clear();
+
+		std::vector<std::pair<int, size_t>> found;
+		size_t keyword = 0;
+		while ((keyword = m_data.find("obj", keyword + 1)) != std::string::npos) {
+			size_t end = keyword + 3;
+			if (end < m_data.size() && !is_white(m_data[end]) && !is_delimiter(m_data[end])) continue;
+
+			// Walk back over "num gen "
+			size_t pos = keyword;
+			int fields = 0;
+			while (fields < 2) {
+				size_t space_end = pos;
+				while (pos > 0 && is_white(m_data[pos - 1])) { --pos; }
+				if (pos == space_end) break;
+				size_t digits_end = pos;
+				while (pos > 0 && m_data[pos - 1] >= '0' && m_data[pos - 1] <= '9') { --pos; }
+				if (pos == digits_end) break;
+				++fields;
+			}
+			if (fields != 2 || (pos > 0 && !is_white(m_data[pos - 1]) && !is_delimiter(m_data[pos - 1]))) continue;
+
+			Parser parser(m_data, pos, this);
+			long long num = parser.read_integer();
+			if (num > 0 && num <= MAX_OBJECTS) { found.emplace_back(static_cast<int>(num), pos); }
+		}
+
+		for (const auto& object : found) {
+			if (static_cast<size_t>(object.first) >= m_xref.size()) {
+				m_xref.resize(object.first + 1);
+				m_xref_set.resize(object.first + 1, false);
+			}
+			m_xref[object.first].type = 1;
+			m_xref[object.first].offset = object.second;
+			m_xref_set[object.first] = true;
+		}
+
+		// Objects only found inside object streams, and the trailer if the old one is lost
+		PdfObject last_xref_stream;
+		for (const auto& object : found) {
+			const PdfObject* type = nullptr;
+			try {
+				const PdfObject& obj = get_object(object.first);
+				type = obj.get("/Type");
+				if (type != nullptr && type->text == "/XRef" && obj.get("/Root") != nullptr) {
+					last_xref_stream = obj;
+				}
+				if (type == nullptr || type->text != "/ObjStm") continue;
+
+				std::string data = decode_stream(obj);
+				long long count = resolve_int(*obj.get("/N"));
+				Parser parser(data, 0, this);
+				for (long long i = 0; i < count; ++i) {
+					long long num = parser.read_integer();
+					parser.read_integer();
+					if (num > 0 && num <= MAX_OBJECTS && (static_cast<size_t>(num) >= m_xref.size() || !m_xref_set[num])) {
+						XrefEntry entry;
+						entry.type = 2;
+						entry.stream_num = object.first;
+						entry.index = static_cast<int>(i);
+						set_entry(static_cast<int>(num), entry);
+					}
+				}
+			} catch (const std::exception&) {
+				continue;
+			}
+		}
+
+		if (m_trailer.get("/Root") == nullptr) {
+			size_t trailer = m_data.rfind("trailer");
+			while (trailer != std::string::npos) {
+				try {
+					Parser parser(m_data, trailer + 7, this);
+					PdfObject dict = parser.parse();
+					if (dict.is_dictionary() && dict.get("/Root") != nullptr) {
+						m_trailer = dict;
+						break;
+					}
+				} catch (const PdfError&) {}
+				trailer = (trailer == 0) ? std::string::npos : m_data.rfind("trailer", trailer - 1);
+			}
+		}
+		if (m_trailer.get("/Root") == nullptr && last_xref_stream.get("/Root") != nullptr) {
+			m_trailer = last_xref_stream;
+			m_trailer.kind = PdfObject::Kind::Dictionary;
+			m_trailer.stream = std::string_view();
+		}
+		if (m_trailer.get("/Root") == nullptr) {
+			// Last resort, the catalog is the object that says it is one
+			for (auto object = found.rbegin(); object != found.rend(); ++object) {
+				try {
+					const PdfObject* type = get_object(object->first).get("/Type");
+					if (type != nullptr && type->text == "/Catalog") {
+						m_trailer = PdfObject::make_dictionary();
+						m_trailer.set("/Root", PdfObject::make_reference(object->first));
+						break;
+					}
+				} catch (const PdfError&) {
+					continue;
+				}
+			}
+		}
+		if (m_trailer.get("/Root") == nullptr) { throw PdfError("Unable to find the document catalog"); }
+	}
+
+	// Returns a null object for free or missing objects
+	const PdfObject& PdfDocument::get_object(const int num)
+	{
+		auto cached = m_objects.find(num);
+		if (cached != m_objects.end()) { return cached->second; }
+		if (!m_loading.insert(num).second) { throw PdfError("Object " + std::to_string(num) + " refers to itself"); }
+
+		PdfObject obj;
+		try {
+			obj = load_object(num);
+		} catch (...) {
+			m_loading.erase(num);
+			throw;
+		}
+		m_loading.erase(num);
+		return m_objects.emplace(num, std::move(obj)).first->second;
+	}
+
+	PdfObject PdfDocument::load_object(const int num)
+	{
+		if (num <= 0 || static_cast<size_t>(num) >= m_xref.size()) { return null_object; }
+		XrefEntry entry = m_xref[num];
+
+		if (entry.type == 2) { return load_compressed(entry, num); }
+		if (entry.type != 1) { return null_object; }
+
+		int found = -1;
+		PdfObject obj;
+		try {
+			obj = parse_indirect(entry.offset, found);
+		} catch (const PdfError&) {
+			found = -1;
+		}
+		if (found != num) {
+			// The xref points somewhere else, fix it once and look again
+			if (m_rebuilt) { throw PdfError("Object " + std::to_string(num) + " not found"); }
+			rebuild_xref();
+			return load_object(num);
+		}
+		return obj;
+	}
+
+	PdfObject PdfDocument::parse_indirect(size_t offset, int& num)
+	{
+		if (offset >= m_data.size()) { throw PdfError("Object offset past the end of the file"); }
+		Parser parser(m_data, offset, this);
+		return parser.parse_indirect(num);
+	}
+
+	PdfObject PdfDocument::load_compressed(const XrefEntry& entry, const int num)
+	{
+		const PdfObject& object_stream = get_object(entry.stream_num);
+		if (object_stream.kind != PdfObject::Kind::Stream) { throw PdfError("Invalid object stream " + std::to_string(entry.stream_num)); }
+
+		auto decoded = m_object_streams.find(entry.stream_num);
+		if (decoded == m_object_streams.end()) {
+			decoded = m_object_streams.emplace(entry.stream_num, decode_stream(object_stream)).first;
+		}
+		const PdfObject* count = object_stream.get("/N");
+		const PdfObject* first = object_stream.get("/First");
+		if (count == nullptr || first == nullptr) { throw PdfError("Object stream without /N or /First"); }
+
+		// The header pairs object numbers with offsets relative to /First
+		Parser header(decoded->second, 0, this);
+		long long objects = resolve_int(*count);
+		for (long long i = 0; i < objects; ++i) {
+			long long object_num = header.read_integer();
+			long long offset = header.read_integer();
+			if (object_num == num) {
+				Parser parser(decoded->second, static_cast<size_t>(resolve_int(*first) + offset), this);
+				return parser.parse();
+			}
+		}
+		throw PdfError("Object " + std::to_string(num) + " missing from its object stream");
+	}
+
+	// Follows a reference, anything else is returned as is
+	const PdfObject& PdfDocument::resolve(const PdfObject& obj)
+	{
+		if (obj.kind != PdfObject::Kind::Reference) { return obj; }
+		return get_object(obj.num);
+	}
+
+	// Integer value of a number or a reference to one
+	long long PdfDocument::resolve_int(const PdfObject& obj)
+	{
+		const PdfObject& value = resolve(obj);
+		if (value.kind != PdfObject::Kind::Number) { throw PdfError("Expected a number"); }
+		try {
+			return static_cast<long long>(std::stod(value.text));
+		} catch (const std::exception&) {
+			throw PdfError("Invalid number '" + value.text + "'");
+		}
+	}
+
+	// Decodes a stream whose filters are limited to /FlateDecode, throws PdfError otherwise
+	std::string PdfDocument::decode_stream(const PdfObject& stream)
+	{
+		std::vector<PdfObject> filters;
+		std::vector<PdfObject> parameters;
+		if (const PdfObject* filter = stream.get("/Filter")) {
+			const PdfObject& value = resolve(*filter);
+			if (value.kind == PdfObject::Kind::Array) { filters = value.items; }
+			else { filters.push_back(value); }
+		}
+		if (const PdfObject* parms = stream.get("/DecodeParms")) {
+			const PdfObject& value = resolve(*parms);
+			if (value.kind == PdfObject::Kind::Array) { parameters = value.items; }
+			else { parameters.push_back(value); }
+		}
+
+		std::string data(stream.stream);
+		for (size_t i = 0; i < filters.size(); ++i) {
+			const PdfObject& filter = resolve(filters[i]);
+			if (filter.text != "/FlateDecode" && filter.text != "/Fl") {
+				throw PdfError("Unsupported stream filter " + filter.text);
+			}
+			std::string inflated;
+			if (!pdf::inflate(data, inflated)) { throw PdfError("Corrupt /FlateDecode stream"); }
+			data.swap(inflated);
+
+			if (i >= parameters.size()) continue;
+			const PdfObject& parms = resolve(parameters[i]);
+			if (!parms.is_dictionary()) continue;
+			auto parameter = [&](const char* key, const long long fallback) {
+				const PdfObject* value = parms.get(key);
+				return (value == nullptr) ? fallback : resolve_int(*value);
+			};
+			long long predictor = parameter("/Predictor", 1);
+			if (predictor >= 10) {
+				if (!pdf::undo_png_predictor(data, static_cast<int>(parameter("/Colors", 1)),
+					static_cast<int>(parameter("/BitsPerComponent", 8)), static_cast<int>(parameter("/Columns", 1)))) {
+					throw PdfError("Corrupt PNG predictor data");
+				}
+			} else if (predictor != 1) {
+				throw PdfError("Unsupported predictor " + std::to_string(predictor));
+			}
+		}
+		return data;
+	}
+
+	// Page objects in reading order, with inherited attributes copied into every page
+	const std::vector<PdfDocument::Page>& PdfDocument::get_pages()
+	{
+		if (!m_pages_read) {
+			m_pages_read = true;
+			const PdfObject& catalog = resolve(*m_trailer.get("/Root"));
+			const PdfObject* pages = catalog.get("/Pages");
+			if (pages == nullptr) { throw PdfError("Catalog without /Pages"); }
+			collect_pages(*pages, PdfObject::make_dictionary(), 0);
+		}
+		return m_pages;
+	}
+
+	// Object numbers of every node in the page tree, pages included
+	const std::unordered_set<int>& PdfDocument::get_page_tree()
+	{
+		get_pages();
+		return m_page_tree;
+	}
+
+	void PdfDocument::collect_pages(const PdfObject& node_ref, const PdfObject& inherited, const int depth)
+	{
+		static const char* inheritable[] = { "/Resources", "/MediaBox", "/CropBox", "/Rotate" };
+
+		if (depth > MAX_DEPTH) { throw PdfError("Page tree nested too deeply"); }
+		if (node_ref.kind != PdfObject::Kind::Reference) { throw PdfError("Page tree node is not an indirect object"); }
+		if (!m_page_tree.insert(node_ref.num).second) { throw PdfError("Page tree refers back to itself"); }
+
+		const PdfObject& node = get_object(node_ref.num);
+		if (!node.is_dictionary()) { throw PdfError("Page tree node is not a dictionary"); }
+
+		PdfObject attributes = inherited;
+		for (const char* key : inheritable) {
+			if (const PdfObject* value = node.get(key)) { attributes.set(key, *value); }
+		}
+
+		const PdfObject* type = node.get("/Type");
+		const PdfObject* kids = node.get("/Kids");
+		bool is_page = (type != nullptr) ? type->text == "/Page" : kids == nullptr;
+		if (!is_page) {
+			if (kids == nullptr) { throw PdfError("Page tree node without /Kids"); }
+			// Copied since loading the kids may add to the object cache
+			std::vector<PdfObject> children = resolve(*kids).items;
+			for (const auto& child : children) {
+				collect_pages(child, attributes, depth + 1);
+			}
+			return;
+		}
+
+		Page page{ node_ref.num, node };
+		page.dict.kind = PdfObject::Kind::Dictionary;
+		for (const char* key : inheritable) {
+			const PdfObject* value = attributes.get(key);
+			if (page.dict.get(key) == nullptr && value != nullptr) { page.dict.set(key, *value); }
+		}
+		m_pages.push_back(std::move(page));
+	}
+}
@@ -0,0 +1,291 @@
+#include "pdf_flate.h"
+
+namespace pdf
+{
+	// A small inflater after the layout of zlib's reference decoder (puff.c), only xref and
+	// object streams are ever decompressed so it favours brevity over speed
+	namespace
+	{
+		constexpr int MAX_BITS = 15;
+		constexpr int MAX_LENGTH_CODES = 286;
+		constexpr int MAX_DIST_CODES = 30;
+		constexpr int FIXED_LENGTH_CODES = 288;
+
+		struct InflateError : std::runtime_error
+		{
+			InflateError() : std::runtime_error("corrupt deflate data") {}
+		};
+
+		// Canonical Huffman code, count of codes per length and the symbols ordered by code
+		struct Huffman
+		{
+			short count[MAX_BITS + 1];
+			short symbol[FIXED_LENGTH_CODES];
+		};
+
+		class Inflater
+		{
+		public:
+			Inflater(std::string_view in, std::string& out) : m_in(in), m_out(out) {}
+
+			void run()
+			{
+				int last = 0;
+				do {
+					last = bits(1);
+					int type = bits(2);
+					if (type == 0) { stored(); }
+					else if (type == 1) { fixed(); }
+					else if (type == 2) { dynamic(); }
+					else { throw InflateError(); }
+				} while (!last);
+			}
+		private:
+			int bits(const int need)
+			{
+				uint32_t value = m_bit_buffer;
+				while (m_bit_count < need) {
+					if (m_pos >= m_in.size()) { throw InflateError(); }
+					value |= static_cast<uint32_t>(static_cast<unsigned char>(m_in[m_pos++])) << m_bit_count;
+					m_bit_count += 8;
+				}
+				m_bit_buffer = value >> need;
+				m_bit_count -= need;
+				return static_cast<int>(value & ((1u << need) - 1));
+			}
+
+			void stored()
+			{
+				// Stored blocks start on a byte boundary
+				m_bit_buffer = 0;
+				m_bit_count = 0;
+				if (m_pos + 4 > m_in.size()) { throw InflateError(); }
+				unsigned len = static_cast<unsigned char>(m_in[m_pos]) | (static_cast<unsigned char>(m_in[m_pos + 1]) << 8);
+				unsigned nlen = static_cast<unsigned char>(m_in[m_pos + 2]) | (static_cast<unsigned char>(m_in[m_pos + 3]) << 8);
+				m_pos += 4;
+				if (len != (~nlen & 0xffff) || m_pos + len > m_in.size()) { throw InflateError(); }
+				m_out.append(m_in.data() + m_pos, len);
+				m_pos += len;
+			}
+
+			int decode(const Huffman& h)
+			{
+				int code = 0;
+				int first = 0;
+				int index = 0;
+				for (int len = 1; len <= MAX_BITS; ++len) {
+					code |= bits(1);
+					int count = h.count[len];
+					if (code - count < first) { return h.symbol[index + (code - first)]; }
+					index += count;
+					first += count;
+					first <<= 1;
+					code <<= 1;
+				}
+				throw InflateError();
+			}
+
+			// Returns 0 for a complete code, a positive number for an incomplete one, negative if over-subscribed
+			static int construct(Huffman& h, const short* length, const int n)
+			{
+				for (int len = 0; len <= MAX_BITS; ++len) { h.count[len] = 0; }
+				for (int symbol = 0; symbol < n; ++symbol) { h.count[length[symbol]]++; }
+				if (h.count[0] == n) { return 0; }
+
+				int left = 1;
+				for (int len = 1; len <= MAX_BITS; ++len) {
+					left <<= 1;
+					left -= h.count[len];
+					if (left < 0) { return left; }
+				}
+
+				short offsets[MAX_BITS + 1];
+				offsets[1] = 0;
+				for (int len = 1; len < MAX_BITS; ++len) { offsets[len + 1] = offsets[len] + h.count[len]; }
+				for (int symbol = 0; symbol < n; ++symbol) {
+					if (length[symbol] != 0) { h.symbol[offsets[length[symbol]]++] = static_cast<short>(symbol); }
+				}
+				return left;
+			}
+
+			void codes(const Huffman& lencode, const Huffman& distcode)
+			{
+				static const short length_base[29] = {
+					3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+					35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+				static const short length_extra[29] = {
+					0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+					3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+				static const short dist_base[30] = {
+					1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+					257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+				static const short dist_extra[30] = {
+					0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+					7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+				int symbol = 0;
+				do {
+					symbol = decode(lencode);
+					if (symbol < 256) {
+						m_out.push_back(static_cast<char>(symbol));
+					} else if (symbol > 256) {
+						symbol -= 257;
+						if (symbol >= 29) { throw InflateError(); }
+						size_t len = length_base[symbol] + bits(length_extra[symbol]);
+
+						int dist_symbol = decode(distcode);
+						if (dist_symbol >= 30) { throw InflateError(); }
+						size_t dist = dist_base[dist_symbol] + bits(dist_extra[dist_symbol]);
+						if (dist > m_out.size()) { throw InflateError(); }
+
+						// Copied one byte at a time since the source may overlap what is being written
+						size_t from = m_out.size() - dist;
+						for (size_t i = 0; i < len; ++i) { m_out.push_back(m_out[from + i]); }
+					}
+				} while (symbol != 256);
+			}
+
+			void fixed()
+			{
+				static Huffman lencode;
+				static Huffman distcode;
+				static const bool built = [] {
+					short lengths[FIXED_LENGTH_CODES];
+					int symbol = 0;
+					for (; symbol < 144; ++symbol) { lengths[symbol] = 8; }
+					for (; symbol < 256; ++symbol) { lengths[symbol] = 9; }
+					for (; symbol < 280; ++symbol) { lengths[symbol] = 7; }
+					for (; symbol < FIXED_LENGTH_CODES; ++symbol) { lengths[symbol] = 8; }
+					construct(lencode, lengths, FIXED_LENGTH_CODES);
+					for (symbol = 0; symbol < MAX_DIST_CODES; ++symbol) { lengths[symbol] = 5; }
+					construct(distcode, lengths, MAX_DIST_CODES);
+					return true;
+				}();
+				(void)built;
+				codes(lencode, distcode);
+			}
+
+			void dynamic()
+			{
+				static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+				int nlen = bits(5) + 257;
+				int ndist = bits(5) + 1;
+				int ncode = bits(4) + 4;
+				if (nlen > MAX_LENGTH_CODES || ndist > MAX_DIST_CODES) { throw InflateError(); }
+
+				short lengths[MAX_LENGTH_CODES + MAX_DIST_CODES];
+				int index = 0;
+				for (; index < ncode; ++index) { lengths[order[index]] = static_cast<short>(bits(3)); }
+				for (; index < 19; ++index) { lengths[order[index]] = 0; }
+
+				Huffman lencode;
+				Huffman distcode;
+				if (construct(lencode, lengths, 19) != 0) { throw InflateError(); }
+
+				index = 0;
+				while (index < nlen + ndist) {
+					int symbol = decode(lencode);
+					if (symbol < 16) {
+						lengths[index++] = static_cast<short>(symbol);
+						continue;
+					}
+					short len = 0;
+					if (symbol == 16) {
+						if (index == 0) { throw InflateError(); }
+						len = lengths[index - 1];
+						symbol = 3 + bits(2);
+					} else if (symbol == 17) {
+						symbol = 3 + bits(3);
+					} else {
+						symbol = 11 + bits(7);
+					}
+					if (index + symbol > nlen + ndist) { throw InflateError(); }
+					while (symbol--) { lengths[index++] = len; }
+				}
+
+				// Without an end-of-block code the block could never finish
+				if (lengths[256] == 0) { throw InflateError(); }
+
+				int err = construct(lencode, lengths, nlen);
+				if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) { throw InflateError(); }
+				err = construct(distcode, lengths + nlen, ndist);
+				if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) { throw InflateError(); }
+
+				codes(lencode, distcode);
+			}
+
+			std::string_view m_in;
+			std::string& m_out;
+			size_t m_pos = 0;
+			uint32_t m_bit_buffer = 0;
+			int m_bit_count = 0;
+		};
+	}
+
+	// Decompresses a /FlateDecode stream, with or without the zlib header
+	bool inflate(std::string_view data, std::string& out)
+	{
+		// A zlib header is a deflate method byte whose check bits make the first two bytes a multiple of 31
+		bool zlib_header = data.size() >= 2 && (static_cast<unsigned char>(data[0]) & 0x0f) == 8 &&
+			((static_cast<unsigned char>(data[0]) << 8) | static_cast<unsigned char>(data[1])) % 31 == 0;
+		if (zlib_header && (static_cast<unsigned char>(data[1]) & 0x20) != 0) {
+			// Preset dictionaries are never used by pdf writers
+			return false;
+		}
+
+		out.clear();
+		try {
+			Inflater inflater(zlib_header ? data.substr(2) : data, out);
+			inflater.run();
+		} catch (const InflateError&) {
+			return false;
+		}
+		return true;
+	}
+
+	// Reverses the PNG predictors (/Predictor 10 to 15) of a decompressed stream in place
+	bool undo_png_predictor(std::string& data, const int colors, const int bits_per_component, const int columns)
+	{
+		if (colors < 1 || bits_per_component < 1 || columns < 1) { return false; }
+		size_t bytes_per_pixel = static_cast<size_t>(std::max(1, colors * bits_per_component / 8));
+		size_t row_length = (static_cast<size_t>(colors) * bits_per_component * columns + 7) / 8;
+		if (data.size() % (row_length + 1) != 0) { return false; }
+
+		std::string decoded;
+		decoded.reserve(data.size() / (row_length + 1) * row_length);
+		std::string previous(row_length, '\0');
+		for (size_t row = 0; row < data.size(); row += row_length + 1) {
+			int filter = static_cast<unsigned char>(data[row]);
+			const unsigned char* in = reinterpret_cast<const unsigned char*>(data.data() + row + 1);
+			std::string current(row_length, '\0');
+			for (size_t i = 0; i < row_length; ++i) {
+				int left = (i >= bytes_per_pixel) ? static_cast<unsigned char>(current[i - bytes_per_pixel]) : 0;
+				int up = static_cast<unsigned char>(previous[i]);
+				int up_left = (i >= bytes_per_pixel) ? static_cast<unsigned char>(previous[i - bytes_per_pixel]) : 0;
+				int predicted = 0;
+				switch (filter) {
+				case 0: predicted = 0; break;
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: {
+					int estimate = left + up - up_left;
+					int to_left = std::abs(estimate - left);
+					int to_up = std::abs(estimate - up);
+					int to_up_left = std::abs(estimate - up_left);
+					predicted = (to_left <= to_up && to_left <= to_up_left) ? left : (to_up <= to_up_left) ? up : up_left;
+					break;
+				}
+				default:
+					return false;
+				}
+				current[i] = static_cast<char>((in[i] + predicted) & 0xff);
+			}
+			decoded += current;
+			previous.swap(current);
+		}
+		data.swap(decoded);
+		return true;
+	}
+}
@@ -0,0 +1,560 @@
+#include "pdf_fonts.h"
+
+namespace pdf
+{
+	namespace
+	{
+		// Widths of the standard fonts for WinAnsi codes 32 to 255, from Adobe's font metrics
+		const uint16_t TIMES_ROMAN_WIDTHS[224] = {
+			250, 333, 408, 500, 500, 833, 778, 180, 333, 333, 500, 564, 250, 333, 250, 278,
+			500, 500, 500, 500, 500, 500, 500, 500, 500, 500, 278, 278, 564, 564, 564, 444,
+			921, 722, 667, 667, 722, 611, 556, 722, 722, 333, 389, 722, 611, 889, 722, 722,
+			556, 722, 667, 556, 611, 722, 722, 944, 722, 722, 611, 333, 278, 333, 469, 500,
+			333, 444, 500, 444, 500, 444, 333, 500, 500, 278, 278, 500, 278, 778, 500, 500,
+			500, 500, 333, 389, 278, 500, 500, 722, 500, 500, 444, 480, 200, 480, 541, 350,
+			500, 350, 333, 500, 444, 1000, 500, 500, 333, 1000, 556, 333, 889, 350, 611, 350,
+			350, 333, 333, 444, 444, 350, 500, 1000, 333, 980, 389, 333, 722, 350, 444, 722,
+			250, 333, 500, 500, 500, 500, 200, 500, 333, 760, 276, 500, 564, 333, 760, 333,
+			400, 564, 300, 300, 333, 500, 453, 250, 333, 300, 310, 500, 750, 750, 750, 444,
+			722, 722, 722, 722, 722, 722, 889, 667, 611, 611, 611, 611, 333, 333, 333, 333,
+			722, 722, 722, 722, 722, 722, 722, 564, 722, 722, 722, 722, 722, 722, 556, 500,
+			444, 444, 444, 444, 444, 444, 667, 444, 444, 444, 444, 444, 278, 278, 278, 278,
+			500, 500, 500, 500, 500, 500, 500, 564, 500, 500, 500, 500, 500, 500, 500, 500 };
+		const uint16_t TIMES_BOLD_WIDTHS[224] = {
+			250, 333, 555, 500, 500, 1000, 833, 278, 333, 333, 500, 570, 250, 333, 250, 278,
+			500, 500, 500, 500, 500, 500, 500, 500, 500, 500, 333, 333, 570, 570, 570, 500,
+			930, 722, 667, 722, 722, 667, 611, 778, 778, 389, 500, 778, 667, 944, 722, 778,
+			611, 778, 722, 556, 667, 722, 722, 1000, 722, 722, 667, 333, 278, 333, 581, 500,
+			333, 500, 556, 444, 556, 444, 333, 500, 556, 278, 333, 556, 278, 833, 556, 500,
+			556, 556, 444, 389, 333, 556, 500, 722, 500, 500, 444, 394, 220, 394, 520, 350,
+			500, 350, 333, 500, 500, 1000, 500, 500, 333, 1000, 556, 333, 1000, 350, 667, 350,
+			350, 333, 333, 500, 500, 350, 500, 1000, 333, 1000, 389, 333, 722, 350, 444, 722,
+			250, 333, 500, 500, 500, 500, 220, 500, 333, 747, 300, 500, 570, 333, 747, 333,
+			400, 570, 300, 300, 333, 556, 540, 250, 333, 300, 330, 500, 750, 750, 750, 500,
+			722, 722, 722, 722, 722, 722, 1000, 722, 667, 667, 667, 667, 389, 389, 389, 389,
+			722, 722, 778, 778, 778, 778, 778, 570, 778, 722, 722, 722, 722, 722, 611, 556,
+			500, 500, 500, 500, 500, 500, 722, 444, 444, 444, 444, 444, 278, 278, 278, 278,
+			500, 556, 500, 500, 500, 500, 500, 570, 500, 556, 556, 556, 556, 500, 556, 500 };
+		const uint16_t TIMES_ITALIC_WIDTHS[224] = {
+			250, 333, 420, 500, 500, 833, 778, 214, 333, 333, 500, 675, 250, 333, 250, 278,
+			500, 500, 500, 500, 500, 500, 500, 500, 500, 500, 333, 333, 675, 675, 675, 500,
+			920, 611, 611, 667, 722, 611, 611, 722, 722, 333, 444, 667, 556, 833, 667, 722,
+			611, 722, 611, 500, 556, 722, 611, 833, 611, 556, 556, 389, 278, 389, 422, 500,
+			333, 500, 500, 444, 500, 444, 278, 500, 500, 278, 278, 444, 278, 722, 500, 500,
+			500, 500, 389, 389, 278, 500, 444, 667, 444, 444, 389, 400, 275, 400, 541, 350,
+			500, 350, 333, 500, 556, 889, 500, 500, 333, 1000, 500, 333, 944, 350, 556, 350,
+			350, 333, 333, 556, 556, 350, 500, 889, 333, 980, 389, 333, 667, 350, 389, 556,
+			250, 389, 500, 500, 500, 500, 275, 500, 333, 760, 276, 500, 675, 333, 760, 333,
+			400, 675, 300, 300, 333, 500, 523, 250, 333, 300, 310, 500, 750, 750, 750, 500,
+			611, 611, 611, 611, 611, 611, 889, 667, 611, 611, 611, 611, 333, 333, 333, 333,
+			722, 667, 722, 722, 722, 722, 722, 675, 722, 722, 722, 722, 722, 556, 611, 500,
+			500, 500, 500, 500, 500, 500, 667, 444, 444, 444, 444, 444, 278, 278, 278, 278,
+			500, 500, 500, 500, 500, 500, 500, 675, 500, 500, 500, 500, 500, 444, 500, 444 };
+		const uint16_t HELVETICA_WIDTHS[224] = {
+			278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333, 278, 278,
+			556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278, 584, 584, 584, 556,
+			1015, 667, 667, 722, 722, 667, 611, 778, 722, 278, 500, 667, 556, 833, 722, 778,
+			667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 278, 278, 278, 469, 556,
+			333, 556, 556, 500, 556, 556, 278, 556, 556, 222, 222, 500, 222, 833, 556, 556,
+			556, 556, 333, 500, 278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584, 350,
+			556, 350, 222, 556, 333, 1000, 556, 556, 333, 1000, 667, 333, 1000, 350, 611, 350,
+			350, 222, 222, 333, 333, 350, 556, 1000, 333, 1000, 500, 333, 944, 350, 500, 667,
+			278, 333, 556, 556, 556, 556, 260, 556, 333, 737, 370, 556, 584, 333, 737, 333,
+			400, 584, 333, 333, 333, 556, 537, 278, 333, 333, 365, 556, 834, 834, 834, 611,
+			667, 667, 667, 667, 667, 667, 1000, 722, 667, 667, 667, 667, 278, 278, 278, 278,
+			722, 722, 778, 778, 778, 778, 778, 584, 778, 722, 722, 722, 722, 667, 667, 611,
+			556, 556, 556, 556, 556, 556, 889, 500, 556, 556, 556, 556, 278, 278, 278, 278,
+			556, 556, 556, 556, 556, 556, 556, 584, 611, 556, 556, 556, 556, 500, 556, 500 };
+		const uint16_t HELVETICA_BOLD_WIDTHS[224] = {
+			278, 333, 474, 556, 556, 889, 722, 238, 333, 333, 389, 584, 278, 333, 278, 278,
+			556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 333, 333, 584, 584, 584, 611,
+			975, 722, 722, 722, 722, 667, 611, 778, 722, 278, 556, 722, 611, 833, 722, 778,
+			667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 333, 278, 333, 584, 556,
+			333, 556, 611, 556, 611, 556, 333, 611, 611, 278, 278, 556, 278, 889, 611, 611,
+			611, 611, 389, 556, 333, 611, 556, 778, 556, 556, 500, 389, 280, 389, 584, 350,
+			556, 350, 278, 556, 500, 1000, 556, 556, 333, 1000, 667, 333, 1000, 350, 611, 350,
+			350, 278, 278, 500, 500, 350, 556, 1000, 333, 1000, 556, 333, 944, 350, 500, 667,
+			278, 333, 556, 556, 556, 556, 280, 556, 333, 737, 370, 556, 584, 333, 737, 333,
+			400, 584, 333, 333, 333, 611, 556, 278, 333, 333, 365, 556, 834, 834, 834, 611,
+			722, 722, 722, 722, 722, 722, 1000, 722, 667, 667, 667, 667, 278, 278, 278, 278,
+			722, 722, 778, 778, 778, 778, 778, 584, 778, 722, 722, 722, 722, 667, 667, 611,
+			556, 556, 556, 556, 556, 556, 889, 556, 556, 556, 556, 556, 278, 278, 278, 278,
+			611, 611, 611, 611, 611, 611, 611, 584, 611, 611, 611, 611, 611, 556, 611, 556 };
+		const uint16_t HELVETICA_OBLIQUE_WIDTHS[224] = {
+			278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333, 278, 278,
+			556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278, 584, 584, 584, 556,
+			1015, 667, 667, 722, 722, 667, 611, 778, 722, 278, 500, 667, 556, 833, 722, 778,
+			667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 278, 278, 278, 469, 556,
+			333, 556, 556, 500, 556, 556, 278, 556, 556, 222, 222, 500, 222, 833, 556, 556,
+			556, 556, 333, 500, 278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584, 350,
+			556, 350, 222, 556, 333, 1000, 556, 556, 333, 1000, 667, 333, 1000, 350, 611, 350,
+			350, 222, 222, 333, 333, 350, 556, 1000, 333, 1000, 500, 333, 944, 350, 500, 667,
+			278, 333, 556, 556, 556, 556, 260, 556, 333, 737, 370, 556, 584, 333, 737, 333,
+			400, 584, 333, 333, 333, 556, 537, 278, 333, 333, 365, 556, 834, 834, 834, 611,
+			667, 667, 667, 667, 667, 667, 1000, 722, 667, 667, 667, 667, 278, 278, 278, 278,
+			722, 722, 778, 778, 778, 778, 778, 584, 778, 722, 722, 722, 722, 667, 667, 611,
+			556, 556, 556, 556, 556, 556, 889, 500, 556, 556, 556, 556, 278, 278, 278, 278,
+			556, 556, 556, 556, 556, 556, 556, 584, 611, 556, 556, 556, 556, 500, 556, 500 };
+		const uint16_t WIN_ANSI_80_9F[32] = {
+			0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+			0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178 };
+
+		// Big-endian reads of the TrueType tables, out of range reads mean a damaged font
+		uint16_t read_u16(std::string_view data, const size_t pos)
+		{
+			if (pos + 2 > data.size()) { throw PdfError("Truncated TrueType font"); }
+			return static_cast<uint16_t>((static_cast<unsigned char>(data[pos]) << 8) | static_cast<unsigned char>(data[pos + 1]));
+		}
+
+		int16_t read_i16(std::string_view data, const size_t pos)
+		{
+			return static_cast<int16_t>(read_u16(data, pos));
+		}
+
+		uint32_t read_u32(std::string_view data, const size_t pos)
+		{
+			return (static_cast<uint32_t>(read_u16(data, pos)) << 16) | read_u16(data, pos + 2);
+		}
+
+		void write_u16(std::string& out, const uint16_t value)
+		{
+			out += static_cast<char>(value >> 8);
+			out += static_cast<char>(value & 0xff);
+		}
+
+		void write_u32(std::string& out, const uint32_t value)
+		{
+			write_u16(out, static_cast<uint16_t>(value >> 16));
+			write_u16(out, static_cast<uint16_t>(value & 0xffff));
+		}
+
+		void set_u32(std::string& out, const size_t pos, const uint32_t value)
+		{
+			for (int i = 0; i < 4; ++i) { out[pos + i] = static_cast<char>((value >> (24 - 8 * i)) & 0xff); }
+		}
+
+		// Sum of the big-endian words of a table, zero padded to a whole word
+		uint32_t checksum(std::string_view data)
+		{
+			uint32_t sum = 0;
+			for (size_t pos = 0; pos < data.size(); pos += 4) {
+				uint32_t word = 0;
+				for (size_t i = 0; i < 4; ++i) {
+					word = (word << 8) | ((pos + i < data.size()) ? static_cast<unsigned char>(data[pos + i]) : 0u);
+				}
+				sum += word;
+			}
+			return sum;
+		}
+
+		// Unicode code point of a WinAnsi character, 0 for the five codes it leaves undefined
+		uint32_t win_ansi_to_unicode(const unsigned char code)
+		{
+			if (code >= 0x80 && code < 0xa0) { return WIN_ANSI_80_9F[code - 0x80]; }
+			return code;
+		}
+
+		// Glyph of a code point in a format 4 or format 12 cmap subtable, 0 if it has none
+		uint16_t lookup_glyph(std::string_view cmap, const uint32_t code)
+		{
+			uint16_t format = read_u16(cmap, 0);
+			if (format == 4) {
+				if (code > 0xffff) { return 0; }
+				size_t segments = read_u16(cmap, 6) / 2;
+				size_t ends = 14;
+				size_t starts = ends + segments * 2 + 2;
+				size_t deltas = starts + segments * 2;
+				size_t range_offsets = deltas + segments * 2;
+				for (size_t i = 0; i < segments; ++i) {
+					if (read_u16(cmap, ends + i * 2) < code) { continue; }
+					uint16_t start = read_u16(cmap, starts + i * 2);
+					if (start > code) { return 0; }
+					uint16_t delta = read_u16(cmap, deltas + i * 2);
+					uint16_t range_offset = read_u16(cmap, range_offsets + i * 2);
+					if (range_offset == 0) { return static_cast<uint16_t>((code + delta) & 0xffff); }
+					uint16_t glyph = read_u16(cmap, range_offsets + i * 2 + range_offset + (code - start) * 2);
+					return (glyph == 0) ? 0 : static_cast<uint16_t>((glyph + delta) & 0xffff);
+				}
+			} else if (format == 12) {
+				uint32_t groups = read_u32(cmap, 12);
+				for (uint32_t i = 0; i < groups; ++i) {
+					size_t group = 16 + static_cast<size_t>(i) * 12;
+					uint32_t start = read_u32(cmap, group);
+					uint32_t end = read_u32(cmap, group + 4);
+					if (code >= start && code <= end) { return static_cast<uint16_t>(read_u32(cmap, group + 8) + (code - start)); }
+				}
+			}
+			return 0;
+		}
+	}
+
+	// Converts UTF-8 text to the single-byte WinAnsiEncoding every title page font is written in
+	std::string to_win_ansi(std::string_view text, uint32_t* unmapped)
+	{
+		auto lost = [&](const uint32_t code) {
+			if (unmapped != nullptr && *unmapped == 0) { *unmapped = code; }
+			return '?';
+		};
+		std::string encoded;
+		encoded.reserve(text.size());
+		size_t pos = 0;
+		while (pos < text.size()) {
+			unsigned char lead = static_cast<unsigned char>(text[pos]);
+			uint32_t code = lead;
+			size_t length = 1;
+			if (lead >= 0xc2 && lead <= 0xf4) {
+				length = (lead >= 0xf0) ? 4 : (lead >= 0xe0) ? 3 : 2;
+				code = lead & (0x3f >> (length - 1));
+				for (size_t i = 1; i < length; ++i) {
+					if (pos + i >= text.size() || (static_cast<unsigned char>(text[pos + i]) & 0xc0) != 0x80) {
+						// Not UTF-8 after all, the byte stands for itself
+						code = lead;
+						length = 1;
+						break;
+					}
+					code = (code << 6) | (static_cast<unsigned char>(text[pos + i]) & 0x3f);
+				}
+			}
+			pos += length;
+
+			if (length == 1) {
+				// A lone byte is already a Windows-1252 character
+				encoded += (lead >= 0x80 && lead < 0xa0 && WIN_ANSI_80_9F[lead - 0x80] == 0) ? lost(lead) : static_cast<char>(lead);
+				continue;
+			}
+			if (code >= 0xa0 && code <= 0xff) {
+				encoded += static_cast<char>(code);
+				continue;
+			}
+			char mapped = 0;
+			for (unsigned char i = 0; i < 32; ++i) {
+				if (WIN_ANSI_80_9F[i] == code) { mapped = static_cast<char>(0x80 + i); }
+			}
+			// Hyphens and spaces WinAnsi has no code for look the same as the ones it has
+			if (code == 0x2010 || code == 0x2011) { mapped = '-'; }
+			if (code >= 0x2000 && code <= 0x200a) { mapped = ' '; }
+			encoded += (mapped != 0) ? mapped : lost(code);
+		}
+		return encoded;
+	}
+
+	// Throws PdfError if the file is not a TrueType font or its license does not permit embedding
+	Font Font::load_truetype(const std::string& path)
+	{
+		Font font;
+		font.m_embedded = true;
+		font.m_data = read_pdf(path);
+		std::string_view data = font.m_data;
+
+		uint32_t version = read_u32(data, 0);
+		if (version != 0x00010000 && version != 0x74727565) {
+			// CFF outlines (OTTO) and font collections (ttcf) are embedded differently
+			throw PdfError("Not a TrueType font: " + path);
+		}
+		uint16_t num_tables = read_u16(data, 4);
+		for (uint16_t i = 0; i < num_tables; ++i) {
+			size_t entry = 12 + static_cast<size_t>(i) * 16;
+			uint32_t offset = read_u32(data, entry + 8);
+			uint32_t length = read_u32(data, entry + 12);
+			if (static_cast<size_t>(offset) + length > data.size()) { throw PdfError("Truncated TrueType font: " + path); }
+			font.m_tables[std::string(data.substr(entry, 4))] = { offset, length };
+		}
+
+		std::string_view head = font.table("head");
+		std::string_view hhea = font.table("hhea");
+		std::string_view maxp = font.table("maxp");
+		std::string_view hmtx = font.table("hmtx");
+		std::string_view loca = font.table("loca");
+		font.table("glyf");
+
+		font.m_units_per_em = read_u16(head, 18);
+		if (font.m_units_per_em == 0) { throw PdfError("Invalid TrueType font: " + path); }
+		auto scale = [&](const int value) {
+			return static_cast<int>(std::lround(value * 1000.0 / font.m_units_per_em));
+		};
+		for (int i = 0; i < 4; ++i) { font.m_bbox[i] = scale(read_i16(head, 36 + i * 2)); }
+		font.m_ascent = scale(read_i16(hhea, 4));
+		font.m_descent = scale(read_i16(hhea, 6));
+		font.m_cap_height = font.m_ascent;
+
+		uint16_t num_glyphs = read_u16(maxp, 4);
+		bool long_offsets = read_i16(head, 50) != 0;
+		font.m_loca.resize(static_cast<size_t>(num_glyphs) + 1);
+		for (size_t gid = 0; gid <= num_glyphs; ++gid) {
+			font.m_loca[gid] = long_offsets ? read_u32(loca, gid * 4) : static_cast<uint32_t>(read_u16(loca, gid * 2)) * 2;
+		}
+
+		if (font.m_tables.count("OS/2") != 0) {
+			std::string_view os2 = font.table("OS/2");
+			// Restricted license embedding, or only bitmaps may be embedded
+			uint16_t embedding = read_u16(os2, 8);
+			if ((embedding & 0x000f) == 0x0002 || (embedding & 0x0200) != 0) {
+				throw PdfError("The license of " + path + " does not permit embedding");
+			}
+			int weight = read_u16(os2, 4);
+			font.m_stem_v = 10 + 220 * std::max(0, weight - 50) / 900;
+			// Family classes 1 to 7 are serif styles
+			int family_class = read_u16(os2, 30) >> 8;
+			if (family_class >= 1 && family_class <= 7) { font.m_flags |= 2; }
+			if (read_u16(os2, 0) >= 2) { font.m_cap_height = scale(read_i16(os2, 88)); }
+		}
+		if (font.m_tables.count("post") != 0) {
+			font.m_italic_angle = static_cast<int32_t>(read_u32(font.table("post"), 4)) / 65536.0;
+		}
+		if (font.m_italic_angle != 0 || (read_u16(head, 44) & 0x0002) != 0) { font.m_flags |= 64; }
+
+		// Windows Unicode subtables map the WinAnsi characters to glyphs
+		std::string_view cmap = font.table("cmap");
+		std::string_view unicode_cmap;
+		int best = 0;
+		uint16_t num_cmaps = read_u16(cmap, 2);
+		for (uint16_t i = 0; i < num_cmaps; ++i) {
+			size_t record = 4 + static_cast<size_t>(i) * 8;
+			uint16_t platform = read_u16(cmap, record);
+			uint16_t encoding = read_u16(cmap, record + 2);
+			int rank = (platform == 3 && encoding == 10) ? 3 : (platform == 3 && encoding == 1) ? 2 : (platform == 0) ? 1 : 0;
+			uint32_t offset = read_u32(cmap, record + 4);
+			if (rank > best && offset < cmap.size()) {
+				uint16_t format = read_u16(cmap, offset);
+				if (format == 4 || format == 12) {
+					best = rank;
+					unicode_cmap = cmap.substr(offset);
+				}
+			}
+		}
+		if (best == 0) { throw PdfError("No Unicode character map in " + path); }
+
+		uint16_t num_metrics = read_u16(hhea, 34);
+		if (num_metrics == 0) { throw PdfError("Invalid TrueType font: " + path); }
+		for (int code = 0; code < 256; ++code) {
+			uint32_t unicode = win_ansi_to_unicode(static_cast<unsigned char>(code));
+			uint16_t gid = (unicode == 0) ? 0 : lookup_glyph(unicode_cmap, unicode);
+			if (gid >= num_glyphs) { gid = 0; }
+			font.m_glyphs[code] = gid;
+			// Glyphs past the last metric share its advance width
+			font.m_widths[code] = scale(read_u16(hmtx, static_cast<size_t>(std::min(gid, static_cast<uint16_t>(num_metrics - 1))) * 4));
+		}
+
+		// The PostScript name from the name table, the file name if it has none
+		font.m_name = fs::path(path).stem().string();
+		if (font.m_tables.count("name") != 0) {
+			std::string_view names = font.table("name");
+			uint16_t count = read_u16(names, 2);
+			size_t strings = read_u16(names, 4);
+			for (uint16_t i = 0; i < count; ++i) {
+				size_t record = 6 + static_cast<size_t>(i) * 12;
+				uint16_t platform = read_u16(names, record);
+				if (read_u16(names, record + 6) != 6 || (platform != 1 && platform != 3)) { continue; }
+				uint16_t length = read_u16(names, record + 8);
+				size_t offset = strings + read_u16(names, record + 10);
+				if (offset + length > names.size()) { continue; }
+				std::string name;
+				// Windows names are UTF-16, PostScript names are plain ASCII either way
+				for (size_t pos = (platform == 3) ? 1 : 0; pos < length; pos += (platform == 3) ? 2 : 1) {
+					char c = names[offset + pos];
+					if (c > 32 && c < 127 && c != '/' && c != '(' && c != ')' && c != '[' && c != ']' && c != '<' && c != '>' && c != '%') { name += c; }
+				}
+				if (!name.empty()) {
+					font.m_name = name;
+					break;
+				}
+			}
+		}
+		return font;
+	}
+
+	Font Font::standard(const StandardFont standard_font)
+	{
+		static const std::array<std::pair<const char*, const uint16_t*>, 6> fonts{ {
+			{ "Times-Roman", TIMES_ROMAN_WIDTHS },
+			{ "Times-Bold", TIMES_BOLD_WIDTHS },
+			{ "Times-Italic", TIMES_ITALIC_WIDTHS },
+			{ "Helvetica", HELVETICA_WIDTHS },
+			{ "Helvetica-Bold", HELVETICA_BOLD_WIDTHS },
+			{ "Helvetica-Oblique", HELVETICA_OBLIQUE_WIDTHS }
+		} };
+		const auto& entry = fonts[static_cast<size_t>(standard_font)];
+
+		Font font;
+		font.m_name = entry.first;
+		for (int code = 32; code < 256; ++code) { font.m_widths[code] = entry.second[code - 32]; }
+		return font;
+	}
+
+	// Advance width of a character in thousandths of the font size
+	int Font::get_width(const unsigned char code) const
+	{
+		return m_widths[code];
+	}
+
+	// Width of WinAnsi text set at the given size, in points
+	double Font::measure(std::string_view text, const double size) const
+	{
+		long long total = 0;
+		for (char c : text) { total += m_widths[static_cast<unsigned char>(c)]; }
+		return total * size / 1000.0;
+	}
+
+	const std::string& Font::get_name() const
+	{
+		return m_name;
+	}
+
+	std::string_view Font::table(const char* tag) const
+	{
+		auto found = m_tables.find(tag);
+		if (found == m_tables.end()) { throw PdfError(std::string("TrueType font without a ") + tag + " table: " + m_name); }
+		return std::string_view(m_data).substr(found->second.first, found->second.second);
+	}
+
+	// A copy of the font in which every glyph the characters do not need is left empty
+	// Glyph ids stay the same, so the character map and the metrics are kept as they are
+	std::string Font::subset(const std::array<bool, 256>& used) const
+	{
+		std::string_view glyf = table("glyf");
+		size_t num_glyphs = m_loca.size() - 1;
+		std::vector<bool> keep(num_glyphs, false);
+		std::vector<uint16_t> pending{ 0 };
+		for (int code = 0; code < 256; ++code) {
+			if (used[code]) { pending.push_back(m_glyphs[code]); }
+		}
+		while (!pending.empty()) {
+			uint16_t gid = pending.back();
+			pending.pop_back();
+			if (keep[gid]) { continue; }
+			keep[gid] = true;
+			if (m_loca[gid] >= m_loca[gid + 1] || m_loca[gid + 1] > glyf.size()) { continue; }
+			std::string_view glyph = glyf.substr(m_loca[gid], m_loca[gid + 1] - m_loca[gid]);
+			if (glyph.size() < 10 || read_i16(glyph, 0) >= 0) { continue; }
+
+			// Composite glyphs are drawn from other glyphs, which have to come along
+			size_t pos = 10;
+			uint16_t flags = 0;
+			do {
+				flags = read_u16(glyph, pos);
+				uint16_t component = read_u16(glyph, pos + 2);
+				if (component < num_glyphs) { pending.push_back(component); }
+				pos += 4 + ((flags & 0x0001) ? 4 : 2);
+				if (flags & 0x0008) { pos += 2; }
+				else if (flags & 0x0040) { pos += 4; }
+				else if (flags & 0x0080) { pos += 8; }
+			} while (flags & 0x0020);
+		}
+
+		std::string new_glyf;
+		std::string new_loca;
+		for (size_t gid = 0; gid < num_glyphs; ++gid) {
+			write_u32(new_loca, static_cast<uint32_t>(new_glyf.size()));
+			if (keep[gid] && m_loca[gid] < m_loca[gid + 1] && m_loca[gid + 1] <= glyf.size()) {
+				new_glyf.append(glyf.substr(m_loca[gid], m_loca[gid + 1] - m_loca[gid]));
+				while (new_glyf.size() % 4 != 0) { new_glyf += '\0'; }
+			}
+		}
+		write_u32(new_loca, static_cast<uint32_t>(new_glyf.size()));
+
+		// The tables a pdf viewer needs to draw the glyphs, in the tag order of the directory
+		std::map<std::string, std::string> tables;
+		for (const char* tag : { "cmap", "cvt ", "fpgm", "hhea", "hmtx", "maxp", "prep" }) {
+			if (m_tables.count(tag) != 0) { tables[tag] = std::string(table(tag)); }
+		}
+		tables["glyf"] = std::move(new_glyf);
+		tables["loca"] = std::move(new_loca);
+		std::string head(table("head"));
+		// The checksum adjustment is filled in once the whole font is known, offsets are all 32-bit now
+		set_u32(head, 8, 0);
+		head[50] = 0;
+		head[51] = 1;
+		tables["head"] = head;
+
+		uint16_t num_tables = static_cast<uint16_t>(tables.size());
+		uint16_t entry_selector = 0;
+		while ((2u << entry_selector) <= num_tables) { ++entry_selector; }
+		uint16_t search_range = static_cast<uint16_t>((1u << entry_selector) * 16);
+
+		std::string font;
+		write_u32(font, 0x00010000);
+		write_u16(font, num_tables);
+		write_u16(font, search_range);
+		write_u16(font, entry_selector);
+		write_u16(font, static_cast<uint16_t>(num_tables * 16 - search_range));
+		size_t offset = 12 + static_cast<size_t>(num_tables) * 16;
+		size_t head_offset = 0;
+		for (const auto& [tag, contents] : tables) {
+			font += tag;
+			write_u32(font, checksum(contents));
+			write_u32(font, static_cast<uint32_t>(offset));
+			write_u32(font, static_cast<uint32_t>(contents.size()));
+			if (tag == "head") { head_offset = offset; }
+			offset += (contents.size() + 3) / 4 * 4;
+		}
+		for (const auto& [tag, contents] : tables) {
+			font += contents;
+			while (font.size() % 4 != 0) { font += '\0'; }
+		}
+		set_u32(font, head_offset + 8, 0xB1B0AFBAu - checksum(font));
+		return font;
+	}
+
+	// Writes the font dictionary and what it refers to, returns a reference to the dictionary
+	PdfObject Font::write(PdfBuilder& builder, const std::array<bool, 256>& used) const
+	{
+		int font_num = builder.allocate();
+		PdfObject font = PdfObject::make_dictionary();
+		font.set("/Type", PdfObject::make_name("/Font"));
+		font.set("/Encoding", PdfObject::make_name("/WinAnsiEncoding"));
+		if (!m_embedded) {
+			font.set("/Subtype", PdfObject::make_name("/Type1"));
+			font.set("/BaseFont", PdfObject::make_name("/" + m_name));
+			builder.write(font_num, font);
+			return PdfObject::make_reference(font_num);
+		}
+
+		// Subsets are tagged after the characters they hold so the same page always gets the same name
+		uint64_t hash = 14695981039346656037ull;
+		for (int code = 0; code < 256; ++code) {
+			hash = (hash ^ (used[code] ? 1u : 0u)) * 1099511628211ull;
+		}
+		std::string tag;
+		for (int i = 0; i < 6; ++i) {
+			tag += static_cast<char>('A' + hash % 26);
+			hash /= 26;
+		}
+		std::string base_font = "/" + tag + "+" + m_name;
+
+		std::string font_file = subset(used);
+		int file_num = builder.allocate();
+		PdfObject file = PdfObject::make_dictionary();
+		file.kind = PdfObject::Kind::Stream;
+		file.set("/Length", PdfObject::make_number(static_cast<long long>(font_file.size())));
+		file.set("/Length1", PdfObject::make_number(static_cast<long long>(font_file.size())));
+		file.stream = font_file;
+		builder.write(file_num, file);
+
+		int descriptor_num = builder.allocate();
+		PdfObject descriptor = PdfObject::make_dictionary();
+		descriptor.set("/Type", PdfObject::make_name("/FontDescriptor"));
+		descriptor.set("/FontName", PdfObject::make_name(base_font));
+		descriptor.set("/Flags", PdfObject::make_number(m_flags));
+		PdfObject bbox = PdfObject::make_array();
+		for (int value : m_bbox) { bbox.items.push_back(PdfObject::make_number(value)); }
+		descriptor.set("/FontBBox", std::move(bbox));
+		descriptor.set("/ItalicAngle", PdfObject::make_real(m_italic_angle));
+		descriptor.set("/Ascent", PdfObject::make_number(m_ascent));
+		descriptor.set("/Descent", PdfObject::make_number(m_descent));
+		descriptor.set("/CapHeight", PdfObject::make_number(m_cap_height));
+		descriptor.set("/StemV", PdfObject::make_number(m_stem_v));
+		descriptor.set("/FontFile2", PdfObject::make_reference(file_num));
+		builder.write(descriptor_num, descriptor);
+
+		font.set("/Subtype", PdfObject::make_name("/TrueType"));
+		font.set("/BaseFont", PdfObject::make_name(base_font));
+		font.set("/FirstChar", PdfObject::make_number(32));
+		font.set("/LastChar", PdfObject::make_number(255));
+		PdfObject widths = PdfObject::make_array();
+		for (int code = 32; code < 256; ++code) { widths.items.push_back(PdfObject::make_number(m_widths[code])); }
+		font.set("/Widths", std::move(widths));
+		font.set("/FontDescriptor", PdfObject::make_reference(descriptor_num));
+		builder.write(font_num, font);
+		return PdfObject::make_reference(font_num);
+	}
+}
@@ -0,0 +1,156 @@
+#include "pdf_splice.h"
+
+namespace pdf
+{
+	// Copies objects of one document into the builder under new numbers, following references
+	// References to kept pages point at their new page objects, any other part of the old
+	// page tree becomes null so removed pages never come along through links or annotations
+	class ObjectCopier
+	{
+	public:
+		ObjectCopier(PdfDocument& doc, PdfBuilder& builder, std::unordered_map<int, int> pages)
+			: m_doc(doc), m_builder(builder), m_pages(std::move(pages)) {}
+
+		PdfObject copy(const PdfObject& obj)
+		{
+			switch (obj.kind) {
+			case PdfObject::Kind::Reference:
+				return copy_reference(obj);
+			case PdfObject::Kind::Array:
+			case PdfObject::Kind::Dictionary:
+			case PdfObject::Kind::Stream: {
+				PdfObject copied = obj;
+				copied.keys.clear();
+				copied.items.clear();
+				for (size_t i = 0; i < obj.items.size(); ++i) {
+					// The length of a copied stream is written directly
+					if (obj.kind == PdfObject::Kind::Stream && obj.keys[i] == "/Length") continue;
+					if (obj.kind != PdfObject::Kind::Array) { copied.keys.push_back(obj.keys[i]); }
+					copied.items.push_back(copy(obj.items[i]));
+				}
+				if (obj.kind == PdfObject::Kind::Stream) {
+					copied.set("/Length", PdfObject::make_number(static_cast<long long>(obj.stream.size())));
+				}
+				return copied;
+			}
+			default:
+				return obj;
+			}
+		}
+
+		// Writes every object reached so far, returns false if there was nothing left to write
+		bool flush()
+		{
+			if (m_pending.empty()) { return false; }
+			while (!m_pending.empty()) {
+				std::pair<int, int> pending = m_pending.back();
+				m_pending.pop_back();
+				m_builder.write(pending.second, copy(m_doc.get_object(pending.first)));
+			}
+			return true;
+		}
+	private:
+		PdfObject copy_reference(const PdfObject& ref)
+		{
+			auto page = m_pages.find(ref.num);
+			if (page != m_pages.end()) { return PdfObject::make_reference(page->second); }
+			if (m_doc.get_page_tree().count(ref.num) != 0) { return PdfObject(); }
+
+			auto mapped = m_mapped.find(ref.num);
+			if (mapped != m_mapped.end()) { return PdfObject::make_reference(mapped->second); }
+
+			// References to free or missing objects are null by definition
+			if (m_doc.get_object(ref.num).kind == PdfObject::Kind::Null) { return PdfObject(); }
+
+			int num = m_builder.allocate();
+			m_mapped.emplace(ref.num, num);
+			m_pending.emplace_back(ref.num, num);
+			return PdfObject::make_reference(num);
+		}
+
+		PdfDocument& m_doc;
+		PdfBuilder& m_builder;
+		std::unordered_map<int, int> m_pages;
+		std::unordered_map<int, int> m_mapped;
+		std::vector<std::pair<int, int>> m_pending;
+	};
+
+	// Builds a pdf from every page of the title page followed by the pages of the paper from first_page on
+	std::string splice_title_page(PdfDocument& title, PdfDocument& paper, const int first_page)
+	{
+		const std::vector<PdfDocument::Page>& title_pages = title.get_pages();
+		const std::vector<PdfDocument::Page>& paper_pages = paper.get_pages();
+		if (title_pages.empty()) { throw PdfError("The title page pdf has no pages"); }
+		size_t first_kept = static_cast<size_t>(std::max(first_page, 1) - 1);
+		if (first_kept >= paper_pages.size()) {
+			throw PdfError("The paper has " + std::to_string(paper_pages.size()) + " pages, none left from page " + std::to_string(first_page));
+		}
+
+		PdfBuilder builder(std::max(title.get_version(), paper.get_version()));
+		int catalog_num = builder.allocate();
+		int pages_num = builder.allocate();
+
+		// Pages are numbered up front so links between them can be resolved while copying
+		std::unordered_map<int, int> title_numbers;
+		std::unordered_map<int, int> paper_numbers;
+		PdfObject kids = PdfObject::make_array();
+		for (const auto& page : title_pages) {
+			int num = builder.allocate();
+			title_numbers.emplace(page.num, num);
+			kids.items.push_back(PdfObject::make_reference(num));
+		}
+		for (size_t i = first_kept; i < paper_pages.size(); ++i) {
+			int num = builder.allocate();
+			paper_numbers.emplace(paper_pages[i].num, num);
+			kids.items.push_back(PdfObject::make_reference(num));
+		}
+
+		ObjectCopier title_copier(title, builder, title_numbers);
+		ObjectCopier paper_copier(paper, builder, paper_numbers);
+
+		auto write_page = [&](ObjectCopier& copier, const PdfDocument::Page& page, const int num) {
+			PdfObject dict = copier.copy(page.dict);
+			dict.set("/Parent", PdfObject::make_reference(pages_num));
+			builder.write(num, dict);
+		};
+		for (const auto& page : title_pages) {
+			write_page(title_copier, page, title_numbers.at(page.num));
+		}
+		for (size_t i = first_kept; i < paper_pages.size(); ++i) {
+			write_page(paper_copier, paper_pages[i], paper_numbers.at(paper_pages[i].num));
+		}
+
+		// A single flat page tree, every page already carries its inherited attributes
+		PdfObject pages = PdfObject::make_dictionary();
+		pages.set("/Type", PdfObject::make_name("/Pages"));
+		pages.set("/Count", PdfObject::make_number(static_cast<long long>(kids.items.size())));
+		pages.set("/Kids", std::move(kids));
+		builder.write(pages_num, pages);
+
+		// Only document-wide settings that do not refer to pages carry over from the paper
+		const PdfObject& paper_catalog = paper.resolve(*paper.get_trailer().get("/Root"));
+		PdfObject catalog = PdfObject::make_dictionary();
+		catalog.set("/Type", PdfObject::make_name("/Catalog"));
+		catalog.set("/Pages", PdfObject::make_reference(pages_num));
+		for (const char* key : { "/Metadata", "/ViewerPreferences", "/Lang" }) {
+			if (const PdfObject* value = paper_catalog.get(key)) { catalog.set(key, paper_copier.copy(*value)); }
+		}
+		builder.write(catalog_num, catalog);
+
+		PdfObject trailer = PdfObject::make_dictionary();
+		trailer.set("/Root", PdfObject::make_reference(catalog_num));
+		if (const PdfObject* info = paper.get_trailer().get("/Info")) {
+			PdfObject copied_info = paper_copier.copy(*info);
+			if (copied_info.kind == PdfObject::Kind::Reference) { trailer.set("/Info", copied_info); }
+		}
+		if (const PdfObject* id = paper.get_trailer().get("/ID")) {
+			trailer.set("/ID", paper_copier.copy(*id));
+		}
+
+		// Writing an object may reach more objects of either document
+		while (title_copier.flush() || paper_copier.flush()) {}
+
+		trailer.set("/Size", PdfObject::make_number(builder.get_size()));
+		return builder.finish(trailer);
+	}
+}
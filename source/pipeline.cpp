@@ -0,0 +1,384 @@
+#include "pipeline.h"
+#include "logging.h"
+#include "rdf_actions.h"
+#include "pdf_actions.h"
+#include "rdf_index.h"
+#include "trace.h"
+#include <ctime>
+
+namespace pipeline
+{
+    // Thread safe replacement for std::localtime, workers may stamp papers concurrently
+    static std::tm local_timestamp(const std::time_t time)
+    {
+        std::tm local_time{};
+#ifdef _WIN32
+        localtime_s(&local_time, &time);
+#else
+        localtime_r(&time, &local_time);
+#endif
+        return local_time;
+    }
+
+    IssueContext::IssueContext(
+        const IssueSettings& _settings,
+        process::ProcessRunner& _runner)
+        : settings(_settings), runner(_runner) {}
+
+    // Fills the plan of a single paper, paper_num and last_pub_page are only used when renumbering
+    // Returns false if the paper has no row in the catalog
+    bool plan_paper(
+        const IssueSettings& settings,
+        const sql_agent::PaperCatalog& catalog,
+        const file::PaperEntry& paper,
+        const int paper_num,
+        const std::string& last_pub_page,
+        PaperPlan& plan)
+    {
+        plan.entry = paper.entry;
+        plan.old_filename = paper.filename;
+        plan.paper_num = settings.renumber ? paper_num : -1;
+        plan.page_range = { "","" };
+
+        // Look up the prefetched row for the entry
+        const sql_agent::PaperRow* row = catalog.find_by_filename(plan.old_filename);
+        if (row == nullptr) {
+            logging::info() << "No rows found.";
+            return false;
+        }
+        plan.id = row->id;
+        logging::Context tag(plan.id, "plan");
+        plan.pub = rdf::get_acronym(plan.id, '-');
+        plan.title = row->title;
+        plan.abstract = row->abstract;
+        logging::info() << "Retrieved ID: " << plan.id;
+
+        std::string page_count = row->number_of_pages;
+        try {
+            if (settings.renumber) {
+                // Pages continue from the last paper published in the volume
+                plan.page_range[1] = std::to_string(std::stoi(last_pub_page) + std::stoi(page_count));
+            } else {
+                plan.page_range[1] = row->total_numpages;
+            }
+            if (plan.page_range[1] != "" && page_count != "") {
+                int first_page_num = std::stoi(plan.page_range[1]) - std::stoi(page_count) + 1;
+                plan.page_range[0] = std::to_string(first_page_num);
+            }
+        } catch (const std::exception& e) {
+            logging::error() << "Error (ID: " << plan.id << "): invalid page count '" << page_count << "': " << e.what();
+            return false;
+        }
+
+        // Formatting the new filename once, it is used to update both the DB and the filesystem
+        file::format_filename(paper.filename, paper.key, settings.volume, settings.issue, plan.paper_num, plan.new_filename);
+
+        // Every value written later is decided here, so a plan can be saved and applied as it is
+        plan_columns(settings, plan);
+        plan_rdf_fields(settings, plan);
+        plan.regen_html = settings.regen_html;
+        plan.native_pdf = settings.native_title_pages && pdf::find_title_layout(plan.pub) != nullptr;
+        return true;
+    }
+
+    // Computes the paper numbers, page ranges and new filenames of every paper up front
+    // as a prefix sum over NumberOfPages, papers without a database row are skipped
+    std::vector<PaperPlan> build_plan(
+        const IssueSettings& settings,
+        const sql_agent::PaperCatalog& catalog,
+        const std::vector<file::PaperEntry>& file_vec,
+        int paper_num,
+        std::string last_pub_page)
+    {
+        std::vector<PaperPlan> plans;
+        plans.reserve(file_vec.size());
+
+        for (const auto& paper : file_vec) {
+            logging::info() << "\nPlanning: " << paper.filename;
+            PaperPlan plan;
+            if (!plan_paper(settings, catalog, paper, paper_num, last_pub_page, plan)) {
+                logging::error() << "Retrieved empty ID string, moving to next file.";
+                continue;
+            }
+
+            if (settings.renumber) {
+                last_pub_page = plan.page_range[1];
+                paper_num += 1;
+            }
+            plans.push_back(std::move(plan));
+        }
+        return plans;
+    }
+
+    // Computes the new value of every tablepaper column of the paper
+    void plan_columns(const IssueSettings& settings, PaperPlan& plan)
+    {
+        const std::string& result_id = plan.id;
+        plan.columns.clear();
+        auto set = [&](const std::string& column, const std::string& value) { plan.columns.emplace_back(column, value); };
+
+        // Constructing new volume string
+        std::string new_vol_str = settings.year_str + settings.vol_str + "000" + settings.iss_str;
+        logging::info() << "New Volume Number (ID: " << result_id << "): " << new_vol_str;
+        // Queue UPDATE of Volume_Number for the given ID
+        set("Volume_Number", new_vol_str);
+
+        // Queue UPDATE of NumIssue for the given ID
+        logging::info() << "New Issue Number (ID: " << result_id << "): " << settings.iss_str;
+        set("NumIssue", settings.iss_str);
+
+        if (settings.renumber) {
+            // Queue UPDATE of TotalPaper for the given ID
+            std::string paper_num_str = std::to_string(plan.paper_num);
+            logging::info() << "New Paper Number (ID: " << result_id << "): " << paper_num_str;
+            set("TotalPaper", paper_num_str);
+        }
+
+        // Constructing new citiation string
+        std::string new_citationString = settings.year_str + ", Volume " + settings.vol_str + ", Issue " + settings.iss_str;
+        if (plan.page_range[0] != "" && plan.page_range[1] != "") {
+            if (settings.renumber) {
+                // Queue UPDATE of TotalNumpages for the given ID
+                set("TotalNumpages", plan.page_range[1]);
+            }
+            new_citationString += ", pages " + plan.page_range[0] + " - " + plan.page_range[1];
+        }
+        // Queue UPDATE of citationString for the given ID
+        logging::info() << "New Citation String (ID: " << result_id << "): " << new_citationString;
+        set("citationString", new_citationString);
+
+        std::string new_Published_PDF_File = "/Pubs/" + plan.pub + "/" + settings.year_str + "/Volume" + settings.vol_str + "/" + plan.new_filename;
+        logging::info() << "New Published PDF Filepath (ID: " << result_id << "): " << new_Published_PDF_File;
+        // Queue UPDATE of Published_PDF_File for the given ID
+        set("Published_PDF_File", new_Published_PDF_File);
+
+        // Build calendar stamp for new publish date
+        // Year_str is required for it to populate properly on the site
+        // Site will order by publish date, not page #
+        std::string new_Publish_Date = settings.year_str + settings.date_array[0]; // CHANGE THIS
+        // Get current time for the timestamp and convert to std::string format
+        std::time_t current_time = std::time(nullptr);
+        std::tm local_time = local_timestamp(current_time);
+        char pub_buffer[20];
+        std::strftime(pub_buffer, sizeof(pub_buffer), "%T", &local_time);
+        std::string time_str = std::string(pub_buffer);
+        new_Publish_Date += " " + time_str;
+        // Queue UPDATE of Publish_Date for the given ID
+        logging::info() << "New Published Date (ID: " << result_id << "): " << new_Publish_Date;
+        set("Publish_Date", new_Publish_Date);
+
+        // Build calendar stamp for new status date (today's date)
+        char status_buffer[25];
+        std::strftime(status_buffer, sizeof(status_buffer), "%F %T", &local_time);
+        std::string status_str = std::string(status_buffer);
+        // Queue UPDATE of Status_Date for the given ID
+        logging::info() << "New Status Date (ID: " << result_id << "): " << status_str;
+        set("Status_date", status_str);
+    }
+
+    // Computes the new value of every rdf line of the paper
+    void plan_rdf_fields(const IssueSettings& settings, PaperPlan& plan)
+    {
+        std::string new_url = "http://";
+        new_url += "www.accessecon.com/Pubs/";
+        new_url += plan.pub + "/" + settings.year_str + "/Volume" + settings.vol_str + "/" + plan.new_filename;
+        std::string new_creation_date = settings.year_str + settings.date_array[0]; // CHANGE THIS
+
+        plan.rdf_fields.clear();
+        if (plan.title != "") plan.rdf_fields.emplace_back("Title:", plan.title);
+        if (plan.abstract != "") plan.rdf_fields.emplace_back("Abstract:", plan.abstract);
+        plan.rdf_fields.emplace_back("Creation-Date:", new_creation_date);
+        plan.rdf_fields.emplace_back("File-URL:", new_url);
+        plan.rdf_fields.emplace_back("Pages:", plan.page_range[0] + " - " + plan.page_range[1]);
+        plan.rdf_fields.emplace_back("Year:", settings.year_str);
+        plan.rdf_fields.emplace_back("Volume:", settings.vol_str);
+        plan.rdf_fields.emplace_back("Issue:", settings.iss_str);
+    }
+
+    // True if plan_columns can write the column, plans naming any other column are rejected
+    bool is_plan_column(const std::string& column)
+    {
+        static const std::array<std::string_view, 8> columns = {
+            "Volume_Number", "NumIssue", "TotalPaper", "TotalNumpages",
+            "citationString", "Published_PDF_File", "Publish_Date", "Status_date"
+        };
+        return std::find(columns.begin(), columns.end(), column) != columns.end();
+    }
+
+    // True if plan_rdf_fields can write the rdf field, e.g. "Pages:"
+    bool is_plan_rdf_field(const std::string& field)
+    {
+        static const std::array<std::string_view, 8> fields = {
+            "Title:", "Abstract:", "Creation-Date:", "File-URL:", "Pages:", "Year:", "Volume:", "Issue:"
+        };
+        return std::find(fields.begin(), fields.end(), field) != fields.end();
+    }
+
+    // True if the journal has the step of the paper as completed
+    static bool step_done(const IssueContext& context, const PaperPlan& plan, const Step step)
+    {
+        if (context.journal == nullptr || !context.journal->is_done(plan.id, step)) { return false; }
+        logging::info() << "Skipping " << get_step_name(step) << " for ID: " << plan.id << ", already done";
+        return true;
+    }
+
+    static void step_completed(const IssueContext& context, const PaperPlan& plan, const Step step)
+    {
+        if (context.journal != nullptr) { context.journal->record(plan.id, step); }
+    }
+
+    // Renames the paper in the filesystem to its new filename
+    bool rename_paper(const IssueContext&, const PaperPlan& plan)
+    {
+        trace::Span span("rename", plan.id);
+        logging::Context tag(plan.id, "rename");
+        try {
+            file::rename_file(plan.entry, plan.new_filename);
+        } catch (const std::exception& e) {
+            logging::error() << "Error: " << e.what();
+            logging::error() << "Failed to update filename: " << plan.entry.path().string();
+            return false;
+        }
+        return true;
+    }
+
+    // Updates the fields in the paper's rdf
+    bool update_rdf(const IssueContext& context, const PaperPlan& plan)
+    {
+        const IssueSettings& settings = context.settings;
+        const std::string& result_id = plan.id;
+        trace::Span span("rdf", result_id);
+        logging::Context tag(result_id, "rdf");
+        try {
+            // Updates RDF, uses the ID to find associated rdf
+            // then finds line containing the given criteria with the given string
+            // Update rdf for each line that contains the planned fields, all in one pass
+            rdf::RdfPatch patch(result_id);
+            for (const auto& field : plan.rdf_fields) {
+                patch.set(field.first, field.second);
+            }
+
+            rdf::RdfPatch::Result result = patch.apply(settings.sync);
+            if (!result.written) {
+                logging::info() << "Rdf already up to date for ID: " << result_id;
+            }
+            if (!result.missing.empty()) {
+                for (const auto& criteria : result.missing) {
+                    logging::error() << "Error (ID: " << result_id << "): Line starting with '" << criteria << "' not found in file";
+                }
+                logging::error() << "Failed to update all rdf contents for ID: " << result_id;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logging::error() << "Error: " << e.what();
+            logging::error() << "Failed to update all rdf contents for ID: " << result_id;
+            return false;
+        }
+        return true;
+    }
+
+    // Collects what the pdf title page of a paper shows, the authors are read from its rdf
+    pdf::TitlePageFields title_fields(const IssueSettings& settings, const PaperPlan& plan)
+    {
+        pdf::TitlePageFields fields;
+        fields.id = plan.id;
+        fields.pub = plan.pub;
+        fields.title = plan.title;
+        fields.abstract = plan.abstract;
+        fields.volume = settings.volume;
+        fields.issue = settings.issue;
+        fields.year = settings.year_str;
+        fields.page_range = plan.page_range;
+        fields.published = settings.date_array[1] + " 30, " + settings.year_str;
+
+        std::ifstream rdf_file(rdf::get_rdf_path(plan.id), std::ios::binary);
+        if (rdf_file.is_open()) {
+            std::string content((std::istreambuf_iterator<char>(rdf_file)), std::istreambuf_iterator<char>());
+            rdf::RdfRecord record;
+            rdf::index_fields(content, record);
+            fields.authors = rdf::find_fields(record, "Author-Name:");
+        } else {
+            logging::error() << "Error (ID: " << plan.id << "): Unable to read the authors from " << rdf::get_rdf_path(plan.id);
+        }
+        return fields;
+    }
+
+    // Updates the html and pdf title pages, then replaces the title page of the published paper
+    bool update_title_pages(const IssueContext& context, const PaperPlan& plan)
+    {
+        const IssueSettings& settings = context.settings;
+        try {
+            // The fields are only needed when a title page is written from scratch
+            const pdf::HtmlTemplate* html_template = (plan.regen_html && context.html_templates != nullptr) ? context.html_templates->find(plan.pub) : nullptr;
+            const pdf::TitlePageRenderer* title_renderer = plan.native_pdf ? context.title_renderer : nullptr;
+            bool html_done = step_done(context, plan, Step::Html);
+            bool pdf_done = step_done(context, plan, Step::TitlePdf);
+            pdf::TitlePageFields fields;
+            if ((html_template != nullptr && !html_done) || (title_renderer != nullptr && !pdf_done)) {
+                fields = title_fields(settings, plan);
+            }
+
+            // Regenerates the stand-alone html title page from the template, or updates it in place (if it exists)
+            if (!html_done) {
+                trace::Span span("html", plan.id);
+                logging::Context tag(plan.id, "html");
+                if (html_template == nullptr || !pdf::regenerate_html(*html_template, fields, settings.sync)) {
+                    std::array<std::string, 2> date_array = settings.date_array;
+                    // The pdf title pages are converted from the html, so they are not touched while it is stale
+                    if (!pdf::update_html(plan.id, settings.volume, settings.issue, plan.page_range, date_array, settings.sync)) { return false; }
+                }
+                step_completed(context, plan, Step::Html);
+            }
+            // Overwrites existing stand-alone pdf title page, written directly unless there is no layout for it
+            if (!pdf_done) {
+                trace::Span span("title-pdf", plan.id);
+                logging::Context tag(plan.id, "title-pdf");
+                if (title_renderer == nullptr || !pdf::write_title_pdf(*title_renderer, fields, settings.sync)) {
+                    // Converts the updated html version
+                    if (!pdf::update_pdf(plan.id, context.runner, context.render_cache)) { return false; }
+                }
+                step_completed(context, plan, Step::TitlePdf);
+            }
+            // Swaps the current title page of the published paper for the one created during update_pdf()
+            // Doing it twice would drop the new title page, so it is never repeated once journaled
+            if (!step_done(context, plan, Step::Splice)) {
+                trace::Span span("pdf-splice", plan.id);
+                logging::Context tag(plan.id, "pdf-splice");
+                if (!pdf::replace_title_page(plan.entry, plan.id, plan.new_filename, settings.title_offset,
+                                             context.runner, settings.sync, context.render_cache)) {
+                    logging::error() << "Failed to replace the title page of the published PDF for ID: " << plan.id;
+                    return false;
+                }
+                step_completed(context, plan, Step::Splice);
+            }
+        } catch (const std::exception& e) {
+            logging::error() << "Error: " << e.what();
+            logging::error() << "Failed to update title page for ID: " << plan.id;
+            return false;
+        }
+        return true;
+    }
+
+    // Runs every stage after the database update for a paper, stopping at the first stage that fails
+    // Returns the last stage that completed, the database update counts as done
+    Stage process_files(IssueContext& context, const PaperPlan& plan)
+    {
+        trace::Span span("paper-files", plan.id);
+        /* UPDATING FILENAME FOR PUBLISHED PAPER */
+        if (!step_done(context, plan, Step::Rename)) {
+            if (!rename_paper(context, plan)) { return Stage::Database; }
+            step_completed(context, plan, Step::Rename);
+        }
+
+        /* UPDATING RDF CONTENTS FOR PUBLISHED PAPER */
+        if (!step_done(context, plan, Step::Rdf)) {
+            if (!update_rdf(context, plan)) { return Stage::Rename; }
+            step_completed(context, plan, Step::Rdf);
+        }
+
+        /* UPDATING HTML AND PDF TITLE PAGES FOR PUBLISHED PAPER */
+        if (!update_title_pages(context, plan)) { return Stage::Rdf; }
+
+        return Stage::TitlePages;
+    }
+}
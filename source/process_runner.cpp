@@ -0,0 +1,337 @@
+#include "process_runner.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <filesystem>
+#else
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace process
+{
+	// Tools that fail tend to repeat the same warning for every page, the start is enough to tell why
+	static constexpr size_t MAX_ERROR_BYTES = 64 * 1024;
+
+	static void append_error(Result& result, const char* data, const size_t length)
+	{
+		if (result.error.size() < MAX_ERROR_BYTES) {
+			result.error.append(data, std::min(length, MAX_ERROR_BYTES - result.error.size()));
+		}
+	}
+
+#ifdef _WIN32
+	// Quotes an argument so CommandLineToArgvW and the C runtime of the child read it back unchanged
+	static std::wstring quote_argument(const std::wstring& arg)
+	{
+		if (!arg.empty() && arg.find_first_of(L" \t\n\v\"") == std::wstring::npos) { return arg; }
+
+		std::wstring quoted = L"\"";
+		for (auto it = arg.begin(); ; ++it) {
+			size_t backslashes = 0;
+			while (it != arg.end() && *it == L'\\') {
+				++it;
+				++backslashes;
+			}
+			if (it == arg.end()) {
+				// Backslashes before the closing quote are doubled so the quote stays a quote
+				quoted.append(backslashes * 2, L'\\');
+				break;
+			} else if (*it == L'"') {
+				quoted.append(backslashes * 2 + 1, L'\\');
+				quoted.push_back(*it);
+			} else {
+				quoted.append(backslashes, L'\\');
+				quoted.push_back(*it);
+			}
+		}
+		quoted.push_back(L'"');
+		return quoted;
+	}
+
+	static std::string last_error(const std::string& what)
+	{
+		return what + " (error " + std::to_string(GetLastError()) + ")";
+	}
+
+	// Starts the program and waits for it on the calling thread
+	Result run_process(const Job& job)
+	{
+		Result result;
+		auto start = std::chrono::steady_clock::now();
+
+		std::wstring command_line = quote_argument(std::filesystem::path(job.program).wstring());
+		for (const auto& arg : job.args) {
+			command_line += L" " + quote_argument(std::filesystem::path(arg).wstring());
+		}
+
+		SECURITY_ATTRIBUTES inherit{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE error_read = nullptr;
+		HANDLE error_write = nullptr;
+		if (!CreatePipe(&error_read, &error_write, &inherit, 0)) {
+			result.error = last_error("Could not create a pipe for " + job.program);
+			return result;
+		}
+		SetHandleInformation(error_read, HANDLE_FLAG_INHERIT, 0);
+		HANDLE null_device = CreateFileW(L"NUL", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+										 &inherit, OPEN_EXISTING, 0, nullptr);
+		if (null_device == INVALID_HANDLE_VALUE) {
+			result.error = last_error("Could not open NUL for " + job.program);
+			CloseHandle(error_read);
+			CloseHandle(error_write);
+			return result;
+		}
+
+		// Only these two handles are inherited, otherwise children started by other
+		// workers at the same time would hold on to each other's pipes
+		HANDLE inherited[2] = { null_device, error_write };
+		SIZE_T attribute_size = 0;
+		InitializeProcThreadAttributeList(nullptr, 1, 0, &attribute_size);
+		std::vector<char> attribute_buffer(attribute_size);
+		auto attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attribute_buffer.data());
+		bool attributes_ready = InitializeProcThreadAttributeList(attributes, 1, 0, &attribute_size) &&
+			UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, sizeof(inherited), nullptr, nullptr);
+
+		STARTUPINFOEXW startup{};
+		startup.StartupInfo.cb = sizeof(startup);
+		startup.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+		startup.StartupInfo.hStdInput = null_device;
+		startup.StartupInfo.hStdOutput = null_device;
+		startup.StartupInfo.hStdError = error_write;
+		startup.lpAttributeList = attributes;
+
+		PROCESS_INFORMATION info{};
+		bool created = attributes_ready && CreateProcessW(nullptr, command_line.data(), nullptr, nullptr, TRUE,
+			EXTENDED_STARTUPINFO_PRESENT | CREATE_NO_WINDOW, nullptr, nullptr, &startup.StartupInfo, &info);
+		if (!created) { result.error = last_error("Could not start " + job.program); }
+		if (attributes_ready) { DeleteProcThreadAttributeList(attributes); }
+
+		// The child holds its own copies now, the pipe reports end of file once it exits
+		CloseHandle(error_write);
+		CloseHandle(null_device);
+		if (!created) {
+			CloseHandle(error_read);
+			return result;
+		}
+		CloseHandle(info.hThread);
+		result.launched = true;
+
+		// A full pipe would stall the child, so stderr is drained while waiting for it
+		std::thread reader([&]() {
+			char buffer[4096];
+			DWORD read = 0;
+			while (ReadFile(error_read, buffer, sizeof(buffer), &read, nullptr) && read > 0) {
+				append_error(result, buffer, read);
+			}
+		});
+
+		DWORD wait_ms = (job.timeout.count() > 0) ? static_cast<DWORD>(job.timeout.count()) : INFINITE;
+		if (WaitForSingleObject(info.hProcess, wait_ms) == WAIT_TIMEOUT) {
+			TerminateProcess(info.hProcess, 1);
+			WaitForSingleObject(info.hProcess, INFINITE);
+			result.timed_out = true;
+		}
+		reader.join();
+
+		DWORD exit_code = 0;
+		if (GetExitCodeProcess(info.hProcess, &exit_code)) { result.exit_code = static_cast<int>(exit_code); }
+		CloseHandle(info.hProcess);
+		CloseHandle(error_read);
+
+		result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		return result;
+	}
+#else
+	// Starts the program and waits for it on the calling thread
+	Result run_process(const Job& job)
+	{
+		Result result;
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + job.timeout;
+
+		// Close-on-exec from the start, otherwise children started by other workers
+		// at the same time would keep the write end open and the read never ends
+		int error_pipe[2];
+#ifdef __linux__
+		int piped = pipe2(error_pipe, O_CLOEXEC);
+#else
+		int piped = pipe(error_pipe);
+		if (piped == 0) {
+			fcntl(error_pipe[0], F_SETFD, FD_CLOEXEC);
+			fcntl(error_pipe[1], F_SETFD, FD_CLOEXEC);
+		}
+#endif
+		if (piped != 0) {
+			result.error = "Could not create a pipe for " + job.program + ": " + std::strerror(errno);
+			return result;
+		}
+
+		// dup2 clears close-on-exec on the child's stderr
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+		posix_spawn_file_actions_adddup2(&actions, error_pipe[1], STDERR_FILENO);
+
+		std::vector<char*> argv;
+		argv.reserve(job.args.size() + 2);
+		argv.push_back(const_cast<char*>(job.program.c_str()));
+		for (const auto& arg : job.args) { argv.push_back(const_cast<char*>(arg.c_str())); }
+		argv.push_back(nullptr);
+
+		pid_t pid = 0;
+		int spawned = posix_spawnp(&pid, job.program.c_str(), &actions, nullptr, argv.data(), environ);
+		posix_spawn_file_actions_destroy(&actions);
+		close(error_pipe[1]);
+		if (spawned != 0) {
+			result.error = "Could not start " + job.program + ": " + std::strerror(spawned);
+			close(error_pipe[0]);
+			return result;
+		}
+		result.launched = true;
+
+		auto remaining_ms = [&]() -> int {
+			if (job.timeout.count() <= 0) { return -1; }
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			return static_cast<int>(std::max<long long>(0, left.count()));
+		};
+
+		// A full pipe would stall the child, so stderr is drained while waiting for it
+		char buffer[4096];
+		bool reading = true;
+		while (reading && !result.timed_out) {
+			pollfd waiting{ error_pipe[0], POLLIN, 0 };
+			int timeout_ms = remaining_ms();
+			int ready = poll(&waiting, 1, timeout_ms);
+			if (ready < 0) {
+				if (errno == EINTR) { continue; }
+				break;
+			}
+			if (ready == 0) {
+				result.timed_out = true;
+				break;
+			}
+			ssize_t read_bytes = read(error_pipe[0], buffer, sizeof(buffer));
+			if (read_bytes > 0) {
+				append_error(result, buffer, static_cast<size_t>(read_bytes));
+			} else if (read_bytes == 0 || errno != EINTR) {
+				reading = false;
+			}
+		}
+		close(error_pipe[0]);
+
+		// The child may close stderr before it exits, the deadline still applies
+		int status = 0;
+		pid_t waited = 0;
+		while (!result.timed_out) {
+			waited = waitpid(pid, &status, (job.timeout.count() > 0) ? WNOHANG : 0);
+			if (waited == pid || (waited < 0 && errno != EINTR)) { break; }
+			if (waited == 0) {
+				if (remaining_ms() == 0) { result.timed_out = true; }
+				else { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+			}
+		}
+		if (result.timed_out) {
+			kill(pid, SIGKILL);
+			while ((waited = waitpid(pid, &status, 0)) < 0 && errno == EINTR) {}
+		}
+
+		if (waited == pid) {
+			if (WIFEXITED(status)) { result.exit_code = WEXITSTATUS(status); }
+			// Reported the way shells do, so a crash never looks like success
+			else if (WIFSIGNALED(status)) { result.exit_code = 128 + WTERMSIG(status); }
+		}
+
+		result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		return result;
+	}
+#endif
+
+	ProcessRunner::ProcessRunner(const size_t max_concurrent)
+	{
+		size_t workers = std::max<size_t>(1, max_concurrent);
+		m_workers.reserve(workers);
+		for (size_t i = 0; i < workers; ++i) {
+			m_workers.emplace_back(&ProcessRunner::work, this);
+		}
+	}
+
+	// Waits for every queued job before returning
+	ProcessRunner::~ProcessRunner()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_ready.notify_all();
+		for (auto& worker : m_workers) { worker.join(); }
+	}
+
+	// Queues the job, the future is ready once the program exited or was killed
+	std::future<Result> ProcessRunner::submit(Job job)
+	{
+		std::packaged_task<Result()> task([job = std::move(job)]() { return run_process(job); });
+		std::future<Result> result = task.get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.push_back(std::move(task));
+		}
+		m_ready.notify_one();
+		return result;
+	}
+
+	// Queues the job and waits for it
+	Result ProcessRunner::run(Job job)
+	{
+		return submit(std::move(job)).get();
+	}
+
+	size_t ProcessRunner::get_max_concurrent() const
+	{
+		return m_workers.size();
+	}
+
+	void ProcessRunner::work()
+	{
+		while (true) {
+			std::packaged_task<Result()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_ready.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+				if (m_queue.empty()) { return; }
+				task = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
+			// Exceptions end up in the job's future
+			task();
+		}
+	}
+
+	// Formats a failed result for an error message, e.g. "exited with code 1: <stderr>"
+	std::string describe(const Result& result)
+	{
+		std::string description;
+		if (!result.launched) {
+			return result.error;
+		} else if (result.timed_out) {
+			description = "timed out after " + std::to_string(result.elapsed.count()) + " ms";
+		} else {
+			description = "exited with code " + std::to_string(result.exit_code);
+		}
+
+		std::string error = result.error;
+		while (!error.empty() && (error.back() == '\n' || error.back() == '\r')) { error.pop_back(); }
+		if (!error.empty()) { description += ": " + error; }
+		return description;
+	}
+}
@@ -1,4 +1,5 @@
 #include "rdf_actions.h"
+#include "logging.h"
 
 namespace rdf
 {
@@ -16,6 +17,16 @@ namespace rdf
 		return pieces[0];
 	}
 
+	// Publication acronyms along with the rdf directory of their series
+	static const std::array<std::pair<std::string, std::string>, 4> rdf_series{ {
+		{ "EBFT08", "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/EBF/ebfull" },
+		// Local testing and debugging directory only:
+		//{ "EBFT08", "C:/Users/work/Desktop/ebfull" },
+		{ "EB", "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/ebl/ecbull" },
+		{ "777wps777", "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/777/777wps" },
+		{ "VUECON", "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/van/wpaper" }
+	} };
+
 	// Determines the high level directory based on the id's acronym
 	// Only supports: EB, EBFT08, VUECON, and 777WPS
 	std::string get_rdf_dir(const std::string& id)
@@ -26,30 +37,38 @@ namespace rdf
 		std::string pub = rdf::get_acronym(id, delimiter);
 		// std::cout << "Looking for publication rdf dir (ID:" + id + "): " + pub << std::endl;
 
-		std::array<std::string, 4> acronyms{ "EBFT08","EB","777wps777","VUECON" };
-
-		if (pub.compare(acronyms[0]) == 0) {
-			dir = "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/EBF/ebfull";
-			// Local testing and debugging directory only:
-			//dir = "C:/Users/work/Desktop/ebfull";
-		} else if (pub.compare(acronyms[1]) == 0) {
-			dir = "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/ebl/ecbull";
-		} else if (pub.compare(acronyms[2]) == 0) {
-			dir = "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/777/777wps";
-		} else if (pub.compare(acronyms[3]) == 0) {
-			dir = "C:/inetpub/vhosts/accessecon.com/httpdocs/RePEc/van/wpaper";
-		} else {
-			dir = "";
+		for (const auto& series : rdf_series) {
+			if (pub.compare(series.first) == 0) {
+				dir = series.second;
+				break;
+			}
 		}
 
 		if (dir == "") { 
-			std::cerr << "Could not find existing rdf directory. Returning empty string." << std::endl; 
+			logging::error() << "Could not find existing rdf directory. Returning empty string."; 
 		} else {
 			//std::cout << "Returning rdf dir (ID:" + id + "): " + dir << std::endl;
 		}
 		return dir;
 	}
 
+	// True if the id's acronym belongs to a series with an rdf directory, reports nothing otherwise
+	bool has_rdf_dir(const std::string& id)
+	{
+		std::string pub = rdf::get_acronym(id, '-');
+		return std::any_of(rdf_series.begin(), rdf_series.end(), [&](const auto& series) { return pub == series.first; });
+	}
+
+	// Lists the rdf directory of every supported series: ebfull, ecbull, 777wps, and wpaper
+	std::vector<std::string> get_rdf_dirs()
+	{
+		std::vector<std::string> dirs;
+		for (const auto& series : rdf_series) {
+			dirs.push_back(series.second);
+		}
+		return dirs;
+	}
+
 	// Determines the full path of an .rdf for the given paper's id
 	std::string get_rdf_path(const std::string& id) 
 	{
@@ -58,96 +77,77 @@ namespace rdf
 		return path + "/" + id + ".rdf";
 	}
 
-	// Read from the current state of an rdf into a temp file while updating lines containing the criteria
-	void write_to_temp(
-		const std::string& rdf_path, 
-		const std::string& id, 
-		const std::string criteria, 
-		const std::string new_str)
+	RdfPatch::RdfPatch(const std::string& id) : m_id(id) {}
+
+	// Queues a new value for the line beginning with the criteria, e.g. "Volume:" or "Pages:"
+	RdfPatch& RdfPatch::set(const std::string criteria, const std::string new_str)
 	{
-		// Open rdf file for read and write access
+		m_fields.emplace_back(criteria, new_str);
+		return *this;
+	}
+
+	// Rewrites the queued lines of the given rdf, throws std::runtime_error if it cannot be read or written
+	RdfPatch::Result RdfPatch::apply(const std::string& rdf_path, const file::SyncPolicy sync) const
+	{
+		// Read the whole rdf in one go
 		std::ifstream read_rdf_file(rdf_path);
 		if (!read_rdf_file.is_open()) {
-			std::cerr << "Error (ID: " + id + "): " + "Unable to open file for read: " + rdf_path << std::endl;
-			return;
-		}
-		// Create and open a temporary file for write access
-		std::ofstream write_temp_file("temp.rdf");
-		if (!write_temp_file.is_open()) {
-			std::cerr << "Error: Unable to open temporary file temp.rdf for write" << std::endl;
-			read_rdf_file.close();
-			return;
+			throw std::runtime_error("Error (ID: " + m_id + "): Unable to open file for read: " + rdf_path);
 		}
+		std::string rdf_content((std::istreambuf_iterator<char>(read_rdf_file)), std::istreambuf_iterator<char>());
+		read_rdf_file.close();
+
+		std::string updated_content;
+		updated_content.reserve(rdf_content.size() + 256);
+		std::vector<bool> found(m_fields.size(), false);
 
 		std::string line;
-		bool found_line = false;
-		// Read each line from the file
-		while (std::getline(read_rdf_file, line)) {
-			// Check if the line begins with the criteria string
-			if (line.find(criteria) == 0) {
-				found_line = true;
-				// Write the new line with the new string to the temporary file
-				write_temp_file << criteria + " " + new_str << std::endl;
-			} else {
-				// Write the original line to the temporary file
-				write_temp_file << line << std::endl;
+		size_t pos = 0;
+		while (pos < rdf_content.size()) {
+			size_t end = rdf_content.find('\n', pos);
+			if (end == std::string::npos) { end = rdf_content.size(); }
+			line.assign(rdf_content, pos, end - pos);
+			pos = end + 1;
+
+			// Criteria are checked in the order they were queued, as if each was applied on its own
+			for (size_t i = 0; i < m_fields.size(); ++i) {
+				if (line.compare(0, m_fields[i].first.size(), m_fields[i].first) == 0) {
+					found[i] = true;
+					line = m_fields[i].first + " " + m_fields[i].second;
+				}
 			}
+			updated_content += line;
+			updated_content += '\n';
 		}
 
-		read_rdf_file.close();
-		write_temp_file.close();
-
-		if (!(found_line)) {
-			std::cerr << "Error: Line starting with '" + criteria + "' not found in file" << std::endl;
-			std::remove("temp.rdf");
-			throw;
+		Result result{ false, {} };
+		for (size_t i = 0; i < m_fields.size(); ++i) {
+			if (!found[i]) { result.missing.push_back(m_fields[i].first); }
 		}
-	}
 
-	// Read from a temp file and overwrite the current state of an rdf file
-	void read_from_temp(const std::string& rdf_path, const std::string& id)
-	{
-		// Open rdf file for write access
-		std::ofstream write_rdf_file(rdf_path);
-		if (!write_rdf_file.is_open()) {
-			std::cerr << "Error (ID: " + id + "): " + "Unable to open file for write: " + rdf_path << std::endl;
-			return;
-		}
-		// Open the temporary input file for reading
-		std::ifstream read_temp_file("temp.rdf");
-		if (!read_temp_file.is_open()) {
-			std::cerr << "Error: Unable to open temporary file temp.rdf for read" << std::endl;
-			write_rdf_file.close();
-			return;
-		}
+		// Nothing to do when every line already holds its new value
+		if (updated_content == rdf_content) { return result; }
 
-		std::string line;
-		// Rewrite the original file to maintain permissions
-		while (std::getline(read_temp_file, line)) {
-			write_rdf_file << line << std::endl;
+		// Replace the rdf with a sibling temp file, the rdf keeps its permissions
+		try {
+			file::write_file_atomic(rdf_path, updated_content, sync);
+		} catch (const std::exception& e) {
+			throw std::runtime_error("Error (ID: " + m_id + "): " + e.what());
 		}
-
-		// Close open files
-		write_rdf_file.close();
-		read_temp_file.close();
-		// Delete local file: temp.rdf
-		std::remove("temp.rdf");
+		result.written = true;
+		return result;
 	}
 
+	// Rewrites the queued lines of the rdf found for the paper's id
+	RdfPatch::Result RdfPatch::apply(const file::SyncPolicy sync) const { return apply(rdf::get_rdf_path(m_id), sync); }
+
 	// Updates a line in an rdf where the line contains a search criteria
 	// Expected search example criteria: "Volume:" or "Issue:" or "Pages:"
 	void update_rdf_line(const std::string& id, const std::string criteria, const std::string new_str)
 	{
-		std::string rdf_path = rdf::get_rdf_path(id);
-		try {
-			write_to_temp(rdf_path, id, criteria, new_str);
-			read_from_temp(rdf_path, id);
-		} catch (const std::exception& e) {
-			std::cerr << "Error: " << e.what() << std::endl;
-			throw e;
-		} catch (...) {
-			std::cerr << "Unknown error occurred while updating the rdf's contents." << std::endl;
-			throw;
+		RdfPatch::Result result = RdfPatch(id).set(criteria, new_str).apply();
+		if (!result.missing.empty()) {
+			throw std::runtime_error("Line starting with '" + criteria + "' not found in file");
 		}
 	}
 }
\ No newline at end of file
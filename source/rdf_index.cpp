@@ -0,0 +1,265 @@
+#include "rdf_index.h"
+#include "logging.h"
+#include "parallel.h"
+
+namespace rdf
+{
+	// Identifies the on-disk index and the layout version it was written with
+	constexpr char INDEX_MAGIC[4] = { 'Q', 'F', 'R', 'I' };
+	constexpr uint32_t INDEX_VERSION = 1;
+
+	// The index is written in the native byte order, it never leaves the server that built it
+	template <typename T>
+	static void append_value(std::string& out, const T value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	static void append_string(std::string& out, const std::string& str)
+	{
+		append_value(out, static_cast<uint32_t>(str.size()));
+		out += str;
+	}
+
+	template <typename T>
+	static bool read_value(std::ifstream& in, T& value)
+	{
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+	}
+
+	static bool read_string(std::ifstream& in, std::string& str)
+	{
+		uint32_t size = 0;
+		if (!read_value(in, size)) { return false; }
+		str.resize(size);
+		return static_cast<bool>(in.read(str.data(), size));
+	}
+
+	// A field line begins with its name directly followed by a colon, e.g. "Creation-Date:"
+	// Any other line continues the value of the previous field
+	static size_t field_name_length(const std::string& content, const size_t begin, const size_t end)
+	{
+		if (begin >= end || !std::isalpha(static_cast<unsigned char>(content[begin]))) { return 0; }
+		for (size_t i = begin; i < end; ++i) {
+			char c = content[i];
+			if (c == ':') { return i - begin + 1; }
+			if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') { return 0; }
+		}
+		return 0;
+	}
+
+	// Fills the fields of a record from the raw contents of its rdf
+	void index_fields(const std::string& content, RdfRecord& record)
+	{
+		record.fields.clear();
+
+		size_t pos = 0;
+		while (pos < content.size()) {
+			size_t line_end = content.find('\n', pos);
+			size_t next = (line_end == std::string::npos) ? content.size() : line_end + 1;
+			if (line_end == std::string::npos) { line_end = content.size(); }
+
+			size_t value_end = line_end;
+			if (value_end > pos && content[value_end - 1] == '\r') { --value_end; }
+
+			size_t name_length = field_name_length(content, pos, value_end);
+			if (name_length != 0) {
+				size_t value_begin = pos + name_length;
+				while (value_begin < value_end && (content[value_begin] == ' ' || content[value_begin] == '\t')) { ++value_begin; }
+
+				RdfField field;
+				field.name = content.substr(pos, name_length);
+				field.offset = static_cast<uint32_t>(pos);
+				field.length = static_cast<uint32_t>(next - pos);
+				field.value = content.substr(value_begin, value_end - value_begin);
+				record.fields.push_back(std::move(field));
+			} else if (!record.fields.empty()) {
+				record.fields.back().length += static_cast<uint32_t>(next - pos);
+			}
+			pos = next;
+		}
+	}
+
+	// Returns the first-line value of a field in the record, or nullptr if the rdf has no such field
+	const std::string* find_field(const RdfRecord& record, const std::string& name)
+	{
+		for (const auto& field : record.fields) {
+			if (field.name == name) { return &field.value; }
+		}
+		return nullptr;
+	}
+
+	// Lists the first-line values of every occurrence of a field, e.g. each "Author-Name:"
+	std::vector<std::string> find_fields(const RdfRecord& record, const std::string& name)
+	{
+		std::vector<std::string> values;
+		for (const auto& field : record.fields) {
+			if (field.name == name) { values.push_back(field.value); }
+		}
+		return values;
+	}
+
+	// Loads a previously saved index, returns false if it is missing or unreadable
+	bool RdfIndex::load(const std::string& index_path)
+	{
+		m_records.clear();
+
+		std::ifstream in(index_path, std::ios::binary);
+		if (!in.is_open()) { return false; }
+
+		char magic[4];
+		uint32_t version = 0;
+		uint32_t count = 0;
+		if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, INDEX_MAGIC) ||
+			!read_value(in, version) || version != INDEX_VERSION || !read_value(in, count)) {
+			logging::warning() << "Ignoring unreadable rdf index: " << index_path;
+			return false;
+		}
+
+		for (uint32_t i = 0; i < count; ++i) {
+			RdfRecord record;
+			uint32_t field_count = 0;
+			bool ok = read_string(in, record.id) && read_string(in, record.path) &&
+				read_value(in, record.size) && read_value(in, record.mtime) && read_value(in, field_count);
+			for (uint32_t f = 0; ok && f < field_count; ++f) {
+				RdfField field;
+				ok = read_string(in, field.name) && read_value(in, field.offset) &&
+					read_value(in, field.length) && read_string(in, field.value);
+				record.fields.push_back(std::move(field));
+			}
+			if (!ok) {
+				logging::warning() << "Ignoring truncated rdf index: " << index_path;
+				m_records.clear();
+				return false;
+			}
+			std::string id = record.id;
+			m_records.emplace(std::move(id), std::move(record));
+		}
+		return true;
+	}
+
+	// Saves the index in a compact binary format, returns false if it cannot be written
+	bool RdfIndex::save(const std::string& index_path) const
+	{
+		std::string out(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		append_value(out, INDEX_VERSION);
+		append_value(out, static_cast<uint32_t>(m_records.size()));
+		for (const auto& indexed : m_records) {
+			const RdfRecord& record = indexed.second;
+			append_string(out, record.id);
+			append_string(out, record.path);
+			append_value(out, record.size);
+			append_value(out, record.mtime);
+			append_value(out, static_cast<uint32_t>(record.fields.size()));
+			for (const auto& field : record.fields) {
+				append_string(out, field.name);
+				append_value(out, field.offset);
+				append_value(out, field.length);
+				append_string(out, field.value);
+			}
+		}
+
+		// Replaced in a single rename, so a crash or a run reading it at the same time never sees half an index
+		try {
+			file::write_file_atomic(index_path, out, file::SyncPolicy::None, std::ios::binary);
+		} catch (const std::exception& e) {
+			logging::error() << "Error: Unable to save the rdf index " << index_path << ": " << e.what();
+			return false;
+		}
+		return true;
+	}
+
+	// Scans the directories in parallel and only re-reads the rdfs that are new or whose
+	// size or mtime changed since the index was saved, dropping rdfs that no longer exist
+	// or cannot be read
+	// Returns the number of rdfs that were read
+	size_t RdfIndex::refresh(const std::vector<std::string>& dirs, const size_t jobs)
+	{
+		// List every rdf along with its size and mtime, one directory per thread
+		std::vector<std::vector<RdfRecord>> listings(dirs.size());
+		parallel::for_each_index(jobs, dirs.size(), [&](size_t d) {
+			std::error_code ec;
+			for (const auto& entry : fs::directory_iterator(dirs[d], ec)) {
+				if (entry.path().extension() != ".rdf" || !entry.is_regular_file(ec)) continue;
+
+				RdfRecord record;
+				record.id = entry.path().stem().string();
+				record.path = entry.path().generic_string();
+				record.size = entry.file_size(ec);
+				record.mtime = static_cast<int64_t>(entry.last_write_time(ec).time_since_epoch().count());
+				listings[d].push_back(std::move(record));
+			}
+			if (ec) {
+				logging::error() << "Error: Unable to scan rdf directory " << dirs[d] << ": " << ec.message();
+			}
+		});
+
+		// Carry over unchanged records, everything else is read again
+		std::unordered_map<std::string, RdfRecord> records;
+		std::vector<RdfRecord*> stale;
+		for (auto& listing : listings) {
+			for (auto& record : listing) {
+				auto indexed = m_records.find(record.id);
+				bool unchanged = indexed != m_records.end() && indexed->second.path == record.path &&
+					indexed->second.size == record.size && indexed->second.mtime == record.mtime;
+
+				std::string id = record.id;
+				auto inserted = records.emplace(id, unchanged ? std::move(indexed->second) : std::move(record));
+				if (!inserted.second) {
+					logging::warning() << "Duplicate rdf id " << id << " found in more than one directory, keeping the first.";
+				} else if (!unchanged) {
+					stale.push_back(&inserted.first->second);
+				}
+			}
+		}
+
+		// Pointers into an unordered_map stay valid since no more records are inserted
+		std::vector<char> unreadable(stale.size(), 0);
+		parallel::for_each_index(jobs, stale.size(), [&](size_t i) {
+			RdfRecord& record = *stale[i];
+			std::ifstream rdf_file(record.path, std::ios::binary);
+			if (!rdf_file.is_open()) {
+				logging::error() << "Error (ID: " << record.id << "): Unable to open file for read: " << record.path;
+				unreadable[i] = 1;
+				return;
+			}
+			std::string content((std::istreambuf_iterator<char>(rdf_file)), std::istreambuf_iterator<char>());
+			index_fields(content, record);
+		});
+
+		// An rdf that could not be read is left out, so the next refresh tries it again instead of
+		// taking its size and mtime for an unchanged rdf without fields
+		std::vector<std::string> dropped;
+		for (size_t i = 0; i < stale.size(); ++i) {
+			if (unreadable[i]) { dropped.push_back(stale[i]->id); }
+		}
+		for (const auto& id : dropped) { records.erase(id); }
+
+		m_records.swap(records);
+		return stale.size();
+	}
+
+	// Returns nullptr if the id is not indexed
+	const RdfRecord* RdfIndex::find(const std::string& id) const
+	{
+		auto indexed = m_records.find(id);
+		return (indexed == m_records.end()) ? nullptr : &indexed->second;
+	}
+
+	// Lists the rdfs whose field holds the given value on its first line
+	std::vector<const RdfRecord*> RdfIndex::find_by_field(const std::string& name, const std::string& value) const
+	{
+		std::vector<const RdfRecord*> matches;
+		for (const auto& indexed : m_records) {
+			const std::string* field_value = find_field(indexed.second, name);
+			if (field_value != nullptr && *field_value == value) {
+				matches.push_back(&indexed.second);
+			}
+		}
+		std::sort(matches.begin(), matches.end(),
+			[](const RdfRecord* a, const RdfRecord* b) { return a->id < b->id; });
+		return matches;
+	}
+
+	size_t RdfIndex::size() const { return m_records.size(); }
+}
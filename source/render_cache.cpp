@@ -0,0 +1,155 @@
+#include "render_cache.h"
+#include "logging.h"
+#include "pdf_actions.h"
+#include "rdf_actions.h"
+
+namespace pdf
+{
+	// Identifies a cache store and the layout version it was written with
+	constexpr char CACHE_MAGIC[4] = { 'Q', 'F', 'R', 'C' };
+	constexpr uint32_t CACHE_VERSION = 1;
+
+	// Stores are written in the native byte order, they never leave the server that wrote them
+	template <typename T>
+	static void append_value(std::string& out, const T value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template <typename T>
+	static bool read_value(std::ifstream& in, T& value)
+	{
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+	}
+
+	static std::string cache_key(const std::string& id, const std::string& step)
+	{
+		return id + "\t" + step;
+	}
+
+	// Location of the cache store of the paper's publication, empty for unknown publications
+	std::string get_cache_path(const std::string& id)
+	{
+		std::string dir = pdf::get_dir(id);
+		if (dir == "") { return ""; }
+		return dir + "/GeneralPDF" + rdf::get_acronym(id, '-') + ".qfc";
+	}
+
+	// Reads the store of the paper's publication the first time it is needed, nullptr if it has none
+	RenderCache::Store* RenderCache::find_store(const std::string& id)
+	{
+		std::string pub = rdf::get_acronym(id, '-');
+		auto found = m_stores.find(pub);
+		if (found != m_stores.end()) { return found->second.path.empty() ? nullptr : &found->second; }
+
+		Store& store = m_stores[pub];
+		store.path = get_cache_path(id);
+		if (store.path.empty()) { return nullptr; }
+
+		std::ifstream in(fs::path(store.path), std::ios::binary);
+		if (!in.is_open()) { return &store; }
+
+		char magic[4];
+		uint32_t version = 0;
+		uint32_t count = 0;
+		if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, CACHE_MAGIC) ||
+			!read_value(in, version) || version != CACHE_VERSION || !read_value(in, count)) {
+			logging::warning() << "Ignoring unreadable render cache: " << store.path;
+			return &store;
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			uint32_t size = 0;
+			std::string key;
+			CacheEntry entry;
+			bool ok = read_value(in, size);
+			if (ok) {
+				key.resize(size);
+				ok = in.read(key.data(), size) && read_value(in, entry.input) && read_value(in, entry.output);
+			}
+			if (!ok) {
+				logging::warning() << "Ignoring truncated render cache: " << store.path;
+				store.entries.clear();
+				return &store;
+			}
+			store.entries[key] = entry;
+		}
+		return &store;
+	}
+
+	// True if an earlier run produced the output from the same input and it was not changed since
+	bool RenderCache::is_fresh(const std::string& id, const std::string& step, const uint64_t input, const std::string& output_path)
+	{
+		CacheEntry entry;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Store* store = find_store(id);
+			if (store == nullptr) { return false; }
+			auto found = store->entries.find(cache_key(id, step));
+			if (found == store->entries.end() || found->second.input != input) { return false; }
+			entry = found->second;
+		}
+
+		// The output is hashed again since anything may have replaced it after the last run
+		uint64_t output = 0;
+		if (!file::hash_file(output_path, output) || output != entry.output) { return false; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_hits;
+		return true;
+	}
+
+	// Records that the output was just produced from the input
+	void RenderCache::store(const std::string& id, const std::string& step, const uint64_t input, const std::string& output_path)
+	{
+		uint64_t output = 0;
+		if (!file::hash_file(output_path, output)) { return; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Store* store = find_store(id);
+		if (store == nullptr) { return; }
+		store->entries[cache_key(id, step)] = CacheEntry{ input, output };
+		store->changed = true;
+		++m_stored;
+	}
+
+	// Writes back every store that changed, returns false if one could not be written
+	bool RenderCache::save(const file::SyncPolicy sync)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool saved = true;
+		for (auto& pub : m_stores) {
+			Store& store = pub.second;
+			if (!store.changed) { continue; }
+
+			std::string out(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+			append_value(out, CACHE_VERSION);
+			append_value(out, static_cast<uint32_t>(store.entries.size()));
+			for (const auto& cached : store.entries) {
+				append_value(out, static_cast<uint32_t>(cached.first.size()));
+				out += cached.first;
+				append_value(out, cached.second.input);
+				append_value(out, cached.second.output);
+			}
+			try {
+				file::write_file_atomic(store.path, out, sync, std::ios::binary);
+				store.changed = false;
+			} catch (const std::exception& e) {
+				logging::error() << "Error: Unable to save the render cache " << store.path << ": " << e.what();
+				saved = false;
+			}
+		}
+		return saved;
+	}
+
+	size_t RenderCache::get_hits() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+
+	size_t RenderCache::get_stored() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stored;
+	}
+}
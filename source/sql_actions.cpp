@@ -1,73 +1,161 @@
 #include "sql_actions.h"
+#include "logging.h"
+#include "trace.h"
 
 namespace sql_agent
 {
-    // Execute a SELECT query to retrieve a field for the entry from "tablepaper" table
-    // For when only one condition is needed to find the field's value
-    std::string retrieve_field(
-        sql::Statement* query,
-        sql::ResultSet* result,
-        const std::string filename,
-        const std::string field)
+    // Sends the updates of many papers as few statements, papers with the same column list share
+    // UPDATE tablepaper SET a = CASE id WHEN ? THEN ? ... END, ... WHERE id IN (?, ...)
+    int execute_batch(MySQL_Interface& db, const std::vector<PaperUpdate>& updates, const size_t batch_size)
     {
-        std::string output = "";
-        result = query->executeQuery
-            ("SELECT " + field + " FROM tablepaper WHERE Published_PDF_File LIKE '%" + filename + "' LIMIT 1; ");
+        int affected = 0;
+        for (const auto& statement : build_batch_updates(updates, batch_size)) {
+            // Full batches share one statement, only the last one of a group differs in size
+            sql::PreparedStatement* update = db.prepare(statement.query);
+            unsigned int index = 1;
+            for (const auto& param : statement.params) {
+                update->setString(index++, param);
+            }
+            trace::Span span("sql");
+            affected += update->executeUpdate();
+        }
+        return affected;
+    }
+
+    MySQL_Interface& MySqlPaperStore::get_interface() { return m_db; }
 
-        // Retrieve the row
-        if (result->next()) { output = result->getString(1); }
-        else { std::cout << "No rows found." << std::endl; }
+    // The "tablepaper" rows whose Published_PDF_File ends with any of the given filenames
+    std::vector<PaperRow> MySqlPaperStore::find_by_filenames(const std::vector<std::string>& filenames)
+    {
+        // Matching on the basename replaces the leading-wildcard LIKE that
+        // forced a full table scan for every single paper
+        std::vector<PaperRow> rows;
+        for (size_t first = 0; first < filenames.size(); first += PREFETCH_BATCH_SIZE) {
+            size_t count = std::min(PREFETCH_BATCH_SIZE, filenames.size() - first);
+            sql::PreparedStatement* query = m_db.prepare
+                ("SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages FROM tablepaper "
+                 "WHERE SUBSTRING_INDEX(Published_PDF_File, '/', -1) IN " + placeholder_list(count) + "; ");
+            for (size_t i = 0; i < count; ++i) {
+                query->setString(static_cast<unsigned int>(i + 1), filenames[first + i]);
+            }
 
-        return output;
+            trace::Span span("sql");
+            std::unique_ptr<sql::ResultSet> result(query->executeQuery());
+            while (result->next()) {
+                PaperRow& row = rows.emplace_back();
+                row.id = result->getString(1);
+                row.published_pdf_file = result->getString(2);
+                row.number_of_pages = result->getString(3);
+                row.total_numpages = result->getString(4);
+            }
+        }
+        return rows;
     }
 
-    // Execute a SELECT query to retrieve a field for the entry from "tablepaper" table
-    // For when two conditions is needed to find the field's value
-    std::string retrieve_field(
-        sql::Statement* query,
-        sql::ResultSet* result, 
-        const std::string paper_num,
-        const std::string pub_dir,
-        const std::string field)
+    // Fills the title and abstract of each row from the "tablepaperofarticles" table
+    void MySqlPaperStore::fill_articles(std::vector<PaperRow>& rows)
     {
-        std::string output = "";
-        result = query->executeQuery
-        ("SELECT " + field + " FROM tablepaper WHERE Published_PDF_File LIKE '%-P" + paper_num + ".pdf' AND Published_PDF_File LIKE '" + pub_dir + "%'; ");
+        std::unordered_map<std::string, size_t> by_id;
+        for (size_t i = 0; i < rows.size(); ++i) { by_id.emplace(rows[i].id, i); }
+
+        for (size_t first = 0; first < rows.size(); first += PREFETCH_BATCH_SIZE) {
+            size_t count = std::min(PREFETCH_BATCH_SIZE, rows.size() - first);
+            sql::PreparedStatement* query = m_db.prepare
+                ("SELECT Article_ID, Title, Abstract FROM tablepaperofarticles "
+                 "WHERE Article_ID IN " + placeholder_list(count) + "; ");
+            for (size_t i = 0; i < count; ++i) {
+                query->setString(static_cast<unsigned int>(i + 1), rows[first + i].id);
+            }
+
+            trace::Span span("sql");
+            std::unique_ptr<sql::ResultSet> result(query->executeQuery());
+            while (result->next()) {
+                auto found = by_id.find(result->getString(1));
+                if (found == by_id.end()) { continue; }
 
-        // Retrieve the row
-        if (result->next()) { output = result->getString(1); }
-        else { std::cout << "No rows found." << std::endl; }
+                PaperRow& row = rows[found->second];
+                if (row.title.empty()) { row.title = result->getString(2); }
+                if (row.abstract.empty()) { row.abstract = result->getString(3); }
+            }
+        }
+    }
+
+    // Finds the paper with the given sequence number published in a volume directory
+    bool MySqlPaperStore::find_last_paper(const std::string& pub_dir, const int paper_num, PaperRow& row)
+    {
+        sql::PreparedStatement* query = m_db.prepare
+            ("SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages FROM tablepaper "
+             "WHERE Published_PDF_File LIKE ? AND Published_PDF_File LIKE ? LIMIT 1; ");
+        query->setString(1, "%-P" + std::to_string(paper_num) + ".pdf");
+        query->setString(2, pub_dir + "%");
 
-        return output;
+        trace::Span span("sql");
+        std::unique_ptr<sql::ResultSet> result(query->executeQuery());
+        if (!result->next()) { return false; }
+        row.id = result->getString(1);
+        row.published_pdf_file = result->getString(2);
+        row.number_of_pages = result->getString(3);
+        row.total_numpages = result->getString(4);
+        return true;
     }
 
-    // Retrieves a field from the "tablepaperofarticles" table
-    // Useful to retrieve a paper's abstract or title
-    std::string retrieve_article_field(
-        sql::Statement* query,
-        sql::ResultSet* result,
-        const std::string id,
-        const std::string field)
+    // Streams every "tablepaper" row as the server sends it
+    void MySqlPaperStore::for_each_paper(const std::function<void(const PaperRow&)>& visit)
     {
-        std::string output = "";
-        result = query->executeQuery
-        ("SELECT " + field + " FROM tablepaperofarticles WHERE Article_ID LIKE '" + id + "' LIMIT 1; ");
+        std::unique_ptr<sql::Statement> statement(m_db.get_connection()->createStatement());
+        // A forward-only result set is read unbuffered (mysql_use_result), so the client
+        // never holds more than the current row of the table
+        statement->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
 
-        // Retrieve the row
-        if (result->next()) { output = result->getString(1); }
-        else { std::cout << "No rows found." << std::endl; }
+        trace::Span span("sql-stream");
+        std::unique_ptr<sql::ResultSet> result(statement->executeQuery
+            ("SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages, citationString FROM tablepaper; "));
+        PaperRow row;
+        while (result->next()) {
+            row.id = result->getString(1);
+            row.published_pdf_file = result->getString(2);
+            row.number_of_pages = result->getString(3);
+            row.total_numpages = result->getString(4);
+            row.citation_string = result->getString(5);
+            visit(row);
+        }
+    }
 
-        return output;
+    // Sends all queued columns in a single round trip and returns the affected row count
+    int MySqlPaperStore::update(const PaperUpdate& paper_update)
+    {
+        if (paper_update.empty()) { return 0; }
+
+        // Papers of an issue share the same column list, so the statement is prepared once
+        BoundStatement statement = build_update(paper_update);
+        sql::PreparedStatement* update = m_db.prepare(statement.query);
+        unsigned int index = 1;
+        for (const auto& param : statement.params) {
+            update->setString(index++, param);
+        }
+
+        trace::Span span("sql");
+        return update->executeUpdate();
+    }
+
+    int MySqlPaperStore::update_batch(const std::vector<PaperUpdate>& updates) { return execute_batch(m_db, updates); }
+
+    // Disables autocommit until the transaction is committed or rolled back
+    void MySqlPaperStore::begin()
+    {
+        m_db.get_connection()->setAutoCommit(false);
+    }
+
+    void MySqlPaperStore::commit()
+    {
+        trace::Span span("sql-commit");
+        m_db.get_connection()->commit();
+        m_db.get_connection()->setAutoCommit(true);
     }
 
-    // Execute query to UPDATE field in "tablepaper" table with input string for the given id
-    void update_field_by_ID(
-        sql::Statement* query,
-        const std::string id,
-        const std::string field,
-        const std::string input_str)
+    void MySqlPaperStore::rollback()
     {
-        query->executeUpdate
-            ("UPDATE tablepaper SET " + field + " = '" + input_str + "' WHERE id = '" + id + "';");
+        m_db.get_connection()->rollback();
+        m_db.get_connection()->setAutoCommit(true);
     }
 }
\ No newline at end of file
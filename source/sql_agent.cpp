@@ -1,4 +1,5 @@
 #include "sql_agent.h"
+#include "logging.h"
 
 namespace sql_agent
 {
@@ -26,39 +27,57 @@ namespace sql_agent
 		if (this->m_sql_driver == nullptr) {
 			this->m_sql_driver = sql::mysql::get_mysql_driver_instance();
 		} else {
-			std::cerr << "mysql driver instance has already been initialized" << std::endl;
+			logging::error() << "mysql driver instance has already been initialized";
 		}
 	}
 
 	void MySQL_Interface::set_connection() 
 	{
+		// Statements prepared on a previous connection cannot be reused
+		this->clear_statements();
 		try {
 			if (m_server.transport == sql_agent::Protocol::TCP) {
 				this->m_conn = m_sql_driver->connect(
 					"tcp://" + m_server.ip + ":" + m_server.port, 
 					m_user.username, 
 					m_user.password);
-				std::cout << "Setting connection to tcp://" + m_server.ip + ":" + m_server.port 
-					+ "\nwith credentials: " + m_user.username + " " + m_user.password << std::endl;
+				logging::info() << "Setting connection to tcp://" << m_server.ip << ":" << m_server.port << " as " << m_user.username;
 			} else if (m_server.transport == sql_agent::Protocol::UDP) {
-				std::cerr << "UDP undefined for now." << std::endl;
+				logging::error() << "UDP undefined for now.";
 				throw;
 			} else {
-				std::cerr << "Unknown transport protocol." << std::endl;
+				logging::error() << "Unknown transport protocol.";
 				throw;
 			}
 			this->m_conn->setSchema(m_db_schema);
 		} catch (sql::SQLException& e) {
 			// Query error
-			std::cerr << "Query error: " << e.what() << std::endl;
+			logging::error() << "Query error: " << e.what();
 		} catch (...) {
-			std::cerr << "Unknown error occurred while attempting to set connection to the database." << std::endl;
+			logging::error() << "Unknown error occurred while attempting to set connection to the database.";
 		}
 	}
 	
 	sql::Connection* MySQL_Interface::get_connection() { return this->m_conn; }
 
+	sql::PreparedStatement* MySQL_Interface::prepare(const std::string& statement_template)
+	{
+		auto cached = this->m_statements.find(statement_template);
+		if (cached != this->m_statements.end()) {
+			return cached->second.get();
+		}
+
+		std::unique_ptr<sql::PreparedStatement> statement(this->m_conn->prepareStatement(statement_template));
+		sql::PreparedStatement* prepared = statement.get();
+		this->m_statements.emplace(statement_template, std::move(statement));
+		return prepared;
+	}
+
+	void MySQL_Interface::clear_statements() { this->m_statements.clear(); }
+
 	MySQL_Interface::~MySQL_Interface() {
+		// Prepared statements must be closed before the connection that owns them
+		this->clear_statements();
 		// Clean up the MySQL driver if it is allocated
 		if (m_sql_driver) {
 			delete m_sql_driver;
@@ -0,0 +1,161 @@
+#include "step_journal.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace pipeline
+{
+	static constexpr std::string_view JOURNAL_HEADER = "# QuickFixScript step journal 1\n";
+	static constexpr std::string_view PLAN_PREFIX = "plan\t";
+
+	static const char* const step_names[] = { "sql", "rename", "rdf", "html", "title-pdf", "pdf-splice" };
+
+	const char* get_step_name(const Step step)
+	{
+		return step_names[static_cast<size_t>(step)];
+	}
+
+	static bool parse_step(std::string_view name, Step& step)
+	{
+		for (size_t i = 0; i < std::size(step_names); ++i) {
+			if (name == step_names[i]) {
+				step = static_cast<Step>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static std::string read_whole_file(const std::string& path)
+	{
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file) { return ""; }
+		return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	// Reads the plan path a journal was created with, empty if the file is not a journal
+	std::string StepJournal::read_plan_path(const std::string& path)
+	{
+		std::string content = read_whole_file(path);
+		if (content.compare(0, JOURNAL_HEADER.size(), JOURNAL_HEADER) != 0) { return ""; }
+		size_t begin = JOURNAL_HEADER.size();
+		size_t end = content.find('\n', begin);
+		if (end == std::string::npos || content.compare(begin, PLAN_PREFIX.size(), PLAN_PREFIX) != 0) { return ""; }
+		return content.substr(begin + PLAN_PREFIX.size(), end - begin - PLAN_PREFIX.size());
+	}
+
+	// Opens the journal for appending and reads back the steps it already holds
+	StepJournal::StepJournal(const std::string& path, const std::string& plan_path, const size_t sync_every,
+							 const std::chrono::milliseconds sync_interval)
+		: m_path(path), m_plan_path(plan_path), m_sync_every(sync_every), m_sync_interval(sync_interval),
+		  m_last_sync(std::chrono::steady_clock::now())
+	{
+		std::string content = read_whole_file(path);
+		bool created = content.empty();
+		if (!created) {
+			std::string existing_plan = read_plan_path(path);
+			if (existing_plan == "") { throw std::runtime_error("Not a step journal: " + path); }
+			if (existing_plan != plan_path) {
+				throw std::runtime_error("Journal " + path + " belongs to the plan " + existing_plan);
+			}
+
+			// A line without its newline was cut off by a crash while it was written, the step is redone
+			size_t begin = 0;
+			while (true) {
+				size_t end = content.find('\n', begin);
+				if (end == std::string::npos) { break; }
+				std::string_view line(content.data() + begin, end - begin);
+				begin = end + 1;
+
+				size_t tab = line.find('\t');
+				Step step;
+				if (line.empty() || line[0] == '#' || tab == std::string_view::npos ||
+					!parse_step(line.substr(tab + 1), step)) {
+					continue;
+				}
+				m_done[std::string(line.substr(0, tab))] |= static_cast<uint8_t>(1u << static_cast<unsigned>(step));
+			}
+		}
+
+#ifdef _WIN32
+		m_file = _wfopen(std::filesystem::path(path).wstring().c_str(), L"ab");
+#else
+		m_file = std::fopen(path.c_str(), "ab");
+#endif
+		if (m_file == nullptr) { throw std::runtime_error("Unable to open the journal " + path); }
+
+		if (created) {
+			write_line(std::string(JOURNAL_HEADER) + std::string(PLAN_PREFIX) + plan_path + "\n");
+			sync_locked();
+		} else if (content.back() != '\n') {
+			// Ends the cut off line so the next step starts on a line of its own
+			write_line("\n");
+		}
+	}
+
+	// Flushes the lines that were not flushed yet
+	StepJournal::~StepJournal()
+	{
+		if (m_file == nullptr) { return; }
+		sync_locked();
+		std::fclose(m_file);
+	}
+
+	bool StepJournal::is_done(const std::string& id, const Step step) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_done.find(id);
+		return found != m_done.end() && (found->second & (1u << static_cast<unsigned>(step))) != 0;
+	}
+
+	// Papers with at least one completed step
+	size_t StepJournal::get_started() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_done.size();
+	}
+
+	// Thread safe, throws std::runtime_error if the line could not be written
+	void StepJournal::record(const std::string& id, const Step step)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		write_line(id + "\t" + get_step_name(step) + "\n");
+		m_done[id] |= static_cast<uint8_t>(1u << static_cast<unsigned>(step));
+
+		++m_unsynced;
+		if (m_unsynced >= m_sync_every || std::chrono::steady_clock::now() - m_last_sync >= m_sync_interval) {
+			sync_locked();
+		}
+	}
+
+	// Flushes every written line to disk
+	void StepJournal::sync()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		sync_locked();
+	}
+
+	const std::string& StepJournal::get_plan_path() const { return m_plan_path; }
+
+	// Hands the line to the operating system right away, only the flush to disk is batched
+	void StepJournal::write_line(std::string_view line)
+	{
+		if (std::fwrite(line.data(), 1, line.size(), m_file) != line.size() || std::fflush(m_file) != 0) {
+			throw std::runtime_error("Unable to write to the journal " + m_path);
+		}
+	}
+
+	void StepJournal::sync_locked()
+	{
+		m_unsynced = 0;
+		m_last_sync = std::chrono::steady_clock::now();
+#ifdef _WIN32
+		_commit(_fileno(m_file));
+#else
+		::fsync(fileno(m_file));
+#endif
+	}
+}
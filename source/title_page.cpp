@@ -0,0 +1,267 @@
+#include "title_page.h"
+#include "logging.h"
+
+namespace pdf
+{
+	// Layouts of EB, EBFT08, VUECON, and 777wps777
+	const std::vector<TitleLayout>& get_title_layouts()
+	{
+		static const std::array<std::string, 3> times_files{
+			"C:/Windows/Fonts/times.ttf", "C:/Windows/Fonts/timesbd.ttf", "C:/Windows/Fonts/timesi.ttf" };
+		static const std::array<StandardFont, 3> times{
+			StandardFont::TimesRoman, StandardFont::TimesBold, StandardFont::TimesItalic };
+		static const std::array<std::string, 3> arial_files{
+			"C:/Windows/Fonts/arial.ttf", "C:/Windows/Fonts/arialbd.ttf", "C:/Windows/Fonts/ariali.ttf" };
+		static const std::array<StandardFont, 3> helvetica{
+			StandardFont::Helvetica, StandardFont::HelveticaBold, StandardFont::HelveticaOblique };
+
+		// Journal articles, US letter
+		static const std::vector<TitleBlock> journal_blocks{
+			{ TitleLine::Journal, FontStyle::Bold, 20, 0, true },
+			{ TitleLine::Issue, FontStyle::Regular, 12, 6, true },
+			{ TitleLine::Rule, FontStyle::Regular, 0.75, 10, true },
+			{ TitleLine::Title, FontStyle::Bold, 18, 48, true },
+			{ TitleLine::Authors, FontStyle::Regular, 13, 20, true },
+			{ TitleLine::Rule, FontStyle::Regular, 0.75, 48, true },
+			{ TitleLine::Citation, FontStyle::Regular, 11, 14, false },
+			{ TitleLine::Published, FontStyle::Regular, 11, 14, false }
+		};
+		// Working papers, same content set in a sans-serif face
+		static const std::vector<TitleBlock> working_paper_blocks{
+			{ TitleLine::Journal, FontStyle::Bold, 16, 0, true },
+			{ TitleLine::Issue, FontStyle::Regular, 11, 6, true },
+			{ TitleLine::Rule, FontStyle::Regular, 0.5, 10, true },
+			{ TitleLine::Title, FontStyle::Bold, 17, 56, true },
+			{ TitleLine::Authors, FontStyle::Italic, 12, 20, true },
+			{ TitleLine::Rule, FontStyle::Regular, 0.5, 56, true },
+			{ TitleLine::Citation, FontStyle::Regular, 10, 14, false },
+			{ TitleLine::Published, FontStyle::Regular, 10, 12, false }
+		};
+
+		static const std::vector<TitleLayout> layouts{
+			{ "EB", "Economics Bulletin", times_files, times, 612, 792, 72, 90, journal_blocks },
+			{ "EBFT08", "Economics Bulletin", times_files, times, 612, 792, 72, 90, journal_blocks },
+			{ "VUECON", "Vanderbilt University Department of Economics Working Papers", arial_files, helvetica, 612, 792, 72, 90, working_paper_blocks },
+			{ "777wps777", "AccessEcon Working Paper Series", arial_files, helvetica, 612, 792, 72, 90, working_paper_blocks }
+		};
+		return layouts;
+	}
+
+	// Returns nullptr for publications without a layout
+	const TitleLayout* find_title_layout(const std::string& pub)
+	{
+		for (const auto& layout : get_title_layouts()) {
+			if (layout.pub == pub) { return &layout; }
+		}
+		return nullptr;
+	}
+
+	// "A", "A and B", "A, B and C"
+	std::string join_authors(const std::vector<std::string>& authors)
+	{
+		std::string joined;
+		for (size_t i = 0; i < authors.size(); ++i) {
+			if (i != 0) { joined += (i + 1 == authors.size()) ? " and " : ", "; }
+			joined += authors[i];
+		}
+		return joined;
+	}
+
+	// "12-25", empty if either end of the page range is unknown
+	std::string format_pages(const TitlePageFields& fields)
+	{
+		if (fields.page_range[0] == "" || fields.page_range[1] == "") { return ""; }
+		return fields.page_range[0] + "-" + fields.page_range[1];
+	}
+
+	// Authors, (year) ''Title'', Journal, Volume #, Issue #, pages #-#.
+	std::string format_citation(const TitlePageFields& fields, const std::string& journal)
+	{
+		std::string authors = join_authors(fields.authors);
+		std::string pages = format_pages(fields);
+		return (authors.empty() ? std::string() : authors + ", ") +
+			"(" + fields.year + ") ''" + fields.title + "'', " + journal + ", " +
+			"Volume " + std::to_string(fields.volume) + ", Issue " + std::to_string(fields.issue) +
+			(pages.empty() ? std::string() : ", pages " + pages) + ".";
+	}
+
+	// Splits text into lines no wider than the width, breaking between words
+	// where it can and inside a word only when the word alone is too wide
+	static std::vector<std::string> wrap_text(const std::string& text, const Font& font, const double size, const double width)
+	{
+		std::vector<std::string> lines;
+		std::string line;
+		double line_width = 0;
+		double space_width = font.measure(" ", size);
+		size_t pos = 0;
+		while (pos < text.size()) {
+			size_t end = text.find(' ', pos);
+			if (end == std::string::npos) { end = text.size(); }
+			std::string word = text.substr(pos, end - pos);
+			pos = end + 1;
+			if (word.empty()) { continue; }
+
+			double word_width = font.measure(word, size);
+			if (!line.empty() && line_width + space_width + word_width <= width) {
+				line += ' ' + word;
+				line_width += space_width + word_width;
+				continue;
+			}
+			if (!line.empty()) { lines.push_back(std::move(line)); }
+			line.clear();
+			line_width = 0;
+			for (char c : word) {
+				double char_width = font.measure(std::string_view(&c, 1), size);
+				if (!line.empty() && line_width + char_width > width) {
+					lines.push_back(std::move(line));
+					line.clear();
+					line_width = 0;
+				}
+				line += c;
+				line_width += char_width;
+			}
+		}
+		if (!line.empty()) { lines.push_back(std::move(line)); }
+		return lines;
+	}
+
+	// Positions and sizes in content streams, written like numbers in the rest of the file
+	static std::string format_number(const double value)
+	{
+		return PdfObject::make_real(value).text;
+	}
+
+	// Loads the fonts of every layout once, fonts that cannot be embedded are replaced by standard fonts
+	TitlePageRenderer::TitlePageRenderer()
+	{
+		for (const auto& layout : get_title_layouts()) {
+			std::array<const Font*, 3> fonts{};
+			for (size_t style = 0; style < 3; ++style) {
+				const std::string& path = layout.font_files[style];
+				auto loaded = m_fonts.find(path);
+				if (loaded == m_fonts.end()) {
+					try {
+						loaded = m_fonts.emplace(path, Font::load_truetype(path)).first;
+					} catch (const PdfError& e) {
+						Font fallback = Font::standard(layout.standard_fonts[style]);
+						logging::warning() << "Warning: " << e.what() << ", title pages use " << fallback.get_name() << " instead.";
+						loaded = m_fonts.emplace(path, std::move(fallback)).first;
+					}
+				}
+				fonts[style] = &loaded->second;
+			}
+			m_layout_fonts.push_back(fonts);
+		}
+	}
+
+	// Throws PdfError for publications without a layout, and UnencodableText for text the fonts cannot show
+	std::string TitlePageRenderer::render(const TitlePageFields& fields) const
+	{
+		const TitleLayout* found = find_title_layout(fields.pub);
+		if (found == nullptr) { throw PdfError("No title page layout for " + fields.pub); }
+		const TitleLayout& layout = *found;
+		const std::array<const Font*, 3>& fonts = m_layout_fonts[static_cast<size_t>(found - get_title_layouts().data())];
+
+		std::string issue = "Volume " + std::to_string(fields.volume) + ", Issue " + std::to_string(fields.issue);
+		std::string pages = format_pages(fields);
+		if (!pages.empty()) { issue += ", pages " + pages; }
+		std::string authors = join_authors(fields.authors);
+		std::string citation = "Citation: " + format_citation(fields, layout.journal);
+
+		std::string content;
+		std::array<std::array<bool, 256>, 3> used{};
+		double text_width = layout.width - 2 * layout.margin;
+		double y = layout.height - layout.top;
+		for (const auto& block : layout.blocks) {
+			y -= block.space_before;
+			if (block.line == TitleLine::Rule) {
+				content += format_number(block.size) + " w " + format_number(layout.margin) + " " + format_number(y) + " m " +
+					format_number(layout.width - layout.margin) + " " + format_number(y) + " l S\n";
+				continue;
+			}
+
+			std::string text;
+			switch (block.line) {
+			case TitleLine::Journal: text = layout.journal; break;
+			case TitleLine::Issue: text = issue; break;
+			case TitleLine::Title: text = fields.title; break;
+			case TitleLine::Authors: text = authors; break;
+			case TitleLine::Citation: text = citation; break;
+			case TitleLine::Published: text = "Published: " + fields.published; break;
+			default: break;
+			}
+			// Line breaks and tabs from the database are set as plain spaces
+			for (char& c : text) {
+				if (c == '\n' || c == '\r' || c == '\t') { c = ' '; }
+			}
+
+			size_t style = static_cast<size_t>(block.style);
+			const Font& font = *fonts[style];
+			// A '?' in place of a name on a published title page is worse than not writing it at all
+			uint32_t unmapped = 0;
+			std::string encoded = to_win_ansi(text, &unmapped);
+			if (unmapped != 0) {
+				char code[16];
+				std::snprintf(code, sizeof(code), "U+%04X", static_cast<unsigned>(unmapped));
+				throw UnencodableText("Title page of " + fields.id + " has " + code + ", which WinAnsi cannot hold");
+			}
+			for (const auto& line : wrap_text(encoded, font, block.size, text_width)) {
+				y -= block.size * 1.25;
+				double x = block.centered ? (layout.width - font.measure(line, block.size)) / 2 : layout.margin;
+				for (char c : line) { used[style][static_cast<unsigned char>(c)] = true; }
+				PdfObject shown = PdfObject::make_string(line);
+				content += "BT /F" + std::to_string(style + 1) + " " + format_number(block.size) + " Tf " +
+					format_number(x) + " " + format_number(y) + " Td " + shown.text + " Tj ET\n";
+			}
+		}
+
+		PdfBuilder builder("1.4");
+		int catalog_num = builder.allocate();
+		int pages_num = builder.allocate();
+		int page_num = builder.allocate();
+		int content_num = builder.allocate();
+
+		PdfObject font_resources = PdfObject::make_dictionary();
+		for (size_t style = 0; style < 3; ++style) {
+			bool in_use = false;
+			for (bool flag : used[style]) { in_use = in_use || flag; }
+			if (in_use) { font_resources.set("/F" + std::to_string(style + 1), fonts[style]->write(builder, used[style])); }
+		}
+		PdfObject resources = PdfObject::make_dictionary();
+		resources.set("/Font", std::move(font_resources));
+
+		PdfObject content_stream = PdfObject::make_dictionary();
+		content_stream.kind = PdfObject::Kind::Stream;
+		content_stream.set("/Length", PdfObject::make_number(static_cast<long long>(content.size())));
+		content_stream.stream = content;
+		builder.write(content_num, content_stream);
+
+		PdfObject page = PdfObject::make_dictionary();
+		page.set("/Type", PdfObject::make_name("/Page"));
+		page.set("/Parent", PdfObject::make_reference(pages_num));
+		PdfObject media_box = PdfObject::make_array();
+		for (double value : { 0.0, 0.0, layout.width, layout.height }) { media_box.items.push_back(PdfObject::make_real(value)); }
+		page.set("/MediaBox", std::move(media_box));
+		page.set("/Resources", std::move(resources));
+		page.set("/Contents", PdfObject::make_reference(content_num));
+		builder.write(page_num, page);
+
+		PdfObject pages_dict = PdfObject::make_dictionary();
+		pages_dict.set("/Type", PdfObject::make_name("/Pages"));
+		PdfObject kids = PdfObject::make_array();
+		kids.items.push_back(PdfObject::make_reference(page_num));
+		pages_dict.set("/Kids", std::move(kids));
+		pages_dict.set("/Count", PdfObject::make_number(1));
+		builder.write(pages_num, pages_dict);
+
+		PdfObject catalog = PdfObject::make_dictionary();
+		catalog.set("/Type", PdfObject::make_name("/Catalog"));
+		catalog.set("/Pages", PdfObject::make_reference(pages_num));
+		builder.write(catalog_num, catalog);
+
+		PdfObject trailer = PdfObject::make_dictionary();
+		trailer.set("/Size", PdfObject::make_number(builder.get_size()));
+		trailer.set("/Root", PdfObject::make_reference(catalog_num));
+		return builder.finish(trailer);
+	}
+}
@@ -0,0 +1,241 @@
+#include "title_rewriter.h"
+
+namespace pdf
+{
+	// Character classes of std::regex in the default "C" locale
+	static bool is_space(const char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r'; }
+	static bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+	static bool is_word(const char c) { return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+	// ECMAScript '.' matches everything but line terminators
+	static bool is_any(const char c) { return c != '\n' && c != '\r'; }
+
+	// Every pattern begins with one of these, the rest of the page is copied without a closer look
+	static bool starts_pattern(const char c) { return c == 'V' || c == 'I' || c == 'N' || c == 'p' || c == ','; }
+
+	static const char* match_literal(const char* p, const char* end, std::string_view literal)
+	{
+		if (p == nullptr || static_cast<size_t>(end - p) < literal.size() || std::string_view(p, literal.size()) != literal) { return nullptr; }
+		return p + literal.size();
+	}
+
+	static const char* match_any(const char* p, const char* end)
+	{
+		return (p != nullptr && p < end && is_any(*p)) ? p + 1 : nullptr;
+	}
+
+	static const char* match_char(const char* p, const char* end, const char c)
+	{
+		return (p != nullptr && p < end && *p == c) ? p + 1 : nullptr;
+	}
+
+	static const char* match_space(const char* p, const char* end)
+	{
+		return (p != nullptr && p < end && is_space(*p)) ? p + 1 : nullptr;
+	}
+
+	// Matches one or more of a class, greedy runs never have to backtrack since
+	// every pattern follows them with something outside of the class
+	template <typename Class>
+	static const char* match_run(const char* p, const char* end, Class in_class)
+	{
+		if (p == nullptr || p >= end || !in_class(*p)) { return nullptr; }
+		while (p < end && in_class(*p)) { ++p; }
+		return p;
+	}
+
+	static const char* match_spaces(const char* p, const char* end) { return match_run(p, end, is_space); }
+	static const char* match_digits(const char* p, const char* end) { return match_run(p, end, is_digit); }
+
+	// \d+-\d+
+	static const char* match_range(const char* p, const char* end)
+	{
+		return match_digits(match_char(match_digits(p, end), end, '-'), end);
+	}
+
+	// <b>Published:</b> (\w+ \d{1,2}, \d{4})
+	static const char* match_published(const char* p, const char* end)
+	{
+		p = match_literal(p, end, "<b>Published:</b> ");
+		p = match_char(match_run(p, end, is_word), end, ' ');
+		if (p == nullptr) { return nullptr; }
+		// \d{1,2} is greedy, one digit is only tried once two digits fail
+		const char* day_end = nullptr;
+		if (end - p >= 2 && is_digit(p[0]) && is_digit(p[1])) { day_end = match_literal(p + 2, end, ", "); }
+		if (day_end == nullptr && p < end && is_digit(p[0])) { day_end = match_literal(p + 1, end, ", "); }
+		if (day_end == nullptr || end - day_end < 4) { return nullptr; }
+		for (int i = 0; i < 4; ++i) {
+			if (!is_digit(day_end[i])) { return nullptr; }
+		}
+		return day_end + 4;
+	}
+
+	static bool all_digits(const std::string& str)
+	{
+		for (const char c : str) {
+			if (!is_digit(c)) { return false; }
+		}
+		return true;
+	}
+
+	TitleRewriter::TitleRewriter(
+		const int new_vol,
+		const int new_iss,
+		const std::array<std::string,2>& page_range,
+		const std::array<std::string,2>& date_array)
+		: m_new_vol(new_vol), m_new_iss(new_iss), m_page_range(page_range), m_date_array(date_array)
+	{
+		// Same replacements as update_title() and update_citation()
+		std::string vol = "Volume " + std::to_string(new_vol);
+		std::string iss = "Issue " + std::to_string(new_iss);
+		std::string pages = "pages " + page_range[0] + "-" + page_range[1];
+		std::string year = std::to_string((new_vol - 20) + 2000);
+
+		m_replacements = { vol, iss, vol, iss, iss, pages, pages, pages, pages, pages, pages, ", (" + year + ") ''" };
+		m_publish_date = "<b>Published:</b> " + date_array[1] + " 30, " + year;
+
+		// Numeric pages can never start or complete a later pattern, and regex_replace
+		// would expand a '$' in the date as a format specifier
+		m_single_pass = all_digits(page_range[0]) && all_digits(page_range[1]) &&
+			date_array[1].find('$') == std::string::npos;
+	}
+
+	// Returns the end of the first pattern before the limit that matches at the cursor, or nullptr
+	const char* TitleRewriter::first_match(const char* p, const char* end, const int limit, int& pattern) const
+	{
+		// Patterns are grouped by their first character and tried in the order they are applied
+		switch (*p) {
+		case 'V':
+			if (limit > TitleVolume) {
+				pattern = TitleVolume;
+				if (const char* e = match_digits(match_spaces(match_literal(p, end, "Volume"), end), end)) { return e; }
+			}
+			if (limit > CitationVolume) {
+				pattern = CitationVolume;
+				if (const char* e = match_digits(match_spaces(match_any(match_literal(p, end, "Vol"), end), end), end)) { return e; }
+			}
+			return nullptr;
+		case 'I':
+			if (limit > TitleIssue) {
+				pattern = TitleIssue;
+				if (const char* e = match_digits(match_spaces(match_literal(p, end, "Issue"), end), end)) { return e; }
+			}
+			if (limit > CitationIssueIss) {
+				pattern = CitationIssueIss;
+				if (const char* e = match_digits(match_space(match_any(match_literal(p, end, "Iss"), end), end), end)) { return e; }
+			}
+			return nullptr;
+		case 'N':
+			if (limit > CitationIssueNo) {
+				pattern = CitationIssueNo;
+				if (const char* e = match_digits(match_spaces(match_any(match_literal(p, end, "No"), end), end), end)) { return e; }
+			}
+			return nullptr;
+		case 'p':
+			if (limit > PagesRange) {
+				pattern = PagesRange;
+				if (const char* e = match_range(match_spaces(match_literal(p, end, "pages"), end), end)) { return e; }
+			}
+			if (limit > PagesPPRange) {
+				pattern = PagesPPRange;
+				if (const char* e = match_range(match_spaces(match_literal(p, end, "pp."), end), end)) { return e; }
+			}
+			if (limit > PagesPRange) {
+				pattern = PagesPRange;
+				if (const char* e = match_range(match_spaces(match_literal(p, end, "p."), end), end)) { return e; }
+			}
+			if (limit > PagesAppendix) {
+				pattern = PagesAppendix;
+				if (const char* e = match_digits(match_char(match_spaces(match_literal(p, end, "pages"), end), end, 'A'), end)) { return e; }
+			}
+			if (limit > PagesPAppendix) {
+				pattern = PagesPAppendix;
+				if (const char* e = match_digits(match_char(match_spaces(match_any(p + 1, end), end), end, 'A'), end)) { return e; }
+			}
+			if (limit > PagesPAAppendix) {
+				pattern = PagesPAAppendix;
+				if (const char* e = match_digits(match_char(match_any(p + 1, end), end, 'A'), end)) { return e; }
+			}
+			return nullptr;
+		case ',':
+			if (limit > Year) {
+				pattern = Year;
+				const char* e = match_literal(p, end, ", (");
+				for (int i = 0; e != nullptr && i < 4; ++i) {
+					e = (e < end && is_digit(*e)) ? e + 1 : nullptr;
+				}
+				if ((e = match_literal(e, end, ") ''")) != nullptr) { return e; }
+			}
+			return nullptr;
+		default:
+			return nullptr;
+		}
+	}
+
+	// Returns false without touching the output when the page has to go through the regex chain
+	bool TitleRewriter::rewrite_single_pass(std::string_view html_content, std::string& output) const
+	{
+		if (!m_single_pass) { return false; }
+
+		std::string updated_html;
+		updated_html.reserve(html_content.size() + 256);
+
+		const char* begin = html_content.data();
+		const char* end = begin + html_content.size();
+		const char* copied = begin;
+		const char* p = begin;
+		while (p < end) {
+			if (!starts_pattern(*p)) {
+				++p;
+				continue;
+			}
+			int pattern = PatternCount;
+			const char* match_end = first_match(p, end, PatternCount, pattern);
+			if (match_end == nullptr) {
+				++p;
+				continue;
+			}
+
+			// The chain applies the patterns one after another, so a pattern applied earlier that
+			// matches inside this one would have claimed the text first, leave that to the regex chain
+			for (const char* q = p + 1; q < match_end; ++q) {
+				int earlier = PatternCount;
+				if (first_match(q, end, pattern, earlier) != nullptr) { return false; }
+			}
+
+			updated_html.append(copied, p);
+			updated_html += m_replacements[pattern];
+			copied = p = match_end;
+		}
+		updated_html.append(copied, end);
+
+		// The date is matched last against the rewritten page, the same way the chain applies it
+		std::vector<std::pair<size_t, size_t>> dates;
+		size_t from = 0;
+		while ((from = updated_html.find("<b>Published:</b> ", from)) != std::string::npos) {
+			const char* date_begin = updated_html.data() + from;
+			const char* date_end = match_published(date_begin, updated_html.data() + updated_html.size());
+			if (date_end == nullptr) {
+				++from;
+				continue;
+			}
+			dates.emplace_back(from, static_cast<size_t>(date_end - date_begin));
+			from += dates.back().second;
+		}
+		for (auto date = dates.rbegin(); date != dates.rend(); ++date) {
+			updated_html.replace(date->first, date->second, m_publish_date);
+		}
+
+		output = std::move(updated_html);
+		return true;
+	}
+
+	std::string TitleRewriter::rewrite(const std::string& html_content) const
+	{
+		std::string updated_html;
+		if (rewrite_single_pass(html_content, updated_html)) { return updated_html; }
+
+		std::array<std::string, 2> date_array = m_date_array;
+		updated_html = pdf::update_title(html_content, m_new_vol, m_new_iss);
+		return pdf::update_citation(updated_html, m_new_vol, m_new_iss, m_page_range, date_array);
+	}
+}
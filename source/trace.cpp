@@ -0,0 +1,137 @@
+#include "trace.h"
+#include "logging.h"
+#include "atomic_file.h"
+
+namespace trace
+{
+	// Events of one thread, only that thread appends to it
+	struct ThreadBuffer
+	{
+		uint32_t thread_id;
+		std::vector<Event> events;
+	};
+
+	// Buffers outlive their threads so the events of finished workers are still reported
+	static std::mutex registry_mutex;
+
+	static std::vector<std::unique_ptr<ThreadBuffer>>& registry()
+	{
+		static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		return buffers;
+	}
+
+	// Only the first span of a thread takes the lock, to register its buffer
+	static ThreadBuffer& local_buffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			auto& buffers = registry();
+			buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffers.back()->thread_id = static_cast<uint32_t>(buffers.size());
+			buffers.back()->events.reserve(256);
+			buffer = buffers.back().get();
+		}
+		return *buffer;
+	}
+
+	static int64_t now()
+	{
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	Span::Span(const char* name) : m_name(name), m_start(now()) {}
+
+	Span::Span(const char* name, std::string detail) : m_name(name), m_detail(std::move(detail)), m_start(now()) {}
+
+	Span::~Span()
+	{
+		int64_t end = now();
+		local_buffer().events.push_back({ m_name, std::move(m_detail), m_start, end - m_start });
+	}
+
+	// Nearest rank of a sorted list
+	static int64_t percentile(const std::vector<int64_t>& sorted, const double fraction)
+	{
+		size_t rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size()) + 0.999999);
+		return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+	}
+
+	// Collects the events of every thread, only call this once the traced threads went idle
+	std::vector<StageSummary> summarize()
+	{
+		std::map<std::string, std::vector<int64_t>> durations;
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			for (const auto& buffer : registry()) {
+				for (const auto& event : buffer->events) {
+					durations[event.name].push_back(event.duration);
+				}
+			}
+		}
+
+		std::vector<StageSummary> summaries;
+		for (auto& stage : durations) {
+			std::vector<int64_t>& sorted = stage.second;
+			std::sort(sorted.begin(), sorted.end());
+			int64_t total = 0;
+			for (int64_t duration : sorted) { total += duration; }
+			summaries.push_back({ stage.first, sorted.size(), percentile(sorted, 0.50), percentile(sorted, 0.95), sorted.back(), total });
+		}
+		// The stage that took the most time overall comes first
+		std::sort(summaries.begin(), summaries.end(), [](const StageSummary& a, const StageSummary& b) { return a.total > b.total; });
+		return summaries;
+	}
+
+	// Prints one line per span name with its count, p50, p95, max and total time in milliseconds
+	void print_summary(std::ostream& out)
+	{
+		std::vector<StageSummary> summaries = summarize();
+		if (summaries.empty()) { return; }
+
+		char line[160];
+		std::snprintf(line, sizeof(line), "%-18s %8s %10s %10s %10s %12s\n", "stage", "count", "p50 ms", "p95 ms", "max ms", "total ms");
+		out << "\nTime spent per stage:\n" << line;
+		for (const auto& stage : summaries) {
+			std::snprintf(line, sizeof(line), "%-18s %8zu %10.2f %10.2f %10.2f %12.2f\n", stage.name.c_str(), stage.count,
+						  stage.p50 / 1000.0, stage.p95 / 1000.0, stage.max / 1000.0, stage.total / 1000.0);
+			out << line;
+		}
+		out << std::flush;
+	}
+
+	// Writes every event as a Chrome trace_event file that chrome://tracing or Perfetto can open
+	bool write_chrome_trace(const std::string& path)
+	{
+		json::Value document = json::Value::make_object();
+		json::Value& events = document.set("traceEvents", json::Value::make_array());
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			for (const auto& buffer : registry()) {
+				for (const auto& event : buffer->events) {
+					json::Value& item = events.push_back(json::Value::make_object());
+					item.set("name", event.name);
+					item.set("cat", "quickfix");
+					item.set("ph", "X");
+					item.set("ts", static_cast<long long>(event.start));
+					item.set("dur", static_cast<long long>(event.duration));
+					item.set("pid", 1);
+					item.set("tid", static_cast<long long>(buffer->thread_id));
+					if (!event.detail.empty()) {
+						item.set("args", json::Value::make_object()).set("id", event.detail);
+					}
+				}
+			}
+		}
+		document.set("displayTimeUnit", "ms");
+
+		try {
+			file::write_file_atomic(path, document.dump(), file::SyncPolicy::None, std::ios::binary);
+		} catch (const std::exception& e) {
+			logging::error() << "Error: Unable to write the trace " << path << ": " << e.what();
+			return false;
+		}
+		return true;
+	}
+}
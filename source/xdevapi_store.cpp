@@ -0,0 +1,151 @@
+#include "xdevapi_store.h"
+#include "logging.h"
+#include "trace.h"
+
+namespace sql_agent
+{
+	// The X Protocol returns typed values where the classic API converts everything with getString()
+	static std::string to_string(const mysqlx::Value& value)
+	{
+		switch (value.getType()) {
+		case mysqlx::Value::VNULL: return "";
+		case mysqlx::Value::INT64: return std::to_string(value.get<int64_t>());
+		case mysqlx::Value::UINT64: return std::to_string(value.get<uint64_t>());
+		case mysqlx::Value::STRING: return value.get<std::string>();
+		case mysqlx::Value::RAW: {
+			mysqlx::bytes raw = value.getRawBytes();
+			return std::string(reinterpret_cast<const char*>(raw.begin()), raw.size());
+		}
+		default: return std::to_string(value.get<double>());
+		}
+	}
+
+	static void read_paper_row(mysqlx::Row& result, PaperRow& row)
+	{
+		row.id = to_string(result[0]);
+		row.published_pdf_file = to_string(result[1]);
+		row.number_of_pages = to_string(result[2]);
+		row.total_numpages = to_string(result[3]);
+	}
+
+	// Opens the session on the host, port, username, password and schema
+	XDevApiPaperStore::XDevApiPaperStore(
+		const std::string& host,
+		const unsigned int port,
+		const std::string& username,
+		const std::string& password,
+		const std::string& schema)
+	{
+		m_session = std::make_unique<mysqlx::Session>(
+			mysqlx::SessionOption::HOST, host,
+			mysqlx::SessionOption::PORT, port,
+			mysqlx::SessionOption::USER, username,
+			mysqlx::SessionOption::PWD, password,
+			mysqlx::SessionOption::DB, schema);
+		logging::info() << "Setting X Protocol session to mysqlx://" << host << ":" << port << " as " << username;
+	}
+
+	// Sends the statement with its values bound in order
+	mysqlx::SqlResult XDevApiPaperStore::execute(const BoundStatement& statement)
+	{
+		mysqlx::SqlStatement sql = m_session->sql(statement.query);
+		for (const auto& param : statement.params) { sql.bind(param); }
+		trace::Span span("sql");
+		return sql.execute();
+	}
+
+	// The "tablepaper" rows whose Published_PDF_File ends with any of the given filenames
+	std::vector<PaperRow> XDevApiPaperStore::find_by_filenames(const std::vector<std::string>& filenames)
+	{
+		std::vector<PaperRow> rows;
+		for (size_t first = 0; first < filenames.size(); first += PREFETCH_BATCH_SIZE) {
+			size_t count = std::min(PREFETCH_BATCH_SIZE, filenames.size() - first);
+			BoundStatement statement{ "SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages FROM tablepaper "
+									  "WHERE SUBSTRING_INDEX(Published_PDF_File, '/', -1) IN " + placeholder_list(count) + "; ",
+									  std::vector<std::string>(filenames.begin() + first, filenames.begin() + first + count) };
+			mysqlx::SqlResult result = execute(statement);
+			for (mysqlx::Row found : result) {
+				read_paper_row(found, rows.emplace_back());
+			}
+		}
+		return rows;
+	}
+
+	// Fills the title and abstract of each row from the "tablepaperofarticles" table
+	void XDevApiPaperStore::fill_articles(std::vector<PaperRow>& rows)
+	{
+		std::unordered_map<std::string, size_t> by_id;
+		for (size_t i = 0; i < rows.size(); ++i) { by_id.emplace(rows[i].id, i); }
+
+		for (size_t first = 0; first < rows.size(); first += PREFETCH_BATCH_SIZE) {
+			size_t count = std::min(PREFETCH_BATCH_SIZE, rows.size() - first);
+			BoundStatement statement{ "SELECT Article_ID, Title, Abstract FROM tablepaperofarticles "
+									  "WHERE Article_ID IN " + placeholder_list(count) + "; ", {} };
+			for (size_t i = 0; i < count; ++i) { statement.params.push_back(rows[first + i].id); }
+
+			mysqlx::SqlResult result = execute(statement);
+			for (mysqlx::Row article : result) {
+				auto found = by_id.find(to_string(article[0]));
+				if (found == by_id.end()) { continue; }
+
+				PaperRow& row = rows[found->second];
+				if (row.title.empty()) { row.title = to_string(article[1]); }
+				if (row.abstract.empty()) { row.abstract = to_string(article[2]); }
+			}
+		}
+	}
+
+	// Finds the paper with the given sequence number published in a volume directory
+	bool XDevApiPaperStore::find_last_paper(const std::string& pub_dir, const int paper_num, PaperRow& row)
+	{
+		BoundStatement statement{ "SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages FROM tablepaper "
+								  "WHERE Published_PDF_File LIKE ? AND Published_PDF_File LIKE ? LIMIT 1; ",
+								  { "%-P" + std::to_string(paper_num) + ".pdf", pub_dir + "%" } };
+		mysqlx::SqlResult result = execute(statement);
+		mysqlx::Row found = result.fetchOne();
+		if (found.isNull()) { return false; }
+		read_paper_row(found, row);
+		return true;
+	}
+
+	// Streams every "tablepaper" row, X Protocol results are read from the session as they are iterated
+	void XDevApiPaperStore::for_each_paper(const std::function<void(const PaperRow&)>& visit)
+	{
+		mysqlx::SqlResult result = execute(BoundStatement{ "SELECT ID, Published_PDF_File, NumberOfPages, TotalNumpages, citationString "
+														   "FROM tablepaper; ", {} });
+		trace::Span span("sql-stream");
+		PaperRow row;
+		for (mysqlx::Row found : result) {
+			read_paper_row(found, row);
+			row.citation_string = to_string(found[4]);
+			visit(row);
+		}
+	}
+
+	// Sends all queued columns in a single round trip and returns the affected row count
+	int XDevApiPaperStore::update(const PaperUpdate& paper_update)
+	{
+		if (paper_update.empty()) { return 0; }
+		return static_cast<int>(execute(build_update(paper_update)).getAffectedItemsCount());
+	}
+
+	// Every statement carries up to UPDATE_BATCH_SIZE papers
+	int XDevApiPaperStore::update_batch(const std::vector<PaperUpdate>& updates)
+	{
+		int affected = 0;
+		for (const auto& statement : build_batch_updates(updates)) {
+			affected += static_cast<int>(execute(statement).getAffectedItemsCount());
+		}
+		return affected;
+	}
+
+	void XDevApiPaperStore::begin() { m_session->startTransaction(); }
+
+	void XDevApiPaperStore::commit()
+	{
+		trace::Span span("sql-commit");
+		m_session->commit();
+	}
+
+	void XDevApiPaperStore::rollback() { m_session->rollback(); }
+}